@@ -20,6 +20,7 @@
  */
 
 #include <assert.h>
+#include <algorithm>
 #include <math.h>
 #include <sstream>
 #include <iostream>
@@ -28,18 +29,47 @@
 
 #include "csp.h"
 #include "celar.h"
+#include "celar_kernel.h"
 #include "utils.h"
 
-std::vector<double> CelarModificationConstraint::COSTS;
-std::vector<double> CelarInterferenceConstraint::COSTS;
-
 const double EXP_ROOT = 1.6;
 
+/**
+ * Values of a constraint with a given weight when satisfied and when violated
+ *
+ * Returns false if the costs have not been loaded (aCosts is 0 or too short), the
+ * constraint can not be evaluated then (but it can still propagate).
+ */
+static bool celar_weight_values(unsigned int aWeight, const std::vector<double> * aCosts,
+                double & outSatisfied, double & outViolated) {
+        if (aWeight > (aCosts ? aCosts->size() : 0)) {
+                outSatisfied = outViolated = 1.0;
+                return false;
+        }
+
+        if (aWeight == 0) {
+                outSatisfied = 1.0;
+                outViolated = EPSILON;
+        } else {
+                outSatisfied = exp(log(EXP_ROOT) * (*aCosts)[aWeight - 1]);
+                outViolated = 1.0;
+        }
+
+        return true;
+}
+
+CelarInterferenceConstraint::CelarInterferenceConstraint(VarIdType var1, VarIdType var2, CelarOperator op,
+                VarType targetValue, unsigned int weight, const CelarCosts * aCosts):
+        mVar1(var1), mVar2(var2), mOperator(op), mTargetValue(targetValue), mWeight(weight) {
+        mCostsMissing = !celar_weight_values(mWeight, aCosts ? &aCosts->interference : 0,
+                        mSatisfiedWeight, mViolatedWeight);
+}
+
 double CelarInterferenceConstraint::operator()(Assignment &a) const {
-        assert(mWeight <= COSTS.size());
+        assert(!mCostsMissing);
 
         bool satisfied;
-        VarType diff = abs(a[mVar1] - a[mVar2]);
+        VarType diff = abs(originalValue(mVar1, a[mVar1]) - originalValue(mVar2, a[mVar2]));
 
         switch (mOperator) {
         case CELAR_OPERATOR_EQ:
@@ -53,23 +83,21 @@ double CelarInterferenceConstraint::operator()(Assignment &a) const {
                 break;
         }
 
-        if (mWeight == 0) {
-                return satisfied ? 1.0 : EPSILON; // Let's give a smallish chance to unfeasible solutions
-        } else {
-                return exp(log(EXP_ROOT) * COSTS[mWeight - 1] * (double)satisfied);
-        }
+        // Violated hard constraints get a smallish chance (EPSILON) to let the unfeasible solutions through
+        return satisfied ? mSatisfiedWeight : mViolatedWeight;
 }
 
-double CelarModificationConstraint::operator()(Assignment &a) const {
-        assert(mWeight <= COSTS.size());
+CelarModificationConstraint::CelarModificationConstraint(VarIdType var, VarType defaultValue, unsigned int weight,
+                const CelarCosts * aCosts):
+        mVar(var), mDefaultValue(defaultValue), mWeight(weight) {
+        mCostsMissing = !celar_weight_values(mWeight, aCosts ? &aCosts->mobility : 0,
+                        mSatisfiedWeight, mViolatedWeight);
+}
 
-        bool satisfied = (a[mVar] == mDefaultValue);
+double CelarModificationConstraint::operator()(Assignment &a) const {
+        assert(!mCostsMissing);
 
-        if (mWeight == 0) {
-                return satisfied ? 1.0 : EPSILON;
-        } else {
-               return exp(log(EXP_ROOT) * COSTS[mWeight - 1] * (double)satisfied); 
-        }
+        return (a[mVar] == mDefaultValue) ? mSatisfiedWeight : mViolatedWeight;
 }
 
 bool CelarInterferenceConstraint::hasSupport(VarIdType aVarId, VarType aValue,
@@ -90,41 +118,155 @@ bool CelarInterferenceConstraint::hasSupport(VarIdType aVarId, VarType aValue,
 
         if (evidenceItOther != aEvidence.end()) {
                 // If the other variable is in evidence, check only against that value
-                switch (mOperator) {
-                        case CELAR_OPERATOR_GT:
-                                return abs(aValue - evidenceItOther->second) > mTargetValue;
-                                break;
-                        case CELAR_OPERATOR_EQ:
-                                return abs(aValue - evidenceItOther->second) == mTargetValue;
-                                break;
-                        case CELAR_OPERATOR_LT:
-                                return abs(aValue - evidenceItOther->second) < mTargetValue;
-                                break;
-                }
+                return isCompatible(aVarId, aValue, evidenceItOther->second);
         }
 
         // If neither of the two variables is in the evidence, check their domains
-        const Domain * otherVarDomain = aProblem.getVariableById(otherVarId)->getDomain();
+        VarType support;
+        return findSupport(aVarId, aValue, *aProblem.getVariableById(otherVarId)->getDomain(), support);
+}
+
+bool CelarInterferenceConstraint::isCompatible(VarIdType aVarId, VarType aValue, VarType aOtherValue) const {
+        assert(aVarId == mVar1 || aVarId == mVar2);
+
+        // The distances are computed on the original values (frequencies), not on the value indices
+        VarIdType otherVarId = (aVarId == mVar1) ? mVar2 : mVar1;
+        VarType distance = abs(originalValue(aVarId, aValue) - originalValue(otherVarId, aOtherValue));
+
+        switch (mOperator) {
+                case CELAR_OPERATOR_GT:
+                        return distance > mTargetValue;
+                        break;
+                case CELAR_OPERATOR_EQ:
+                        return distance == mTargetValue;
+                        break;
+                case CELAR_OPERATOR_LT:
+                        return distance < mTargetValue;
+                        break;
+        }
+
+        return false;
+}
+
+bool CelarInterferenceConstraint::findSupport(VarIdType aVarId, VarType aValue, const DomainView & aOtherDomain,
+                VarType & ioSupport) const {
+
+        VarIdType otherVarId = (aVarId == mVar1) ? mVar2 : mVar1;
+        VarType value = originalValue(aVarId, aValue);
+
         // Depending on the operators, checking for support can be easy
+        // (value indices are ordered in the same way as the original values)
         if (mOperator == CELAR_OPERATOR_EQ) {
-                return (otherVarDomain->find(aValue - mTargetValue) != otherVarDomain->end()) ||
-                        (otherVarDomain->find(aValue + mTargetValue) != otherVarDomain->end());
+                VarType lowerIndex = mMapping->findValueIndex(otherVarId, value - mTargetValue);
+                VarType upperIndex = mMapping->findValueIndex(otherVarId, value + mTargetValue);
+
+                if (lowerIndex >= 0 && aOtherDomain.count(lowerIndex)) {
+                        ioSupport = lowerIndex;
+                        return true;
+                } else if (upperIndex >= 0 && aOtherDomain.count(upperIndex)) {
+                        ioSupport = upperIndex;
+                        return true;
+                }
+                return false;
         } else if (mOperator == CELAR_OPERATOR_GT) {
-                Domain::const_iterator bound1 = otherVarDomain->upper_bound(aValue + mTargetValue);
-                Domain::const_iterator bound2 = otherVarDomain->lower_bound(aValue - mTargetValue);
-                --bound2;
+                // Either some value above value + target, or some value below value - target
+                DomainView::const_iterator bound = aOtherDomain.lower_bound(
+                                mMapping->upperBoundIndex(otherVarId, value + mTargetValue));
+                if (bound != aOtherDomain.end()) {
+                        ioSupport = *bound;
+                        return true;
+                }
 
-                return ((bound1 != otherVarDomain->end() && *bound1 > aValue + mTargetValue) || 
-                                (bound2 != otherVarDomain->end() && *bound2 < aValue - mTargetValue));
+                if (!aOtherDomain.empty() &&
+                                *aOtherDomain.begin() < mMapping->lowerBoundIndex(otherVarId, value - mTargetValue)) {
+                        ioSupport = *aOtherDomain.begin();
+                        return true;
+                }
+                return false;
         } else {
-                // CELAR_OPERATOR_LT
-                Domain::const_iterator bound = otherVarDomain->lower_bound(aValue + mTargetValue);
-                --bound;
+                // CELAR_OPERATOR_LT, some value in the interval (value - target, value + target)
+                DomainView::const_iterator bound = aOtherDomain.lower_bound(
+                                mMapping->upperBoundIndex(otherVarId, value - mTargetValue));
 
-                return (bound != otherVarDomain->end() && *bound < aValue + mTargetValue && *bound > aValue - mTargetValue);
+                if (bound != aOtherDomain.end() && originalValue(otherVarId, *bound) < value + mTargetValue) {
+                        ioSupport = *bound;
+                        return true;
+                }
+                return false;
         }
 }
 
+void CelarInterferenceConstraint::reviseDomain(VarIdType aVarId, const DomainView & aDomain,
+                const DomainView & aOtherDomain, std::vector<VarType> & outUnsupported) const {
+
+        assert(aVarId == mVar1 || aVarId == mVar2);
+
+        if (aOtherDomain.empty()) {
+                outUnsupported.insert(outUnsupported.end(), aDomain.begin(), aDomain.end());
+                return;
+        }
+
+        VarIdType otherVarId = (aVarId == mVar1) ? mVar2 : mVar1;
+
+        // Both domains are walked in the order of the original values
+        const std::vector<VarType> & values = mMapping->getOriginalValues(aVarId);
+        const std::vector<VarType> & otherValues = mMapping->getOriginalValues(otherVarId);
+
+        if (mOperator == CELAR_OPERATOR_GT) {
+                // A value x has a support iff min(y) < x - target or max(y) > x + target,
+                // so exactly the values in <max(y) - target, min(y) + target> lose their support
+                VarType minOther = otherValues[*aOtherDomain.begin()];
+                VarType maxOther = otherValues[*aOtherDomain.rbegin()];
+
+                VarType last = mMapping->upperBoundIndex(aVarId, minOther + mTargetValue);
+                for (DomainView::const_iterator domIt = aDomain.lower_bound(
+                                        mMapping->lowerBoundIndex(aVarId, maxOther - mTargetValue));
+                                domIt != aDomain.end() && *domIt < last; ++domIt) {
+                        outUnsupported.push_back(*domIt);
+                }
+        } else if (mOperator == CELAR_OPERATOR_LT) {
+                // Sliding window: the first value of y above x - target is the only candidate,
+                // it moves forward together with x
+                DomainView::const_iterator otherIt = aOtherDomain.begin();
+                for (DomainView::const_iterator domIt = aDomain.begin(); domIt != aDomain.end(); ++domIt) {
+                        VarType value = values[*domIt];
+
+                        while (otherIt != aOtherDomain.end() && otherValues[*otherIt] <= value - mTargetValue)
+                                ++otherIt;
+
+                        if (otherIt == aOtherDomain.end() || otherValues[*otherIt] >= value + mTargetValue)
+                                outUnsupported.push_back(*domIt);
+                }
+        } else {
+                // CELAR_OPERATOR_EQ, look for x - target and x + target with two pointers
+                // (the value indices of different variables are not equally spaced, so the
+                // domains can not simply be shifted against each other)
+                DomainView::const_iterator lowerIt = aOtherDomain.begin();
+                DomainView::const_iterator upperIt = aOtherDomain.begin();
+                for (DomainView::const_iterator domIt = aDomain.begin(); domIt != aDomain.end(); ++domIt) {
+                        VarType value = values[*domIt];
+
+                        while (lowerIt != aOtherDomain.end() && otherValues[*lowerIt] < value - mTargetValue)
+                                ++lowerIt;
+                        while (upperIt != aOtherDomain.end() && otherValues[*upperIt] < value + mTargetValue)
+                                ++upperIt;
+
+                        bool supported = (lowerIt != aOtherDomain.end() && otherValues[*lowerIt] == value - mTargetValue) ||
+                                (upperIt != aOtherDomain.end() && otherValues[*upperIt] == value + mTargetValue);
+
+                        if (!supported)
+                                outUnsupported.push_back(*domIt);
+                }
+        }
+}
+
+void CelarInterferenceConstraint::remap(const ProblemMapping & aMapping) {
+        mVar1 = aMapping.getIndex(mVar1);
+        mVar2 = aMapping.getIndex(mVar2);
+
+        Constraint::remap(aMapping);
+}
+
 bool CelarModificationConstraint::hasSupport(VarIdType aVarId, VarType aValue,
                 const CSPProblem &aProblem, const Assignment &aEvidence) {
 
@@ -142,7 +284,256 @@ bool CelarModificationConstraint::hasSupport(VarIdType aVarId, VarType aValue,
         }
 }
 
-ConstraintList * celar_load_constraints(const char *fileName) {
+void CelarModificationConstraint::remap(const ProblemMapping & aMapping) {
+        mVar = aMapping.getIndex(mVar);
+        mDefaultValue = aMapping.findValueIndex(mVar, mDefaultValue);
+
+        Constraint::remap(aMapping);
+}
+
+void CelarInterferenceConstraint::addToStore(ConstraintStore & aStore) const {
+        assert(mMapping);
+        aStore.getBlock<CelarInterferenceBlock>()->addConstraint(mVar1, mVar2, mOperator, mTargetValue,
+                        mSatisfiedWeight, mViolatedWeight, mCostsMissing, *mMapping);
+}
+
+void CelarModificationConstraint::addToStore(ConstraintStore & aStore) const {
+        aStore.getBlock<CelarModificationBlock>()->addConstraint(mVar, mDefaultValue,
+                        mSatisfiedWeight, mViolatedWeight, mCostsMissing);
+}
+
+void CelarInterferenceBlock::addConstraint(VarIdType aVar1, VarIdType aVar2, CelarOperator aOperator, VarType aTargetValue,
+                double aSatisfiedWeight, double aViolatedWeight, bool aCostsMissing, const ProblemMapping & aMapping) {
+        if (aCostsMissing)
+                mCostsMissing = true;
+
+        mVar1.push_back(aVar1);
+        mVar2.push_back(aVar2);
+        mOperator.push_back(aOperator);
+        mTargetValue.push_back(aTargetValue);
+        mValues1.push_back(&aMapping.getOriginalValues(aVar1)[0]);
+        mValues2.push_back(&aMapping.getOriginalValues(aVar2)[0]);
+        mSatisfiedWeight.push_back(aSatisfiedWeight);
+        mViolatedWeight.push_back(aViolatedWeight);
+        mLogSatisfiedWeight.push_back(log(aSatisfiedWeight));
+        mLogViolatedWeight.push_back(log(aViolatedWeight));
+}
+
+void CelarInterferenceBlock::finalize() {
+        // Stable counting sort of the rows by the operator
+        std::vector<size_t> order;
+        for (int op = CELAR_OPERATOR_EQ; op <= CELAR_OPERATOR_GT; ++op) {
+                mOperatorOffsets[op] = order.size();
+                for (size_t i = 0; i < mOperator.size(); ++i) {
+                        if (mOperator[i] == op)
+                                order.push_back(i);
+                }
+        }
+        mOperatorOffsets[CELAR_OPERATOR_GT + 1] = order.size();
+        assert(order.size() == size());
+
+        permute_vector(mVar1, order);
+        permute_vector(mVar2, order);
+        permute_vector(mOperator, order);
+        permute_vector(mTargetValue, order);
+        permute_vector(mValues1, order);
+        permute_vector(mValues2, order);
+        permute_vector(mSatisfiedWeight, order);
+        permute_vector(mViolatedWeight, order);
+        permute_vector(mLogSatisfiedWeight, order);
+        permute_vector(mLogViolatedWeight, order);
+
+        // Index the rows by variables
+        size_t numVars = 0;
+        for (size_t i = 0; i < size(); ++i) {
+                assert(mVar1[i] != mVar2[i]);
+                numVars = std::max(numVars, (size_t)std::max(mVar1[i], mVar2[i]) + 1);
+        }
+
+        mVarOffsets.assign(numVars + 1, 0);
+        mVarValues.assign(numVars, 0);
+        for (size_t i = 0; i < size(); ++i) {
+                ++mVarOffsets[mVar1[i] + 1];
+                ++mVarOffsets[mVar2[i] + 1];
+                mVarValues[mVar1[i]] = mValues1[i];
+                mVarValues[mVar2[i]] = mValues2[i];
+        }
+        for (size_t v = 0; v < numVars; ++v) {
+                mVarOffsets[v + 1] += mVarOffsets[v];
+        }
+
+        std::vector<size_t> position(mVarOffsets.begin(), mVarOffsets.end() - 1);
+        mVarNeighbours.resize(2 * size());
+        mVarRows.resize(2 * size());
+        for (size_t i = 0; i < size(); ++i) {
+                size_t e1 = position[mVar1[i]]++;
+                mVarNeighbours[e1] = mVar2[i];
+                mVarRows[e1] = i;
+
+                size_t e2 = position[mVar2[i]]++;
+                mVarNeighbours[e2] = mVar1[i];
+                mVarRows[e2] = i;
+        }
+}
+
+double CelarInterferenceBlock::evalAssignment(const VarType * aValues) const {
+        assert(!mCostsMissing);
+
+        double result = 1.0;
+        size_t i;
+
+        for (i = mOperatorOffsets[CELAR_OPERATOR_EQ]; i < mOperatorOffsets[CELAR_OPERATOR_EQ + 1]; ++i) {
+                VarType diff = abs(mValues1[i][aValues[mVar1[i]]] - mValues2[i][aValues[mVar2[i]]]);
+                result *= (diff == mTargetValue[i]) ? mSatisfiedWeight[i] : mViolatedWeight[i];
+        }
+
+        for (i = mOperatorOffsets[CELAR_OPERATOR_LT]; i < mOperatorOffsets[CELAR_OPERATOR_LT + 1]; ++i) {
+                VarType diff = abs(mValues1[i][aValues[mVar1[i]]] - mValues2[i][aValues[mVar2[i]]]);
+                result *= (diff < mTargetValue[i]) ? mSatisfiedWeight[i] : mViolatedWeight[i];
+        }
+
+        for (i = mOperatorOffsets[CELAR_OPERATOR_GT]; i < mOperatorOffsets[CELAR_OPERATOR_GT + 1]; ++i) {
+                VarType diff = abs(mValues1[i][aValues[mVar1[i]]] - mValues2[i][aValues[mVar2[i]]]);
+                result *= (diff > mTargetValue[i]) ? mSatisfiedWeight[i] : mViolatedWeight[i];
+        }
+
+        return result;
+}
+
+double CelarInterferenceBlock::evalLogAssignment(const VarType * aValues) const {
+        assert(!mCostsMissing);
+
+        double result = 0.0;
+        size_t i;
+
+        for (i = mOperatorOffsets[CELAR_OPERATOR_EQ]; i < mOperatorOffsets[CELAR_OPERATOR_EQ + 1]; ++i) {
+                VarType diff = abs(mValues1[i][aValues[mVar1[i]]] - mValues2[i][aValues[mVar2[i]]]);
+                result += (diff == mTargetValue[i]) ? mLogSatisfiedWeight[i] : mLogViolatedWeight[i];
+        }
+
+        for (i = mOperatorOffsets[CELAR_OPERATOR_LT]; i < mOperatorOffsets[CELAR_OPERATOR_LT + 1]; ++i) {
+                VarType diff = abs(mValues1[i][aValues[mVar1[i]]] - mValues2[i][aValues[mVar2[i]]]);
+                result += (diff < mTargetValue[i]) ? mLogSatisfiedWeight[i] : mLogViolatedWeight[i];
+        }
+
+        for (i = mOperatorOffsets[CELAR_OPERATOR_GT]; i < mOperatorOffsets[CELAR_OPERATOR_GT + 1]; ++i) {
+                VarType diff = abs(mValues1[i][aValues[mVar1[i]]] - mValues2[i][aValues[mVar2[i]]]);
+                result += (diff > mTargetValue[i]) ? mLogSatisfiedWeight[i] : mLogViolatedWeight[i];
+        }
+
+        return result;
+}
+
+void CelarInterferenceBlock::addConditionalLogWeights(VarIdType aVarId, const VarType * aCandidates, size_t aNumCandidates,
+                VarType * ioValues, double * ioLogWeights) const {
+        assert(!mCostsMissing);
+
+
+        // Constraints not involving the variable are the same for all the candidates
+        double otherLogWeight = 0.0;
+        for (size_t i = 0; i < size(); ++i) {
+                if (mVar1[i] == aVarId || mVar2[i] == aVarId)
+                        continue;
+
+                VarType diff = abs(mValues1[i][ioValues[mVar1[i]]] - mValues2[i][ioValues[mVar2[i]]]);
+                bool satisfied;
+
+                switch (mOperator[i]) {
+                case CELAR_OPERATOR_EQ:
+                        satisfied = (diff == mTargetValue[i]);
+                        break;
+                case CELAR_OPERATOR_LT:
+                        satisfied = (diff < mTargetValue[i]);
+                        break;
+                default:
+                        satisfied = (diff > mTargetValue[i]);
+                        break;
+                }
+
+                otherLogWeight += satisfied ? mLogSatisfiedWeight[i] : mLogViolatedWeight[i];
+        }
+
+        for (size_t k = 0; k < aNumCandidates; ++k) {
+                ioLogWeights[k] += otherLogWeight;
+        }
+
+        if (aVarId + 1 >= mVarOffsets.size() || mVarOffsets[aVarId] == mVarOffsets[aVarId + 1])
+                return;
+
+        // Frequencies of the candidates, evaluated against every neighbour at once
+        std::vector<VarType> candidateValues(aNumCandidates);
+        for (size_t k = 0; k < aNumCandidates; ++k) {
+                candidateValues[k] = mVarValues[aVarId][aCandidates[k]];
+        }
+
+        for (size_t e = mVarOffsets[aVarId]; e < mVarOffsets[aVarId + 1]; ++e) {
+                size_t row = mVarRows[e];
+                VarIdType neighbour = mVarNeighbours[e];
+
+                celar_interference_log_weights(&candidateValues[0], aNumCandidates, mVarValues[neighbour][ioValues[neighbour]],
+                                mOperator[row], mTargetValue[row], mLogSatisfiedWeight[row], mLogViolatedWeight[row],
+                                ioLogWeights);
+        }
+}
+
+void CelarModificationBlock::addConstraint(VarIdType aVar, VarType aDefaultValue, double aSatisfiedWeight,
+                double aViolatedWeight, bool aCostsMissing) {
+        if (aCostsMissing)
+                mCostsMissing = true;
+
+        mVar.push_back(aVar);
+        mDefaultValue.push_back(aDefaultValue);
+        mSatisfiedWeight.push_back(aSatisfiedWeight);
+        mViolatedWeight.push_back(aViolatedWeight);
+        mLogSatisfiedWeight.push_back(log(aSatisfiedWeight));
+        mLogViolatedWeight.push_back(log(aViolatedWeight));
+}
+
+double CelarModificationBlock::evalAssignment(const VarType * aValues) const {
+        assert(!mCostsMissing);
+
+        double result = 1.0;
+        for (size_t i = 0; i < mVar.size(); ++i) {
+                result *= (aValues[mVar[i]] == mDefaultValue[i]) ? mSatisfiedWeight[i] : mViolatedWeight[i];
+        }
+
+        return result;
+}
+
+double CelarModificationBlock::evalLogAssignment(const VarType * aValues) const {
+        assert(!mCostsMissing);
+
+        double result = 0.0;
+        for (size_t i = 0; i < mVar.size(); ++i) {
+                result += (aValues[mVar[i]] == mDefaultValue[i]) ? mLogSatisfiedWeight[i] : mLogViolatedWeight[i];
+        }
+
+        return result;
+}
+
+void CelarModificationBlock::addConditionalLogWeights(VarIdType aVarId, const VarType * aCandidates, size_t aNumCandidates,
+                VarType * ioValues, double * ioLogWeights) const {
+        assert(!mCostsMissing);
+
+
+        double otherLogWeight = 0.0;
+
+        for (size_t i = 0; i < mVar.size(); ++i) {
+                if (mVar[i] == aVarId) {
+                        for (size_t k = 0; k < aNumCandidates; ++k) {
+                                ioLogWeights[k] += (aCandidates[k] == mDefaultValue[i]) ? mLogSatisfiedWeight[i] : mLogViolatedWeight[i];
+                        }
+                } else {
+                        otherLogWeight += (ioValues[mVar[i]] == mDefaultValue[i]) ? mLogSatisfiedWeight[i] : mLogViolatedWeight[i];
+                }
+        }
+
+        for (size_t k = 0; k < aNumCandidates; ++k) {
+                ioLogWeights[k] += otherLogWeight;
+        }
+}
+
+ConstraintList * celar_load_constraints(const char *fileName, const CelarCosts * costs) {
         std::ifstream file(fileName);
         std::string line;
 
@@ -178,7 +569,7 @@ ConstraintList * celar_load_constraints(const char *fileName) {
                         weight = atol(words[5].c_str());
 
                 CelarInterferenceConstraint * c = 
-                        new CelarInterferenceConstraint(var1, var2, op, targetValue, weight);
+                        new CelarInterferenceConstraint(var1, var2, op, targetValue, weight, costs);
                 result->push_back(c);
         }
                 
@@ -187,15 +578,20 @@ ConstraintList * celar_load_constraints(const char *fileName) {
 }
 
 void celar_load_variables(const char * fileName, const std::vector<Domain> * domains,
-                VariableMap * variables, ConstraintList * constraints) {
+                VariableArray * variables, ConstraintList * constraints, ProblemMapping * mapping,
+                const CelarCosts * costs) {
         
         assert(domains);
         assert(variables);
         assert(constraints);
+        assert(mapping);
 
         std::ifstream file(fileName);
         std::string line;
 
+        // Domain of each variable, ordered by the original variable ids
+        std::map<VarIdType, unsigned int> domainIds;
+
         while (std::getline(file, line)) {
                 std::vector<std::string> words;
                 tokenize(line, words);
@@ -209,16 +605,27 @@ void celar_load_variables(const char * fileName, const std::vector<Domain> * dom
                 if (domainId >= domains->size())
                         continue; // TODO: throw an exception
 
-                Domain *d = new Domain((*domains)[domainId]);
-                (*variables)[varId] = new Variable(varId, d);
+                domainIds[varId] = domainId;
 
                 if (words.size() >= 4) {
                         constraints->push_back(
                                 new CelarModificationConstraint(varId, atol(words[2].c_str()),
-                                        atol(words[3].c_str())));
+                                        atol(words[3].c_str()), costs));
                 }
                 
         }
+
+        // Number the variables densely and replace their values by value indices
+        for (std::map<VarIdType, unsigned int>::const_iterator domIt = domainIds.begin();
+                        domIt != domainIds.end(); ++domIt) {
+                const Domain & d = (*domains)[domIt->second];
+                VarIdType index = mapping->addVariable(domIt->first, d);
+
+                VarIdType varId = variables->addVariable(d.size());
+                assert(varId == index);
+        }
+
+        remap_constraints(constraints, *mapping);
 }
 
 std::vector<Domain> * celar_load_domains(const char * fileName) {
@@ -242,21 +649,23 @@ std::vector<Domain> * celar_load_domains(const char * fileName) {
         return result;
 }
 
-void celar_load_costs(const char * fileName) {
+CelarCosts * celar_load_costs(const char * fileName) {
         std::ifstream file(fileName);
         std::string line;
         std::istringstream lineStream;
 
+        CelarCosts * result = new CelarCosts();
+
         if (std::getline(file, line)) {
                 // Read CELAR_INTERFERENCE_COSTS
                 lineStream.str(line);
                 double cost;
                 while (lineStream >> cost) {
-                        CelarInterferenceConstraint::COSTS.push_back(cost);
+                        result->interference.push_back(cost);
 
                 }
         } else {
-                return;
+                return result;
         }
 
         lineStream.clear();
@@ -266,9 +675,9 @@ void celar_load_costs(const char * fileName) {
                 lineStream.str(line);
                 double cost;
                 while (lineStream >> cost) {
-                        CelarModificationConstraint::COSTS.push_back(cost);
+                        result->mobility.push_back(cost);
                 }
-        } else {
-                return;
         }
+
+        return result;
 }
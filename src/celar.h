@@ -35,10 +35,23 @@ enum {
         CELAR_SOFT_CONSTRAINT_WEIGHT_STEP = 10
 };
 
+/**
+ * Costs of the soft constraints of a CELAR problem, a constraint with the
+ * weight w > 0 costs interference[w - 1] (or mobility[w - 1])
+ */
+struct CelarCosts {
+        std::vector<double> interference;
+        std::vector<double> mobility;
+};
+
 class CelarInterferenceConstraint: public Constraint {
 public:
-        CelarInterferenceConstraint(VarIdType var1, VarIdType var2, CelarOperator op, VarType targetValue, unsigned int weight):
-                mVar1(var1), mVar2(var2), mOperator(op), mTargetValue(targetValue), mWeight(weight) {};
+        /**
+         * The values of the constraint are computed from aCosts (which may be 0 if the costs
+         * were not loaded, the constraint can only propagate then)
+         */
+        CelarInterferenceConstraint(VarIdType var1, VarIdType var2, CelarOperator op, VarType targetValue, unsigned int weight,
+                        const CelarCosts * aCosts);
 
         virtual double operator()(Assignment &a) const;
 
@@ -55,18 +68,54 @@ public:
 
         virtual bool hasSupport(VarIdType aVarId, VarType aValue, const CSPProblem &aProblem, const Assignment &aEvidence);
 
-        static std::vector<double> COSTS;
+        virtual bool isHardBinary() const {
+                return !isSoft();
+        };
+
+        virtual bool isCompatible(VarIdType aVarId, VarType aValue, VarType aOtherValue) const;
+
+        /**
+         * Finds the support directly from the bounds of the operator (ioSupport is
+         * only written)
+         */
+        virtual bool findSupport(VarIdType aVarId, VarType aValue, const DomainView & aOtherDomain,
+                        VarType & ioSupport) const;
+
+        virtual bool revisesDomains() const {
+                return true;
+        };
+
+        /**
+         * |x - y| > k only depends on the bounds of the other domain, |x - y| < k and
+         * |x - y| = k are revised in one merge-like pass over both domains
+         */
+        virtual void reviseDomain(VarIdType aVarId, const DomainView & aDomain, const DomainView & aOtherDomain,
+                        std::vector<VarType> & outUnsupported) const;
+
+        virtual unsigned int getPropagationEvents() const {
+                if (isSoft())
+                        return 0;
+
+                return (mOperator == CELAR_OPERATOR_GT) ? DOMAIN_EVENT_BOUNDS : DOMAIN_EVENT_VALUE;
+        };
+
+        virtual void remap(const ProblemMapping & aMapping);
+
+        virtual void addToStore(ConstraintStore & aStore) const;
 protected:
         VarIdType mVar1, mVar2;
         CelarOperator mOperator;
         VarType mTargetValue;
         unsigned int mWeight;
+
+        // Value of the constraint when it is satisfied and when it is violated
+        double mSatisfiedWeight, mViolatedWeight;
+        bool mCostsMissing;
 };
 
 class CelarModificationConstraint: public Constraint {
 public:
-        CelarModificationConstraint(VarIdType var, VarType defaultValue, unsigned int weight):
-                mVar(var), mDefaultValue(defaultValue), mWeight(weight) {};
+        CelarModificationConstraint(VarIdType var, VarType defaultValue, unsigned int weight, const CelarCosts * aCosts);
 
         virtual double operator()(Assignment &a) const;
 
@@ -82,24 +131,140 @@ public:
 
         virtual bool hasSupport(VarIdType aVarId, VarType aValue, const CSPProblem &aProblem, const Assignment &aEvidence);
 
-        static std::vector<double> COSTS;
+        /**
+         * The supports do not depend on the domains, one revision is enough
+         */
+        virtual unsigned int getPropagationEvents() const {
+                return 0;
+        };
+
+        /**
+         * Besides the variable, the default value is translated to its value index
+         * (-1 if it is not in the domain of the variable)
+         */
+        virtual void remap(const ProblemMapping & aMapping);
+
+        virtual void addToStore(ConstraintStore & aStore) const;
 protected:
         VarIdType mVar;
         VarType mDefaultValue;
         unsigned int mWeight;
+
+        double mSatisfiedWeight, mViolatedWeight;
+        bool mCostsMissing;
+};
+
+/**
+ * All the interference constraints of a problem. The rows are grouped by the
+ * operator, so that the kernel runs one tight loop per operator.
+ */
+class CelarInterferenceBlock: public ConstraintBlock {
+public:
+        enum { KIND = CONSTRAINT_KIND_CELAR_INTERFERENCE };
+
+        CelarInterferenceBlock(): mCostsMissing(false) {};
+
+        /**
+         * aCostsMissing is set if the weights of the constraint are not known
+         */
+        void addConstraint(VarIdType aVar1, VarIdType aVar2, CelarOperator aOperator, VarType aTargetValue,
+                        double aSatisfiedWeight, double aViolatedWeight, bool aCostsMissing, const ProblemMapping & aMapping);
+
+        virtual size_t size() const {
+                return mVar1.size();
+        };
+
+        virtual void finalize();
+
+        virtual double evalAssignment(const VarType * aValues) const;
+
+        virtual double evalLogAssignment(const VarType * aValues) const;
+
+        /**
+         * The constraints of aVarId are evaluated by a vectorised kernel over all the
+         * candidates at once, the other constraints only once.
+         */
+        virtual void addConditionalLogWeights(VarIdType aVarId, const VarType * aCandidates, size_t aNumCandidates,
+                        VarType * ioValues, double * ioLogWeights) const;
+private:
+        std::vector<VarIdType> mVar1, mVar2;
+        std::vector<CelarOperator> mOperator;
+        std::vector<VarType> mTargetValue;
+
+        // Original values (frequencies) of mVar1 and mVar2 indexed by value index
+        std::vector<const VarType *> mValues1, mValues2;
+
+        // Value of the constraint when it is satisfied and when it is violated
+        std::vector<double> mSatisfiedWeight, mViolatedWeight;
+        std::vector<double> mLogSatisfiedWeight, mLogViolatedWeight;
+
+        // Some of the costs were not loaded, the block can not be evaluated
+        bool mCostsMissing;
+
+        // Rows with operator op are mOperatorOffsets[op] .. mOperatorOffsets[op + 1] - 1
+        size_t mOperatorOffsets[CELAR_OPERATOR_GT + 2];
+
+        // Constraints of each variable: for the variable v, the entries
+        // mVarOffsets[v] .. mVarOffsets[v + 1] - 1 hold the other variable and the row
+        std::vector<size_t> mVarOffsets;
+        std::vector<VarIdType> mVarNeighbours;
+        std::vector<size_t> mVarRows;
+
+        // Original values of each variable indexed by value index
+        std::vector<const VarType *> mVarValues;
+};
+
+/**
+ * All the modification constraints of a problem
+ */
+class CelarModificationBlock: public ConstraintBlock {
+public:
+        enum { KIND = CONSTRAINT_KIND_CELAR_MODIFICATION };
+
+        CelarModificationBlock(): mCostsMissing(false) {};
+
+        void addConstraint(VarIdType aVar, VarType aDefaultValue, double aSatisfiedWeight, double aViolatedWeight,
+                        bool aCostsMissing);
+
+        virtual size_t size() const {
+                return mVar.size();
+        };
+
+        virtual double evalAssignment(const VarType * aValues) const;
+
+        virtual double evalLogAssignment(const VarType * aValues) const;
+
+        virtual void addConditionalLogWeights(VarIdType aVarId, const VarType * aCandidates, size_t aNumCandidates,
+                        VarType * ioValues, double * ioLogWeights) const;
+private:
+        std::vector<VarIdType> mVar;
+        std::vector<VarType> mDefaultValue;
+        std::vector<double> mSatisfiedWeight, mViolatedWeight;
+        std::vector<double> mLogSatisfiedWeight, mLogViolatedWeight;
+
+        // Some of the costs were not loaded, the block can not be evaluated
+        bool mCostsMissing;
 };
 
 /**
  * Functions to load celar data from files
  */
 
-ConstraintList * celar_load_constraints(const char * fileName);
+/**
+ * The soft constraints take their values from costs (0 if the costs were not loaded)
+ */
+ConstraintList * celar_load_constraints(const char * fileName, const CelarCosts * costs);
 
 /**
- * Loads variables and adds possible additional modification constraints
+ * Loads variables and adds possible additional modification constraints.
+ *
+ * The variables are numbered densely (in the order of their ids) and their values
+ * are replaced by value indices; the translation is stored in mapping and all
+ * the constraints are remapped accordingly.
  */
 void celar_load_variables(const char * fileName, const std::vector<Domain> * domains,
-                VariableMap * variables, ConstraintList * constraints);
+                VariableArray * variables, ConstraintList * constraints, ProblemMapping * mapping,
+                const CelarCosts * costs);
 
 /**
  * Loads domains from the specified file
@@ -109,7 +274,7 @@ std::vector<Domain> * celar_load_domains(const char * fileName);
 /**
  * Load costs for CelarModificationConstraint and CelarInterferenceConstraint
  */
-void celar_load_costs(const char * fileName);
+CelarCosts * celar_load_costs(const char * fileName);
 
 #endif // CELAR_H_
 
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "celar_kernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CELAR_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*CelarKernel)(const VarType *, size_t, VarType, CelarOperator, VarType, double, double, double *);
+
+void celar_interference_log_weights_scalar(const VarType * aValues, size_t aNumValues, VarType aOtherValue,
+                CelarOperator aOperator, VarType aTargetValue, double aLogSatisfied, double aLogViolated,
+                double * ioLogWeights) {
+
+        for (size_t k = 0; k < aNumValues; ++k) {
+                VarType diff = abs(aValues[k] - aOtherValue);
+                bool satisfied;
+
+                switch (aOperator) {
+                case CELAR_OPERATOR_EQ:
+                        satisfied = (diff == aTargetValue);
+                        break;
+                case CELAR_OPERATOR_LT:
+                        satisfied = (diff < aTargetValue);
+                        break;
+                default:
+                        satisfied = (diff > aTargetValue);
+                        break;
+                }
+
+                ioLogWeights[k] += satisfied ? aLogSatisfied : aLogViolated;
+        }
+}
+
+#ifdef CELAR_KERNEL_X86
+
+/**
+ * Four values at a time: the comparison mask is widened to 64 bits and selects
+ * (aLogSatisfied - aLogViolated), which is added on top of aLogViolated
+ */
+__attribute__((target("avx2")))
+static void celar_interference_log_weights_avx2(const VarType * aValues, size_t aNumValues, VarType aOtherValue,
+                CelarOperator aOperator, VarType aTargetValue, double aLogSatisfied, double aLogViolated,
+                double * ioLogWeights) {
+
+        const __m128i other = _mm_set1_epi32(aOtherValue);
+        const __m128i target = _mm_set1_epi32(aTargetValue);
+        const __m256d violated = _mm256_set1_pd(aLogViolated);
+        const __m256d delta = _mm256_set1_pd(aLogSatisfied - aLogViolated);
+
+        size_t k = 0;
+        for (; k + 4 <= aNumValues; k += 4) {
+                __m128i diff = _mm_abs_epi32(_mm_sub_epi32(_mm_loadu_si128((const __m128i *)(aValues + k)), other));
+                __m128i mask;
+
+                switch (aOperator) {
+                case CELAR_OPERATOR_EQ:
+                        mask = _mm_cmpeq_epi32(diff, target);
+                        break;
+                case CELAR_OPERATOR_LT:
+                        mask = _mm_cmplt_epi32(diff, target);
+                        break;
+                default:
+                        mask = _mm_cmpgt_epi32(diff, target);
+                        break;
+                }
+
+                __m256d selected = _mm256_and_pd(_mm256_castsi256_pd(_mm256_cvtepi32_epi64(mask)), delta);
+                __m256d weights = _mm256_loadu_pd(ioLogWeights + k);
+                _mm256_storeu_pd(ioLogWeights + k, _mm256_add_pd(weights, _mm256_add_pd(violated, selected)));
+        }
+
+        celar_interference_log_weights_scalar(aValues + k, aNumValues - k, aOtherValue, aOperator, aTargetValue,
+                        aLogSatisfied, aLogViolated, ioLogWeights + k);
+}
+
+/**
+ * Two values at a time, the absolute value is computed as (x ^ s) - s with s = x >> 31
+ */
+__attribute__((target("sse2")))
+static void celar_interference_log_weights_sse2(const VarType * aValues, size_t aNumValues, VarType aOtherValue,
+                CelarOperator aOperator, VarType aTargetValue, double aLogSatisfied, double aLogViolated,
+                double * ioLogWeights) {
+
+        const __m128i other = _mm_set1_epi32(aOtherValue);
+        const __m128i target = _mm_set1_epi32(aTargetValue);
+        const __m128d violated = _mm_set1_pd(aLogViolated);
+        const __m128d delta = _mm_set1_pd(aLogSatisfied - aLogViolated);
+
+        size_t k = 0;
+        for (; k + 2 <= aNumValues; k += 2) {
+                __m128i diff = _mm_sub_epi32(_mm_loadl_epi64((const __m128i *)(aValues + k)), other);
+                __m128i sign = _mm_srai_epi32(diff, 31);
+                diff = _mm_sub_epi32(_mm_xor_si128(diff, sign), sign);
+                __m128i mask;
+
+                switch (aOperator) {
+                case CELAR_OPERATOR_EQ:
+                        mask = _mm_cmpeq_epi32(diff, target);
+                        break;
+                case CELAR_OPERATOR_LT:
+                        mask = _mm_cmplt_epi32(diff, target);
+                        break;
+                default:
+                        mask = _mm_cmpgt_epi32(diff, target);
+                        break;
+                }
+
+                __m128d selected = _mm_and_pd(_mm_castsi128_pd(_mm_unpacklo_epi32(mask, mask)), delta);
+                __m128d weights = _mm_loadu_pd(ioLogWeights + k);
+                _mm_storeu_pd(ioLogWeights + k, _mm_add_pd(weights, _mm_add_pd(violated, selected)));
+        }
+
+        celar_interference_log_weights_scalar(aValues + k, aNumValues - k, aOtherValue, aOperator, aTargetValue,
+                        aLogSatisfied, aLogViolated, ioLogWeights + k);
+}
+
+#endif // CELAR_KERNEL_X86
+
+/**
+ * Selects the best kernel supported by the CPU
+ */
+static CelarKernel celar_select_kernel(const char ** outName) {
+#ifdef CELAR_KERNEL_X86
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2")) {
+                *outName = "avx2";
+                return celar_interference_log_weights_avx2;
+        }
+
+        if (__builtin_cpu_supports("sse2")) {
+                *outName = "sse2";
+                return celar_interference_log_weights_sse2;
+        }
+#endif
+        *outName = "scalar";
+        return celar_interference_log_weights_scalar;
+}
+
+static const char * g_kernelName = 0;
+static CelarKernel g_kernel = celar_select_kernel(&g_kernelName);
+
+void celar_interference_log_weights(const VarType * aValues, size_t aNumValues, VarType aOtherValue,
+                CelarOperator aOperator, VarType aTargetValue, double aLogSatisfied, double aLogViolated,
+                double * ioLogWeights) {
+
+        g_kernel(aValues, aNumValues, aOtherValue, aOperator, aTargetValue, aLogSatisfied, aLogViolated, ioLogWeights);
+}
+
+const char * celar_interference_kernel_name() {
+        return g_kernelName;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CELAR_KERNEL_H_
+#define CELAR_KERNEL_H_
+
+#include <stddef.h>
+
+#include "types.h"
+#include "celar.h"
+
+/**
+ * Adds to ioLogWeights[k] the logarithm of the value of the interference constraint
+ * |aValues[k] - aOtherValue| (aOperator) aTargetValue, i.e. aLogSatisfied or aLogViolated.
+ *
+ * The values are original values (frequencies). Uses AVX2 or SSE2 when the CPU
+ * supports it, the scalar version otherwise.
+ */
+void celar_interference_log_weights(const VarType * aValues, size_t aNumValues, VarType aOtherValue,
+                CelarOperator aOperator, VarType aTargetValue, double aLogSatisfied, double aLogViolated,
+                double * ioLogWeights);
+
+/**
+ * Scalar version of celar_interference_log_weights (also used for the remainders
+ * of the vectorised versions)
+ */
+void celar_interference_log_weights_scalar(const VarType * aValues, size_t aNumValues, VarType aOtherValue,
+                CelarOperator aOperator, VarType aTargetValue, double aLogSatisfied, double aLogViolated,
+                double * ioLogWeights);
+
+/**
+ * Name of the kernel version selected for this CPU ("avx2", "sse2" or "scalar")
+ */
+const char * celar_interference_kernel_name();
+
+#endif // CELAR_KERNEL_H_
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CONFLICT_SET_H_
+#define CONFLICT_SET_H_
+
+#include <assert.h>
+#include <vector>
+
+#include "domain_arena.h"
+
+/**
+ * Set of search depths (of the variables assigned at them), stored as a bit set. It
+ * explains a pruning or a failure: the values would not have been removed without
+ * the assignments at those depths.
+ */
+class ConflictSet {
+public:
+        ConflictSet() {};
+
+        /**
+         * Empty set of the depths 0 .. aNumDepths - 1
+         */
+        explicit ConflictSet(unsigned int aNumDepths):
+                mWords(aNumDepths / DomainArena::WORD_BITS + 1, 0UL) {};
+
+        void insert(unsigned int aDepth) {
+                assert(aDepth / DomainArena::WORD_BITS < mWords.size());
+                mWords[aDepth / DomainArena::WORD_BITS] |= 1UL << (aDepth % DomainArena::WORD_BITS);
+        };
+
+        void erase(unsigned int aDepth) {
+                assert(aDepth / DomainArena::WORD_BITS < mWords.size());
+                mWords[aDepth / DomainArena::WORD_BITS] &= ~(1UL << (aDepth % DomainArena::WORD_BITS));
+        };
+
+        bool contains(unsigned int aDepth) const {
+                return (mWords[aDepth / DomainArena::WORD_BITS] >> (aDepth % DomainArena::WORD_BITS)) & 1UL;
+        };
+
+        /**
+         * Inserts all the depths less than aDepth
+         */
+        void insertBelow(unsigned int aDepth) {
+                for (unsigned int depth = 0; depth < aDepth; ++depth) {
+                        insert(depth);
+                }
+        };
+
+        /**
+         * Inserts all the depths of aSet (of the same size), returns false if there were all already
+         */
+        bool merge(const ConflictSet & aSet) {
+                assert(aSet.mWords.size() == mWords.size());
+
+                bool changed = false;
+                for (size_t i = 0; i < mWords.size(); ++i) {
+                        if (aSet.mWords[i] & ~mWords[i]) {
+                                mWords[i] |= aSet.mWords[i];
+                                changed = true;
+                        }
+                }
+
+                return changed;
+        };
+
+        /**
+         * True if all the depths of aSet (of the same size) are in this set
+         */
+        bool includes(const ConflictSet & aSet) const {
+                assert(aSet.mWords.size() == mWords.size());
+
+                for (size_t i = 0; i < mWords.size(); ++i) {
+                        if (aSet.mWords[i] & ~mWords[i])
+                                return false;
+                }
+
+                return true;
+        };
+
+        /**
+         * The deepest depth in the set, -1 if it is empty
+         */
+        int deepest() const {
+                for (size_t i = mWords.size(); i-- > 0; ) {
+                        if (mWords[i]) {
+                                int bit = DomainArena::WORD_BITS - 1;
+                                while (!((mWords[i] >> bit) & 1UL))
+                                        --bit;
+                                return i * DomainArena::WORD_BITS + bit;
+                        }
+                }
+
+                return -1;
+        };
+
+        bool empty() const {
+                return deepest() < 0;
+        };
+
+        void clear() {
+                mWords.assign(mWords.size(), 0UL);
+        };
+
+        void swap(ConflictSet & aSet) {
+                mWords.swap(aSet.mWords);
+        };
+private:
+        std::vector<unsigned long> mWords;
+};
+
+#endif // CONFLICT_SET_H_
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+#include <math.h>
+
+#include "csp.h"
+#include "constraint_store.h"
+
+void ConstraintBlock::addConditionalLogWeights(VarIdType aVarId, const VarType * aCandidates, size_t aNumCandidates,
+                VarType * ioValues, double * ioLogWeights) const {
+        VarType originalValue = ioValues[aVarId];
+
+        for (size_t k = 0; k < aNumCandidates; ++k) {
+                ioValues[aVarId] = aCandidates[k];
+                ioLogWeights[k] += log(evalAssignment(ioValues));
+        }
+
+        ioValues[aVarId] = originalValue;
+}
+
+double ConstraintBlock::evalLogAssignment(const VarType * aValues) const {
+        return log(evalAssignment(aValues));
+}
+
+void GenericConstraintBlock::finalize() {
+        mScopeOffsets.clear();
+        mScopes.clear();
+
+        for (std::vector<const Constraint *>::const_iterator ctrIt = mConstraints.begin();
+                        ctrIt != mConstraints.end(); ++ctrIt) {
+                Scope s = (*ctrIt)->getScope();
+
+                mScopeOffsets.push_back(mScopes.size());
+                mScopes.insert(mScopes.end(), s.begin(), s.end());
+        }
+        mScopeOffsets.push_back(mScopes.size());
+}
+
+double GenericConstraintBlock::evalAssignment(const VarType * aValues) const {
+        assert(mScopeOffsets.size() == mConstraints.size() + 1);
+
+        double result = 1.0;
+        Assignment a;
+
+        for (size_t i = 0; i < mConstraints.size(); ++i) {
+                a.clear();
+                for (size_t j = mScopeOffsets[i]; j < mScopeOffsets[i + 1]; ++j) {
+                        a[mScopes[j]] = aValues[mScopes[j]];
+                }
+
+                result *= (*mConstraints[i])(a);
+        }
+
+        return result;
+}
+
+double GenericConstraintBlock::evalLogAssignment(const VarType * aValues) const {
+        assert(mScopeOffsets.size() == mConstraints.size() + 1);
+
+        double result = 0.0;
+        Assignment a;
+
+        for (size_t i = 0; i < mConstraints.size(); ++i) {
+                a.clear();
+                for (size_t j = mScopeOffsets[i]; j < mScopeOffsets[i + 1]; ++j) {
+                        a[mScopes[j]] = aValues[mScopes[j]];
+                }
+
+                result += log((*mConstraints[i])(a));
+        }
+
+        return result;
+}
+
+ConstraintStore::~ConstraintStore() {
+        for (std::map<int, ConstraintBlock *>::iterator blockIt = mBlocks.begin(); blockIt != mBlocks.end(); ++blockIt) {
+                delete blockIt->second;
+        }
+}
+
+void ConstraintStore::finalize() {
+        for (std::map<int, ConstraintBlock *>::iterator blockIt = mBlocks.begin(); blockIt != mBlocks.end(); ++blockIt) {
+                blockIt->second->finalize();
+        }
+}
+
+double ConstraintStore::evalAssignment(const VarType * aValues) const {
+        double result = 1.0;
+        for (std::map<int, ConstraintBlock *>::const_iterator blockIt = mBlocks.begin(); blockIt != mBlocks.end(); ++blockIt) {
+                result *= blockIt->second->evalAssignment(aValues);
+        }
+
+        return result;
+}
+
+double ConstraintStore::evalLogAssignment(const VarType * aValues) const {
+        double result = 0.0;
+        for (std::map<int, ConstraintBlock *>::const_iterator blockIt = mBlocks.begin(); blockIt != mBlocks.end(); ++blockIt) {
+                result += blockIt->second->evalLogAssignment(aValues);
+        }
+
+        return result;
+}
+
+void ConstraintStore::conditionalLogWeights(VarIdType aVarId, const VarType * aCandidates, size_t aNumCandidates,
+                VarType * ioValues, double * outLogWeights) const {
+        for (size_t k = 0; k < aNumCandidates; ++k) {
+                outLogWeights[k] = 0.0;
+        }
+
+        for (std::map<int, ConstraintBlock *>::const_iterator blockIt = mBlocks.begin(); blockIt != mBlocks.end(); ++blockIt) {
+                blockIt->second->addConditionalLogWeights(aVarId, aCandidates, aNumCandidates, ioValues, outLogWeights);
+        }
+}
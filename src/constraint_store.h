@@ -0,0 +1,173 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CONSTRAINT_STORE_H_
+#define CONSTRAINT_STORE_H_
+
+#include <map>
+#include <vector>
+
+#include "types.h"
+
+class Constraint;
+
+/**
+ * Kinds of constraint blocks in the ConstraintStore. Every kind of constraint which
+ * has a batched kernel has its own block, all the other constraints end up
+ * in the generic block.
+ */
+enum ConstraintKind {
+        CONSTRAINT_KIND_GENERIC,
+        CONSTRAINT_KIND_CELAR_INTERFERENCE,
+        CONSTRAINT_KIND_CELAR_MODIFICATION,
+        CONSTRAINT_KIND_INTEL_EQUALITY,
+        CONSTRAINT_KIND_INTEL_INEQUALITY,
+        CONSTRAINT_KIND_INTEL_INTERVALS_NOT_EQUAL,
+        CONSTRAINT_KIND_INTEL_EQUAL_TO_CONSTANT,
+        CONSTRAINT_KIND_WCSP
+};
+
+/**
+ * A block of constraints of a single kind, stored contiguously as a structure of
+ * arrays and evaluated by a single kernel
+ */
+class ConstraintBlock {
+public:
+        virtual ~ConstraintBlock() {};
+
+        /**
+         * Number of constraints in the block
+         */
+        virtual size_t size() const = 0;
+
+        /**
+         * Called once after all the constraints have been added
+         */
+        virtual void finalize() {};
+
+        /**
+         * Product of all the constraints in the block given a complete assignment
+         * (aValues[i] is the value index of the variable i)
+         */
+        virtual double evalAssignment(const VarType * aValues) const = 0;
+
+        /**
+         * Sum of the logarithms of the constraints in the block given a complete assignment
+         * (-HUGE_VAL if one of them is zero). The product of evalAssignment underflows for
+         * many small values, the sum does not.
+         *
+         * The default implementation is the logarithm of evalAssignment.
+         */
+        virtual double evalLogAssignment(const VarType * aValues) const;
+
+        /**
+         * Adds the logarithm of the product of the constraints in the block to ioLogWeights[k],
+         * for the variable aVarId being set to aCandidates[k] and the other variables
+         * being assigned by ioValues (ioValues[aVarId] is the same on return).
+         *
+         * The default implementation evaluates the whole block for every candidate.
+         */
+        virtual void addConditionalLogWeights(VarIdType aVarId, const VarType * aCandidates, size_t aNumCandidates,
+                        VarType * ioValues, double * ioLogWeights) const;
+};
+
+/**
+ * Block for constraints without a specialised kernel, evaluated through
+ * Constraint::operator()
+ */
+class GenericConstraintBlock: public ConstraintBlock {
+public:
+        enum { KIND = CONSTRAINT_KIND_GENERIC };
+
+        void addConstraint(const Constraint * aConstraint) {
+                mConstraints.push_back(aConstraint);
+        };
+
+        virtual size_t size() const {
+                return mConstraints.size();
+        };
+
+        virtual void finalize();
+
+        virtual double evalAssignment(const VarType * aValues) const;
+
+        virtual double evalLogAssignment(const VarType * aValues) const;
+private:
+        std::vector<const Constraint *> mConstraints;
+
+        /**
+         * Scopes of the constraints, mScopes[mScopeOffsets[i]] .. mScopes[mScopeOffsets[i + 1] - 1]
+         */
+        std::vector<size_t> mScopeOffsets;
+        std::vector<VarIdType> mScopes;
+};
+
+/**
+ * Constraints of a problem grouped by their kind
+ */
+class ConstraintStore {
+public:
+        ConstraintStore() {};
+
+        ~ConstraintStore();
+
+        /**
+         * Returns the block of a given type (which is created when needed)
+         */
+        template<class Block> Block * getBlock() {
+                ConstraintBlock *& block = mBlocks[Block::KIND];
+                if (!block)
+                        block = new Block();
+
+                return static_cast<Block *>(block);
+        };
+
+        /**
+         * Finalizes all the blocks, has to be called before the evaluation
+         */
+        void finalize();
+
+        /**
+         * Product of all the constraints given a complete assignment
+         */
+        double evalAssignment(const VarType * aValues) const;
+
+        /**
+         * Logarithm of the product of all the constraints given a complete assignment, summed
+         * over the blocks (see ConstraintBlock::evalLogAssignment)
+         */
+        double evalLogAssignment(const VarType * aValues) const;
+
+        /**
+         * Logarithms of the products of all the constraints for the variable aVarId being
+         * set to each of aCandidates (see ConstraintBlock::addConditionalLogWeights)
+         */
+        void conditionalLogWeights(VarIdType aVarId, const VarType * aCandidates, size_t aNumCandidates,
+                        VarType * ioValues, double * outLogWeights) const;
+private:
+        // The store is never copied
+        ConstraintStore(const ConstraintStore &);
+        ConstraintStore & operator=(const ConstraintStore &);
+
+        std::map<int, ConstraintBlock *> mBlocks;
+};
+
+#endif // CONSTRAINT_STORE_H_
@@ -20,7 +20,10 @@
  */
 
 #include <assert.h>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <math.h>
 #include <sstream>
 
 #include <queue>
@@ -28,53 +31,248 @@
 #include "csp.h"
 #include "utils.h"
 
-Variable::Variable(const VarIdType &id, VarType aMinValue, VarType aMaxValue):
-        mId(id) {
-        mDomain = new Domain();
-
-        for (VarType i = aMinValue; i <= aMaxValue; ++i) {
-                mDomain->insert(i);
-        }
-}
-
-
-CSPProblem::CSPProblem(VariableMap *v, ConstraintList *c):
-        mVariables(v), mConstraints(c) {
-        assert(v);
+ProblemModel::ProblemModel(const VariableArray & aVariables, ConstraintList *c, ProblemMapping *m):
+        mConstraints(c), mMapping(m), mNumResidues(0), mStore(new ConstraintStore()) {
         assert(c);
+        assert(m);
 
-        // Initialize the constraint map
+        // Store the scopes and count the arcs of every variable
+        mArcOffsets.assign(aVariables.size() + 1, 0);
+        mScopeOffsets.push_back(0);
         for (ConstraintList::iterator constIt = mConstraints->begin(); constIt != mConstraints->end(); ++constIt) {
                 Scope s = (*constIt)->getScope();
                 for (Scope::const_iterator scopeIt = s.begin(); scopeIt != s.end(); ++scopeIt) {
-                        mConstraintMap[*scopeIt].push_back(*constIt);
+                        assert(*scopeIt < aVariables.size());
+                        mScopeVars.push_back(*scopeIt);
+                        ++mArcOffsets[*scopeIt + 1];
+                }
+                mScopeOffsets.push_back(mScopeVars.size());
+
+                if (s.empty())
+                        mEmptyScopeConstraints.push_back(constIt - mConstraints->begin());
+
+                (*constIt)->addToStore(*mStore);
+        }
+        mStore->finalize();
+
+        // Build the arcs, the constraints of each variable are in the order of mConstraints
+        for (size_t v = 0; v < aVariables.size(); ++v) {
+                mArcOffsets[v + 1] += mArcOffsets[v];
+        }
+
+        std::vector<size_t> position(mArcOffsets.begin(), mArcOffsets.end() - 1);
+        mArcConstraints.resize(mScopeVars.size());
+        mArcPositions.resize(mScopeVars.size());
+        mArcVars.resize(mScopeVars.size());
+        mScopeArcs.resize(mScopeVars.size());
+        for (size_t c = 0; c < mConstraints->size(); ++c) {
+                for (size_t i = mScopeOffsets[c]; i < mScopeOffsets[c + 1]; ++i) {
+                        size_t arc = position[mScopeVars[i]]++;
+                        mArcConstraints[arc] = c;
+                        mArcPositions[arc] = i - mScopeOffsets[c];
+                        mArcVars[arc] = mScopeVars[i];
+                        mScopeArcs[i] = arc;
+                }
+        }
+
+        // Only the arcs of the hard binary constraints have residual supports
+        mResidueOffsets.assign(mArcConstraints.size(), 0);
+        for (size_t arc = 0; arc < mArcConstraints.size(); ++arc) {
+                mResidueOffsets[arc] = mNumResidues;
+                const Constraint * c = (*mConstraints)[mArcConstraints[arc]];
+                if (c->isHardBinary() && !c->revisesDomains()) {
+                        assert(mScopeOffsets[mArcConstraints[arc] + 1] - mScopeOffsets[mArcConstraints[arc]] == 2);
+                        mNumResidues += aVariables[mArcVars[arc]]->getDomain()->getNumValues();
                 }
         }
-};
 
-CSPProblem::~CSPProblem() {
         for (ConstraintList::iterator constIt = mConstraints->begin(); constIt != mConstraints->end(); ++constIt) {
-                delete *constIt;
+                mConstraintEvents.push_back((*constIt)->getPropagationEvents());
+                mConstraintPriorities.push_back((*constIt)->getPropagationPriority());
+                assert(mConstraintPriorities.back() < NUM_PROPAGATION_PRIORITIES);
         }
+}
 
-        for (VariableMap::iterator varIt = mVariables->begin(); varIt != mVariables->end(); ++varIt) {
-                delete varIt->second;
+ProblemModel::~ProblemModel() {
+        for (ConstraintList::iterator constIt = mConstraints->begin(); constIt != mConstraints->end(); ++constIt) {
+                delete *constIt;
         }
 
         delete mConstraints;
-        delete mVariables;
+        delete mMapping;
+        delete mStore;
+}
+
+SearchState::SearchState(const ProblemModel & aModel, VariableArray * aVariables):
+        mVariables(aVariables), mResidues(aModel.getNumResidues(), -1), mArcQueued(aModel.getNumArcs(), false),
+        mConstraintWeights(aModel.getNumConstraints(), 1), mTrackConflicts(false) {
+        assert(aVariables);
+        assert(aVariables->size() == aModel.getNumVariables());
+}
+
+SearchState::SearchState(const SearchState & aState):
+        mVariables(new VariableArray(*aState.mVariables)), mResidues(aState.mResidues),
+        mArcQueued(aState.mArcQueued.size(), false), mConstraintWeights(aState.mConstraintWeights),
+        mTrackConflicts(aState.mTrackConflicts), mAssignmentDepths(aState.mAssignmentDepths),
+        mConflicts(aState.mConflicts), mConflictTrail(aState.mConflictTrail),
+        mFailureConflict(aState.mFailureConflict), mRevisionReason(aState.mRevisionReason) {
+}
+
+CSPProblem::CSPProblem(VariableArray *v, ConstraintList *c, ProblemMapping *m):
+        mModel(0), mState(0), mOwnsModel(true) {
+        assert(v);
+
+        ProblemModel * model = new ProblemModel(*v, c, m);
+        mModel = model;
+        mState = new SearchState(*model, v);
+}
+
+CSPProblem::CSPProblem(const ProblemModel * aModel, SearchState * aState):
+        mModel(aModel), mState(aState), mOwnsModel(false) {
+        assert(aModel);
+        assert(aState);
+}
+
+CSPProblem::~CSPProblem() {
+        delete mState;
+
+        if (mOwnsModel)
+                delete mModel;
+}
+
+void CSPProblem::getConstraintsWithinScope(const Scope & aScope, std::vector<size_t> & outConstraints) const {
+        outConstraints = mModel->getEmptyScopeConstraints();
+
+        for (Scope::const_iterator varIt = aScope.begin(); varIt != aScope.end(); ++varIt) {
+                for (size_t arc = getArcsBegin(*varIt); arc != getArcsEnd(*varIt); ++arc) {
+                        size_t c = getArcConstraint(arc);
+
+                        // Every constraint is added only through the first variable of its scope
+                        if (*getScopeBegin(c) != *varIt)
+                                continue;
+
+                        bool within = true;
+                        for (const VarIdType * scIt = getScopeBegin(c); scIt != getScopeEnd(c); ++scIt) {
+                                if (aScope.find(*scIt) == aScope.end()) {
+                                        within = false;
+                                        break;
+                                }
+                        }
+
+                        if (within)
+                                outConstraints.push_back(c);
+                }
+        }
+
+        std::sort(outConstraints.begin(), outConstraints.end());
 }
 
 double CSPProblem::evalAssignment(Assignment &a) const {
+        if (a.size() == mState->mVariables->size()) {
+                // Complete assignment, evaluate it through the constraint store
+                FlatAssignment values(mState->mVariables->size());
+                for (Assignment::const_iterator aIt = a.begin(); aIt != a.end(); ++aIt) {
+                        assert(aIt->first < values.size());
+                        values[aIt->first] = aIt->second;
+                }
 
+                return evalAssignment(values);
+        }
+
+        const ConstraintList * constraints = getConstraints();
         double evaluation = 1.0;
-        for (ConstraintList::const_iterator constIt = mConstraints->begin(); constIt != mConstraints->end(); ++constIt) {
+        for (ConstraintList::const_iterator constIt = constraints->begin(); constIt != constraints->end(); ++constIt) {
                 evaluation *= (**constIt)(a);
         }
 
         return evaluation;
 }
 
+double CSPProblem::evalLogAssignment(Assignment &a) const {
+        if (a.size() == mState->mVariables->size()) {
+                FlatAssignment values(mState->mVariables->size());
+                for (Assignment::const_iterator aIt = a.begin(); aIt != a.end(); ++aIt) {
+                        assert(aIt->first < values.size());
+                        values[aIt->first] = aIt->second;
+                }
+
+                return evalLogAssignment(values);
+        }
+
+        const ConstraintList * constraints = getConstraints();
+        double evaluation = 0.0;
+        for (ConstraintList::const_iterator constIt = constraints->begin(); constIt != constraints->end(); ++constIt) {
+                evaluation += log((**constIt)(a));
+        }
+
+        return evaluation;
+}
+
+/**
+ * One step of the FNV-1a hash over the bytes of a value
+ */
+template <typename T>
+static void hash_bytes(unsigned long & ioHash, const T & aValue) {
+        unsigned char bytes[sizeof(T)];
+        memcpy(bytes, &aValue, sizeof(T));
+
+        for (size_t i = 0; i < sizeof(T); ++i) {
+                ioHash = (ioHash ^ bytes[i]) * 16777619UL;
+        }
+}
+
+unsigned long CSPProblem::getContentHash() const {
+        const ProblemMapping * mapping = getMapping();
+        unsigned long hash = 2166136261UL;
+
+        for (VarIdType varId = 0; varId < mapping->getNumVariables(); ++varId) {
+                hash_bytes(hash, mapping->getOriginalId(varId));
+
+                const std::vector<VarType> & values = mapping->getOriginalValues(varId);
+                hash_bytes(hash, values.size());
+                for (std::vector<VarType>::const_iterator valIt = values.begin(); valIt != values.end(); ++valIt) {
+                        hash_bytes(hash, *valIt);
+                }
+        }
+
+        for (size_t ctr = 0; ctr < getNumConstraints(); ++ctr) {
+                const VarIdType * scopeBegin = getScopeBegin(ctr);
+                const VarIdType * scopeEnd = getScopeEnd(ctr);
+
+                double numTuples = 1.0;
+                for (const VarIdType * scIt = scopeBegin; scIt != scopeEnd; ++scIt) {
+                        hash_bytes(hash, mapping->getOriginalId(*scIt));
+                        numTuples *= mapping->getDomainSize(*scIt);
+                }
+
+                // All the tuples in the lexicographic order if there are few of them, otherwise a
+                // fixed pseudo-random sequence (a linear congruential generator seeded by the constraint)
+                bool enumerate = numTuples <= PROBLEM_HASH_TUPLES;
+                unsigned long seed = ctr + 1;
+                Assignment tuple;
+
+                for (unsigned int t = 0; t < PROBLEM_HASH_TUPLES && t < numTuples; ++t) {
+                        unsigned long rest = t;
+                        for (const VarIdType * scIt = scopeEnd; scIt != scopeBegin; ) {
+                                --scIt;
+                                size_t domainSize = mapping->getDomainSize(*scIt);
+
+                                if (enumerate) {
+                                        tuple[*scIt] = rest % domainSize;
+                                        rest /= domainSize;
+                                } else {
+                                        seed = seed * 1103515245UL + 12345UL;
+                                        tuple[*scIt] = (seed >> 8) % domainSize;
+                                }
+                        }
+
+                        hash_bytes(hash, (*getConstraint(ctr))(tuple));
+                }
+        }
+
+        return hash;
+}
+
 bool scope_compare_size(const Scope & a, const Scope & b) {
         return a.size() > b.size();
 }
@@ -89,7 +287,8 @@ void CSPProblem::schematicMiniBucket(unsigned int aMaxBucketSize, const std::vec
         std::vector<Bucket> buckets(aOrdering.size());
         aMiniBuckets->resize(aOrdering.size());
         std::set<Scope> scopes;
-        for (ConstraintList::iterator ctrIt = this->mConstraints->begin(); ctrIt != this->mConstraints->end(); ++ctrIt) {
+        const ConstraintList * constraints = getConstraints();
+        for (ConstraintList::const_iterator ctrIt = constraints->begin(); ctrIt != constraints->end(); ++ctrIt) {
                 Scope s = (*ctrIt)->getScope();
                 scopes.insert(s);
         }
@@ -282,7 +481,7 @@ void Constraint::initDomainIntervals(CSPProblem &aProblem, unsigned int aMaxInte
         mDomainIntervals.clear();
 
         std::map<VarIdType, std::map<VarType, double> > varProbabilities;
-        double totalProbability;
+        double totalProbability = 0.0;
         Assignment a;
         
         // First store probabilities for each of the variables in
@@ -306,7 +505,7 @@ void Constraint::initDomainIntervals(CSPProblem &aProblem, unsigned int aMaxInte
 
                 for (Scope::const_iterator scopeIt = scope.begin(); scopeIt != scope.end(); ++scopeIt) {
                         const Variable * var = aProblem.getVariableById(*scopeIt);
-                        const Domain * domain = var->getDomain();
+                        const DomainView * domain = var->getDomain();
 
                         std::map<VarType, double> & varProbTable = varProbabilities[*scopeIt];
                         for (std::map<VarType, double>::iterator probIt = varProbTable.begin();
@@ -359,8 +558,8 @@ void Constraint::_initDomainIntervalsInternal(Scope &aScope, const CSPProblem &a
         } else {
                 const Variable * var = aProblem.getVariableById(*(aScope.begin()));
                 aScope.erase(aScope.begin());
-                const Domain * domain = var->getDomain();
-                for (Domain::const_iterator domIt = domain->begin(); domIt != domain->end(); ++domIt) {
+                const DomainView * domain = var->getDomain();
+                for (DomainView::const_iterator domIt = domain->begin(); domIt != domain->end(); ++domIt) {
                         aAssignment[var->getId()] = *domIt;
 
                         _initDomainIntervalsInternal(aScope, aProblem, aAssignment, outVarProbabilities,
@@ -373,24 +572,41 @@ void Constraint::_initDomainIntervalsInternal(Scope &aScope, const CSPProblem &a
         }
 }
 
-bool CSPProblem::propagateConstraints(Assignment &aEvidence, std::map<VarIdType, Domain> & outRemovedValues) {
-        // Add all constraints into the queue
-        std::set<std::pair<Constraint *, VarIdType> > constraintQueue;
+bool Constraint::findSupport(VarIdType aVarId, VarType aValue, const DomainView & aOtherDomain,
+                VarType & ioSupport) const {
+        // Values removed before the previous support may have been restored since, so wrap around
+        DomainView::const_iterator start = aOtherDomain.upper_bound(ioSupport);
+
+        for (DomainView::const_iterator domIt = start; domIt != aOtherDomain.end(); ++domIt) {
+                if (isCompatible(aVarId, aValue, *domIt)) {
+                        ioSupport = *domIt;
+                        return true;
+                }
+        }
 
-        // Initialize the queue with all of the constraints
-        for (ConstraintList::iterator ctrIt = mConstraints->begin();
-                        ctrIt != mConstraints->end(); ++ctrIt) {
+        for (DomainView::const_iterator domIt = aOtherDomain.begin(); domIt != start; ++domIt) {
+                if (isCompatible(aVarId, aValue, *domIt)) {
+                        ioSupport = *domIt;
+                        return true;
+                }
+        }
 
-                Scope s = (*ctrIt)->getScope();
+        return false;
+}
 
-                for (Scope::const_iterator scopeIt = s.begin(); scopeIt != s.end(); ++scopeIt) {
-                        // Add the variable for revision only if it is not in the evidence
-                        if (aEvidence.find(*scopeIt) == aEvidence.end())
-                                constraintQueue.insert(std::make_pair(*ctrIt, *scopeIt));
+bool CSPProblem::propagateConstraints(Assignment &aEvidence, std::map<VarIdType, Domain> & outRemovedValues) {
+        // Initialize the queue with all of the constraints which can remove some values
+        for (size_t c = 0; c < mModel->getNumConstraints(); ++c) {
+                if (mModel->getConstraint(c)->isSoft())
+                        continue;
+
+                unsigned int arity = getScopeEnd(c) - getScopeBegin(c);
+                for (unsigned int i = 0; i < arity; ++i) {
+                        _enqueueArc(mModel->getScopeArc(c, i), aEvidence);
                 }
         }
 
-        return _propagateConstraintsInternal(aEvidence, constraintQueue, outRemovedValues);
+        return _propagateConstraintsInternal(aEvidence, outRemovedValues);
 }
 
 /**
@@ -400,89 +616,249 @@ bool CSPProblem::propagateConstraints(Assignment &aEvidence, std::map<VarIdType,
 bool CSPProblem::propagateConstraints(Assignment &aEvidence, 
                 std::map<VarIdType, Domain> & outRemovedValues, VarIdType aChangedVariable) {
 
-        std::set<std::pair<Constraint *, VarIdType> > constraintQueue;
-
         // Initialize the queue of constraints from the list of constraints which
         // have the aChangedVariable in their scopes
-        for (ConstraintList::iterator ctrIt = mConstraintMap[aChangedVariable].begin();
-                        ctrIt != mConstraintMap[aChangedVariable].end(); ++ctrIt) {
+        _enqueueNeighbours(aChangedVariable, aEvidence, DOMAIN_EVENT_VALUE | DOMAIN_EVENT_BOUNDS | DOMAIN_EVENT_ASSIGNED);
 
-                Scope s = (*ctrIt)->getScope();
-                s.erase(aChangedVariable);
+        return _propagateConstraintsInternal(aEvidence, outRemovedValues);
+}
 
-                for (Scope::const_iterator scopeIt = s.begin(); scopeIt != s.end(); ++scopeIt) {
-                        // Add the variable for revision only if it is not in the evidence
-                        if (aEvidence.find(*scopeIt) == aEvidence.end())
-                                constraintQueue.insert(std::make_pair(*ctrIt, *scopeIt));
+void CSPProblem::_enqueueArc(size_t aArc, const Assignment & aEvidence) {
+        // Add the variable for revision only if it is not in the evidence
+        if (!mState->mArcQueued[aArc] && aEvidence.find(mModel->getArcVariable(aArc)) == aEvidence.end()) {
+                mState->mArcQueued[aArc] = true;
+                mState->mArcQueues[mModel->getConstraintPriority(getArcConstraint(aArc))].push_back(aArc);
+        }
+}
+
+bool CSPProblem::_dequeueArc(size_t & outArc) {
+        for (unsigned int priority = 0; priority < NUM_PROPAGATION_PRIORITIES; ++priority) {
+                std::deque<size_t> & queue = mState->mArcQueues[priority];
+                if (!queue.empty()) {
+                        outArc = queue.front();
+                        queue.pop_front();
+                        mState->mArcQueued[outArc] = false;
+                        return true;
                 }
         }
 
-        return _propagateConstraintsInternal(aEvidence, constraintQueue, outRemovedValues);
+        return false;
 }
 
-bool CSPProblem::_propagateConstraintsInternal(Assignment &aEvidence, 
-                std::set<std::pair<Constraint *, VarIdType> > & aConstraintQueue,
-                std::map<VarIdType, Domain> & outRemovedValues) {
+void CSPProblem::_enqueueNeighbours(VarIdType aVarId, const Assignment & aEvidence, unsigned int aEvents) {
+        for (size_t arc = getArcsBegin(aVarId); arc != getArcsEnd(aVarId); ++arc) {
+                size_t c = getArcConstraint(arc);
+
+                if (!(mModel->getConstraintEvents(c) & aEvents))
+                        continue;
 
-        while (!aConstraintQueue.empty()) {
-                std::set<std::pair<Constraint *, VarIdType> >::iterator queueIt = aConstraintQueue.begin();
-                aConstraintQueue.erase(queueIt);
+                const VarIdType * scopeBegin = getScopeBegin(c);
+                unsigned int arity = getScopeEnd(c) - scopeBegin;
+                for (unsigned int i = 0; i < arity; ++i) {
+                        if (scopeBegin[i] != aVarId)
+                                _enqueueArc(mModel->getScopeArc(c, i), aEvidence);
+                }
+        }
+}
 
-                bool domainChanged = false;
+bool CSPProblem::_propagateConstraintsInternal(Assignment &aEvidence, 
+                std::map<VarIdType, Domain> & outRemovedValues) {
 
-                Constraint * c = queueIt->first;
-                VarIdType varId = queueIt->second;
+        size_t arc;
+        while (_dequeueArc(arc)) {
+                VarIdType varId = mModel->getArcVariable(arc);
+                const DomainView *d = getVariableById(varId)->getDomain();
 
-                const Domain *d = getVariableById(varId)->getDomain();
+                // Bounds before the revision (an empty domain fails below)
+                VarType minValue = d->empty() ? 0 : *d->begin();
+                VarType maxValue = d->empty() ? 0 : *d->rbegin();
 
                 // Revise the selected constraint
-                Domain::const_iterator domIt = d->begin();
-                while (domIt != d->end()) {
-                        VarType value = *domIt;
-                        // Check support for the value, and if there is no support, remove that variable
-                        if (!c->hasSupport(varId, value, *this, aEvidence)) {
-                                domainChanged = true;
-
-                                // Remove the variable
-                                (*mVariables)[varId]->eraseFromDomain(value);
-                                outRemovedValues[varId].insert(value);
-
-                                domIt = d->lower_bound(value); // Restore the iterator (which was invalidated by the erase)
-                                continue;
-                        }
-                        ++domIt;
-                }
+                bool domainChanged = getConstraint(getArcConstraint(arc))->isHardBinary() ?
+                        _reviseBinaryArc(arc, aEvidence, outRemovedValues) :
+                        _reviseArc(arc, aEvidence, outRemovedValues);
+
+                if (mState->mTrackConflicts && (domainChanged || d->empty()))
+                        _explainRevision(arc);
 
                 if (d->empty()) {
+                        ++mState->mConstraintWeights[getArcConstraint(arc)];
+
+                        if (mState->mTrackConflicts)
+                                mState->mFailureConflict = mState->mConflicts[varId];
+
                         // If the domain becomes empty, end the propagation with failure
+                        while (_dequeueArc(arc))
+                                ;
                         return false;
                 }
 
-
                 if (domainChanged) {
-                        // Add all constraints with the scope of the current variable to the queue
-                        for (ConstraintList::iterator ctrIt = mConstraintMap[varId].begin();
-                                        ctrIt != mConstraintMap[varId].end(); ++ctrIt) {
-                                Scope s = (*ctrIt)->getScope();
-                                s.erase(varId);
-                                
-                                for (Scope::iterator scopeIt = s.begin(); scopeIt != s.end(); ++scopeIt) {
-                                        if (aEvidence.find(*scopeIt) == aEvidence.end())
-                                                aConstraintQueue.insert(std::make_pair(*ctrIt, *scopeIt));
-
-                                }
-                        }
+                        unsigned int events = DOMAIN_EVENT_VALUE;
+                        if (*d->begin() != minValue || *d->rbegin() != maxValue)
+                                events |= DOMAIN_EVENT_BOUNDS;
+                        if (d->size() == 1)
+                                events |= DOMAIN_EVENT_ASSIGNED;
+
+                        // Add the constraints with the scope of the current variable to the queue
+                        _enqueueNeighbours(varId, aEvidence, events);
                 }
         }
         return true;
 }
 
+void CSPProblem::trackConflicts() {
+        if (mState->mTrackConflicts)
+                return;
+
+        unsigned int numVariables = mState->mVariables->size();
+
+        mState->mTrackConflicts = true;
+        mState->mAssignmentDepths.assign(numVariables, -1);
+        mState->mConflicts.assign(numVariables, ConflictSet(numVariables));
+        mState->mFailureConflict = ConflictSet(numVariables);
+        mState->mRevisionReason = ConflictSet(numVariables);
+}
+
+void CSPProblem::restoreConflicts(size_t aTrailSize) {
+        while (mState->mConflictTrail.size() > aTrailSize) {
+                std::pair<VarIdType, ConflictSet> & entry = mState->mConflictTrail.back();
+                mState->mConflicts[entry.first].swap(entry.second);
+                mState->mConflictTrail.pop_back();
+        }
+}
+
+void CSPProblem::_explainRevision(size_t aArc) {
+        VarIdType varId = mModel->getArcVariable(aArc);
+        size_t c = getArcConstraint(aArc);
+        ConflictSet & reason = mState->mRevisionReason;
+
+        reason.clear();
+        for (const VarIdType * scIt = getScopeBegin(c); scIt != getScopeEnd(c); ++scIt) {
+                if (*scIt == varId)
+                        continue;
+
+                // The domain of an assigned variable is explained by the assignment alone
+                if (mState->mAssignmentDepths[*scIt] >= 0)
+                        reason.insert(mState->mAssignmentDepths[*scIt]);
+                else
+                        reason.merge(mState->mConflicts[*scIt]);
+        }
+
+        explainRemoval(varId, reason);
+}
+
+void CSPProblem::explainRemoval(VarIdType aVarId, const ConflictSet & aReason) {
+        ConflictSet & conflict = mState->mConflicts[aVarId];
+        if (!conflict.includes(aReason)) {
+                mState->mConflictTrail.push_back(std::make_pair(aVarId, conflict));
+                conflict.merge(aReason);
+        }
+}
+
+bool CSPProblem::_reviseArc(size_t aArc, Assignment & aEvidence, std::map<VarIdType, Domain> & outRemovedValues) {
+        Constraint * c = getConstraint(getArcConstraint(aArc));
+        VarIdType varId = mModel->getArcVariable(aArc);
+        const DomainView *d = getVariableById(varId)->getDomain();
+        bool domainChanged = false;
+
+        if (c->revisesDomains()) {
+                mState->mUnsupportedValues.clear();
+                c->filterDomain(varId, *this, aEvidence, mState->mUnsupportedValues);
+
+                for (std::vector<VarType>::const_iterator valIt = mState->mUnsupportedValues.begin();
+                                valIt != mState->mUnsupportedValues.end(); ++valIt) {
+                        (*mState->mVariables)[varId]->eraseFromDomain(*valIt);
+                        outRemovedValues[varId].insert(*valIt);
+                }
+
+                return !mState->mUnsupportedValues.empty();
+        }
+
+        DomainView::const_iterator domIt = d->begin();
+        while (domIt != d->end()) {
+                VarType value = *domIt;
+                // Check support for the value, and if there is no support, remove that variable
+                if (!c->hasSupport(varId, value, *this, aEvidence)) {
+                        domainChanged = true;
+
+                        // Remove the variable
+                        (*mState->mVariables)[varId]->eraseFromDomain(value);
+                        outRemovedValues[varId].insert(value);
+
+                        domIt = d->lower_bound(value); // Restore the iterator (which was invalidated by the erase)
+                        continue;
+                }
+                ++domIt;
+        }
+
+        return domainChanged;
+}
+
+bool CSPProblem::_reviseBinaryArc(size_t aArc, const Assignment & aEvidence, std::map<VarIdType, Domain> & outRemovedValues) {
+        const Constraint * c = getConstraint(getArcConstraint(aArc));
+        VarIdType varId = mModel->getArcVariable(aArc);
+        VarIdType otherVarId = getScopeBegin(getArcConstraint(aArc))[1 - getArcPosition(aArc)];
+
+        const DomainView *d = getVariableById(varId)->getDomain();
+        const DomainView *otherDomain = getVariableById(otherVarId)->getDomain();
+        Assignment::const_iterator evidenceIt = aEvidence.find(otherVarId);
+        bool domainChanged = false;
+
+        if (evidenceIt == aEvidence.end() && c->revisesDomains()) {
+                mState->mUnsupportedValues.clear();
+                c->reviseDomain(varId, *d, *otherDomain, mState->mUnsupportedValues);
+
+                for (std::vector<VarType>::const_iterator valIt = mState->mUnsupportedValues.begin();
+                                valIt != mState->mUnsupportedValues.end(); ++valIt) {
+                        (*mState->mVariables)[varId]->eraseFromDomain(*valIt);
+                        outRemovedValues[varId].insert(*valIt);
+                }
+
+                return !mState->mUnsupportedValues.empty();
+        }
+
+        // The residues are only used without evidence (the arcs revising whole domains have none)
+        VarType * residues = 0;
+        if (evidenceIt == aEvidence.end())
+                residues = &mState->mResidues[mModel->getResidueOffset(aArc)];
+
+        DomainView::const_iterator domIt = d->begin();
+        while (domIt != d->end()) {
+                VarType value = *domIt;
+                bool supported;
+
+                if (evidenceIt != aEvidence.end()) {
+                        // Only the value in the evidence can support the value
+                        supported = c->isCompatible(varId, value, evidenceIt->second);
+                } else {
+                        // The last support is still valid if it has not been removed, otherwise look for another one
+                        VarType & residue = residues[value];
+                        supported = (residue >= 0 && otherDomain->count(residue)) ||
+                                c->findSupport(varId, value, *otherDomain, residue);
+                }
+
+                if (!supported) {
+                        domainChanged = true;
+
+                        (*mState->mVariables)[varId]->eraseFromDomain(value);
+                        outRemovedValues[varId].insert(value);
+
+                        domIt = d->lower_bound(value);
+                        continue;
+                }
+                ++domIt;
+        }
+
+        return domainChanged;
+}
+
 void CSPProblem::restoreDomains(const std::map<VarIdType, Domain> &aRemovedValues) {
         for (std::map<VarIdType, Domain>::const_iterator valIt = aRemovedValues.begin();
                         valIt != aRemovedValues.end(); ++valIt) {
                 VarIdType varId = valIt->first;
                 const Domain & domain = valIt->second;
-                Variable * var = (*mVariables)[varId];
+                Variable * var = (*mState->mVariables)[varId];
 
                 for (Domain::const_iterator domIt = domain.begin(); domIt != domain.end(); ++domIt) {
                         var->addToDomain(*domIt);
@@ -490,27 +866,15 @@ void CSPProblem::restoreDomains(const std::map<VarIdType, Domain> &aRemovedValue
         }
 }
 
-unsigned int Variable::getNumValuesInDomainRange(VarType aLowerBound, VarType aUpperBound) const {
-        Domain::const_iterator domItLB = mDomain->lower_bound(aLowerBound);
-        Domain::const_iterator domItUB = mDomain->lower_bound(aUpperBound);
-
-        unsigned int numValues = 0;
-        while (domItLB != domItUB) {
-                ++numValues;
-                ++domItLB;
-        };
-        return numValues;
-}
-
 void Variable::restrictDomainToValue(VarType aValue, Domain & outRemovedValues) {
-        outRemovedValues = *mDomain;
-        mDomain->clear();
-        mDomain->insert(aValue);
+        outRemovedValues = Domain(mDomain.begin(), mDomain.end());
+        mDomain.clear();
+        mDomain.insert(aValue);
 }
 
 void Variable::restoreRestrictedDomain(const Domain & aRemovedValues) {
         for (Domain::const_iterator domIt = aRemovedValues.begin(); domIt != aRemovedValues.end(); ++domIt) {
-                mDomain->insert(*domIt);
+                mDomain.insert(*domIt);
         }
 }
 
@@ -518,7 +882,7 @@ void Variable::restoreRestrictedDomain(const Domain & aRemovedValues) {
 std::string Variable::pprint() const {
         std::ostringstream out;
         out << "x_" << mId << ": ";
-        for (Domain::const_iterator domIt = mDomain->begin(); domIt != mDomain->end(); ++domIt) {
+        for (DomainView::const_iterator domIt = mDomain.begin(); domIt != mDomain.end(); ++domIt) {
                 out << *domIt << ", ";
         }
         return out.str();
@@ -526,14 +890,22 @@ std::string Variable::pprint() const {
 
 std::string CSPProblem::pprintVariables() const {
         std::ostringstream out;
-        for (VariableMap::const_iterator varIt = mVariables->begin(); varIt != mVariables->end(); ++varIt) {
-                out << varIt->second->pprint() << std::endl;
+        for (VarIdType varId = 0; varId < mState->mVariables->size(); ++varId) {
+                out << (*mState->mVariables)[varId]->pprint() << std::endl;
         }
         return out.str();
 }
 
 unsigned int CSPProblem::getNumValuesInDomainRange(VarIdType aVarId, VarType aLowerBound, VarType aUpperBound) const {
-        return (*mVariables)[aVarId]->getNumValuesInDomainRange(aLowerBound, aUpperBound);
+        return (*mState->mVariables)[aVarId]->getNumValuesInDomainRange(aLowerBound, aUpperBound);
+}
+
+void remap_constraints(ConstraintList * aConstraints, const ProblemMapping & aMapping) {
+        assert(aConstraints);
+
+        for (ConstraintList::iterator ctrIt = aConstraints->begin(); ctrIt != aConstraints->end(); ++ctrIt) {
+                (*ctrIt)->remap(aMapping);
+        }
 }
 
 std::string assignment_pprint(const Assignment & a) {
@@ -22,6 +22,7 @@
 #ifndef CSP_H_
 #define CSP_H_
 
+#include <deque>
 #include <set>
 #include <map>
 #include <string>
@@ -31,55 +32,134 @@
 
 #include "types.h"
 #include "domain_interval.h"
+#include "problem_mapping.h"
+#include "domain_arena.h"
+#include "constraint_store.h"
+#include "conflict_set.h"
+
+/**
+ * Maximal number of tuples of a constraint evaluated by CSPProblem::getContentHash(), the
+ * tuples of larger constraints are drawn pseudo-randomly (always the same ones)
+ */
+const unsigned int PROBLEM_HASH_TUPLES = 256;
 
 class Variable {
 public:
-        Variable(const VarIdType &id, Domain * d): mId(id), mDomain(d) {};
-
-        Variable(const VarIdType &id, VarType aMinValue, VarType aMaxValue);
-
-        virtual ~Variable() {
-                delete mDomain;
-        };
+        Variable(const VarIdType &id, const DomainView & d): mId(id), mDomain(d) {};
 
         VarIdType getId() const { return mId; };
 
-        const Domain * getDomain() const { return mDomain; };
+        const DomainView * getDomain() const { return &mDomain; };
 
         /**
          * Erases a given value from the domain
          */
         void eraseFromDomain(VarType aValue) {
-                mDomain->erase(aValue);
+                mDomain.erase(aValue);
         }
 
         /**
          * Adds a given value to the domain
          */
         void addToDomain(VarType aValue) {
-                mDomain->insert(aValue);
+                mDomain.insert(aValue);
         };
 
         void clearDomain() {
-                mDomain->clear();
+                mDomain.clear();
         };
 
         void restrictDomainToValue(VarType, Domain & outRemovedValues);
 
         void restoreRestrictedDomain(const Domain & aRemovedValues);
 
-        unsigned int getNumValuesInDomainRange(VarType aLowerBound, VarType aUpperBound) const;
+        unsigned int getNumValuesInDomainRange(VarType aLowerBound, VarType aUpperBound) const {
+                return mDomain.countRange(aLowerBound, aUpperBound);
+        };
 
         std::string pprint() const;
 protected:
         VarIdType mId; // Index of the variable
-        Domain *mDomain; // Domain of the variable
+        DomainView mDomain; // Domain of the variable
 };
 
-typedef std::map<VarIdType, Variable *> VariableMap;
+/**
+ * Variables of a problem in a flat array indexed by their ids. The domains
+ * of all the variables are carved out of a single DomainArena.
+ */
+class VariableArray {
+public:
+        VariableArray() {};
+
+        /**
+         * Adds a variable with the domain 0 .. aNumValues - 1, returns its id
+         */
+        VarIdType addVariable(unsigned int aNumValues) {
+                VarIdType id = mVariables.size();
+                mVariables.push_back(Variable(id, DomainView(&mArena, mArena.addDomain(aNumValues))));
+                return id;
+        };
+
+        size_t size() const {
+                return mVariables.size();
+        };
+
+        bool empty() const {
+                return mVariables.empty();
+        };
+
+        Variable * operator[](VarIdType aId) {
+                assert(aId < mVariables.size());
+                return &mVariables[aId];
+        };
+
+        const Variable * operator[](VarIdType aId) const {
+                assert(aId < mVariables.size());
+                return &mVariables[aId];
+        };
+
+        const DomainArena & getArena() const {
+                return mArena;
+        };
+        /**
+         * Copies the domains to a new arena
+         */
+        VariableArray(const VariableArray & aVariables): mArena(aVariables.mArena) {
+                for (VarIdType id = 0; id < aVariables.size(); ++id) {
+                        mVariables.push_back(Variable(id, DomainView(&mArena, id)));
+                }
+        };
+private:
+        // The views of the variables point to mArena
+        VariableArray & operator=(const VariableArray &);
+
+        DomainArena mArena;
+        std::vector<Variable> mVariables;
+};
 
 class CSPProblem;
 
+/**
+ * Changes of a domain during the propagation (flags). Every change is a
+ * DOMAIN_EVENT_VALUE, the other flags are added when they apply.
+ */
+enum DomainEvent {
+        DOMAIN_EVENT_VALUE = 1, // Some value was removed
+        DOMAIN_EVENT_BOUNDS = 2, // The minimum or the maximum value was removed
+        DOMAIN_EVENT_ASSIGNED = 4 // Only one value is left
+};
+
+/**
+ * Tiers of the propagation queue, the arcs of a tier are only revised when
+ * all the cheaper tiers are empty
+ */
+enum PropagationPriority {
+        PROPAGATION_PRIORITY_CHEAP = 0, // Unary and binary constraints
+        PROPAGATION_PRIORITY_NARY, // Constraints of higher arity
+        PROPAGATION_PRIORITY_TABLE, // Table constraints (the most expensive revisions)
+        NUM_PROPAGATION_PRIORITIES
+};
+
 class Constraint {
 public:
         virtual ~Constraint() {};
@@ -94,6 +174,14 @@ public:
                 return false;
         };
 
+        /**
+         * True if the constraint evaluates to exactly 0 for some assignments; the join
+         * graph skips the assignments extending those when it sums over them
+         */
+        virtual bool canBeZero() const {
+                return false;
+        };
+
         /**
          * Check whether a given value aValue of variable aVarId has support in the variable
          * domain, given an evidence (assignment of variables)
@@ -102,6 +190,89 @@ public:
                 return true;
         }
 
+        /**
+         * Hard constraints on two variables whose compatibility of two values does not
+         * depend on the domains or the evidence return true and implement isCompatible.
+         * The propagation then caches the last support of every value (residual supports)
+         * instead of calling hasSupport.
+         */
+        virtual bool isHardBinary() const {
+                return false;
+        };
+
+        /**
+         * Checks whether the value aValue of aVarId and the value aOtherValue of the other
+         * variable of the scope satisfy the constraint (only for hard binary constraints)
+         */
+        virtual bool isCompatible(VarIdType aVarId, VarType aValue, VarType aOtherValue) const {
+                return true;
+        };
+
+        /**
+         * Looks for a support of aValue of aVarId in the domain of the other variable
+         * of the scope (only for hard binary constraints). The search resumes after
+         * the previous support ioSupport (-1 if none) and wraps around, the support
+         * found is stored back to ioSupport.
+         */
+        virtual bool findSupport(VarIdType aVarId, VarType aValue, const DomainView & aOtherDomain,
+                        VarType & ioSupport) const;
+
+        /**
+         * Hard constraints which can revise the whole domain of a variable at once return
+         * true. Binary ones then implement reviseDomain (used instead of the residual
+         * supports), the others filterDomain (used instead of hasSupport).
+         */
+        virtual bool revisesDomains() const {
+                return false;
+        };
+
+        /**
+         * Appends the values of aDomain (the domain of aVarId) which have no support in
+         * aOtherDomain to outUnsupported
+         */
+        virtual void reviseDomain(VarIdType aVarId, const DomainView & aDomain, const DomainView & aOtherDomain,
+                        std::vector<VarType> & outUnsupported) const {};
+
+        /**
+         * Appends the values of aVarId which have no support given the domains of aProblem
+         * and the evidence to outUnsupported
+         */
+        virtual void filterDomain(VarIdType aVarId, const CSPProblem & aProblem, const Assignment & aEvidence,
+                        std::vector<VarType> & outUnsupported) const {};
+
+        /**
+         * Changes of the domains of the scope variables after which the constraint has
+         * to be revised again (DomainEvent flags). Soft constraints never remove any
+         * value, so they are not revised at all.
+         */
+        virtual unsigned int getPropagationEvents() const {
+                return isSoft() ? 0 : DOMAIN_EVENT_VALUE;
+        };
+
+        /**
+         * Tier of the propagation queue for the constraint (PropagationPriority), by
+         * default given by the arity
+         */
+        virtual unsigned int getPropagationPriority() const {
+                return (getScope().size() <= 2) ? PROPAGATION_PRIORITY_CHEAP : PROPAGATION_PRIORITY_NARY;
+        };
+
+        /**
+         * Translates the constraint from the original variable ids and values
+         * to the dense indices given by aMapping. Called once by the loaders.
+         */
+        virtual void remap(const ProblemMapping & aMapping) {
+                mMapping = &aMapping;
+        };
+
+        /**
+         * Adds the constraint to the block of its kind in aStore. Constraints
+         * without a specialised block go to the generic one.
+         */
+        virtual void addToStore(ConstraintStore & aStore) const {
+                aStore.getBlock<GenericConstraintBlock>()->addConstraint(this);
+        };
+
         /**
          * Adds probability aProbability to a given intervals of all constraints' variables
          */
@@ -121,9 +292,19 @@ public:
         };
 
 protected:
-        Constraint() {};
+        Constraint(): mMapping(0) {};
+
+        /**
+         * Original value of a value index of a given (remapped) variable
+         */
+        VarType originalValue(VarIdType aVarId, VarType aValueIndex) const {
+                assert(mMapping);
+                return mMapping->getOriginalValue(aVarId, aValueIndex);
+        };
 
         std::map<VarIdType, DomainIntervalMap> mDomainIntervals;
+
+        const ProblemMapping * mMapping;
 private:
 
         void _initDomainIntervalsInternal(Scope &aScope, const CSPProblem &aProblem, Assignment & aAssignment,
@@ -132,12 +313,257 @@ private:
 
 typedef std::vector<Constraint *> ConstraintList;
 
+/**
+ * The part of a problem which does not change during the search: the constraints,
+ * the mapping, the scopes and the arcs in compressed sparse rows and the evaluation
+ * structures. It is only read once built, so it can be shared by the search states
+ * of any number of threads.
+ */
+class ProblemModel {
+public:
+        /**
+         * Takes ownership of the constraints and the mapping (remapped to dense indices),
+         * aVariables only give the number of values of every variable
+         */
+        ProblemModel(const VariableArray & aVariables, ConstraintList *c, ProblemMapping *m);
+
+        ~ProblemModel();
+
+        size_t getNumVariables() const {
+                return mArcOffsets.size() - 1;
+        };
+
+        const ConstraintList * getConstraints() const {
+                return mConstraints;
+        };
+
+        size_t getNumConstraints() const {
+                return mConstraints->size();
+        };
+
+        Constraint * getConstraint(size_t aIndex) const {
+                return (*mConstraints)[aIndex];
+        };
+
+        const ProblemMapping * getMapping() const {
+                return mMapping;
+        };
+
+        const ConstraintStore * getStore() const {
+                return mStore;
+        };
+
+        /**
+         * Variables of the constraint with a given index (in the order of its scope)
+         */
+        const VarIdType * getScopeBegin(size_t aConstraint) const {
+                return mScopeVars.empty() ? 0 : &mScopeVars[0] + mScopeOffsets[aConstraint];
+        };
+
+        const VarIdType * getScopeEnd(size_t aConstraint) const {
+                return mScopeVars.empty() ? 0 : &mScopeVars[0] + mScopeOffsets[aConstraint + 1];
+        };
+
+        /**
+         * Arc of the i-th variable of the scope of aConstraint
+         */
+        size_t getScopeArc(size_t aConstraint, unsigned int aPosition) const {
+                return mScopeArcs[mScopeOffsets[aConstraint] + aPosition];
+        };
+
+        size_t getNumArcs() const {
+                return mArcConstraints.size();
+        };
+
+        size_t getArcsBegin(VarIdType aVarId) const {
+                return mArcOffsets[aVarId];
+        };
+
+        size_t getArcsEnd(VarIdType aVarId) const {
+                return mArcOffsets[aVarId + 1];
+        };
+
+        size_t getArcConstraint(size_t aArc) const {
+                return mArcConstraints[aArc];
+        };
+
+        unsigned int getArcPosition(size_t aArc) const {
+                return mArcPositions[aArc];
+        };
+
+        VarIdType getArcVariable(size_t aArc) const {
+                return mArcVars[aArc];
+        };
+
+        const std::vector<size_t> & getEmptyScopeConstraints() const {
+                return mEmptyScopeConstraints;
+        };
+
+        /**
+         * Residual supports of the arc aArc start at getResidueOffset(aArc) in the
+         * residues of a search state (there are getNumResidues() of them)
+         */
+        size_t getResidueOffset(size_t aArc) const {
+                return mResidueOffsets[aArc];
+        };
+
+        size_t getNumResidues() const {
+                return mNumResidues;
+        };
+
+        /**
+         * Propagation events and queue tier of a constraint (cached from the constraint)
+         */
+        unsigned int getConstraintEvents(size_t aConstraint) const {
+                return mConstraintEvents[aConstraint];
+        };
+
+        unsigned int getConstraintPriority(size_t aConstraint) const {
+                return mConstraintPriorities[aConstraint];
+        };
+
+private:
+        ProblemModel(const ProblemModel &);
+        ProblemModel & operator=(const ProblemModel &);
+
+        ConstraintList *mConstraints;
+        ProblemMapping *mMapping;
+
+        /**
+         * Scopes of the constraints, the scope of the constraint c is
+         * mScopeVars[mScopeOffsets[c]] .. mScopeVars[mScopeOffsets[c + 1] - 1]
+         */
+        std::vector<size_t> mScopeOffsets;
+        std::vector<VarIdType> mScopeVars;
+
+        /**
+         * Constraints of the variables in compressed sparse rows: the arcs of the variable v
+         * are mArcOffsets[v] .. mArcOffsets[v + 1] - 1, the arc a leads to the constraint
+         * mArcConstraints[a] whose scope has v at the position mArcPositions[a]
+         */
+        std::vector<size_t> mArcOffsets;
+        std::vector<size_t> mArcConstraints;
+        std::vector<unsigned int> mArcPositions;
+
+        /**
+         * Variable of every arc, and the arc of every entry of mScopeVars
+         */
+        std::vector<VarIdType> mArcVars;
+        std::vector<size_t> mScopeArcs;
+
+        /**
+         * Constraints with empty scopes (they have no arcs)
+         */
+        std::vector<size_t> mEmptyScopeConstraints;
+
+        /**
+         * Only the hard binary constraints which do not revise whole domains have
+         * residual supports, one for every value of the variable of the arc
+         */
+        std::vector<size_t> mResidueOffsets;
+        size_t mNumResidues;
+
+        std::vector<unsigned int> mConstraintEvents;
+        std::vector<unsigned int> mConstraintPriorities;
+
+        /**
+         * The constraints grouped by kind for the evaluation of complete assignments
+         */
+        ConstraintStore * mStore;
+};
+
+/**
+ * The part of a problem which changes during the search of one worker: the current
+ * domains and the working data of the propagation. The values removed by the
+ * propagation are recorded by the callers (the outRemovedValues of CSPProblem), which
+ * belong to the same worker.
+ */
+class SearchState {
+public:
+        /**
+         * Takes ownership of aVariables
+         */
+        SearchState(const ProblemModel & aModel, VariableArray * aVariables);
+
+        /**
+         * Copies the current domains, residues and constraint weights (the queues are empty between propagations)
+         */
+        SearchState(const SearchState & aState);
+
+        ~SearchState() {
+                delete mVariables;
+        };
+
+        friend class CSPProblem;
+private:
+        SearchState & operator=(const SearchState &);
+
+        VariableArray * mVariables;
+
+        /**
+         * Residual supports: the value of the other variable which last supported the value v
+         * on the arc a is mResidues[getResidueOffset(a) + v] (-1 if there is none yet)
+         */
+        std::vector<VarType> mResidues;
+
+        /**
+         * Arcs waiting for revision (a FIFO for every tier), and flags of the arcs in the queues
+         */
+        std::deque<size_t> mArcQueues[NUM_PROPAGATION_PRIORITIES];
+        std::vector<bool> mArcQueued;
+
+        // Values removed by a whole-domain revision
+        std::vector<VarType> mUnsupportedValues;
+
+        /**
+         * Weights of the constraints for dom/wdeg: 1 + the number of domains the constraint has emptied
+         */
+        std::vector<unsigned int> mConstraintWeights;
+
+        /**
+         * Conflict tracking for backjumping (CSPProblem::trackConflicts): the depth at which
+         * each variable is assigned (-1 if it is not), the depths explaining the values
+         * removed from each domain by the propagation, the previous explanations to restore
+         * and the explanation of the last failure
+         */
+        bool mTrackConflicts;
+        std::vector<int> mAssignmentDepths;
+        std::vector<ConflictSet> mConflicts;
+        std::vector<std::pair<VarIdType, ConflictSet> > mConflictTrail;
+        ConflictSet mFailureConflict;
+        ConflictSet mRevisionReason;
+};
+
 class CSPProblem {
 public:
-        CSPProblem(VariableMap *v, ConstraintList *c);
+        /**
+         * Creates a problem from variables and constraints which have already been
+         * remapped to dense indices. The problem takes ownership of all three (the
+         * constraints and the mapping go to its model, the variables to its state).
+         */
+        CSPProblem(VariableArray *v, ConstraintList *c, ProblemMapping *m);
+
+        /**
+         * Creates a problem searching with the state aState in the shared model aModel.
+         * Only the state is owned, the model has to outlive the problem.
+         */
+        CSPProblem(const ProblemModel * aModel, SearchState * aState);
 
         ~CSPProblem();
 
+        /**
+         * Creates a problem which shares the model with this one, but has its own copy
+         * of the current domains. The copy can search in another thread, it must not
+         * outlive the owner of the model.
+         */
+        CSPProblem * createWorkingCopy() const {
+                return new CSPProblem(mModel, new SearchState(*mState));
+        };
+
+        const ProblemModel * getModel() const {
+                return mModel;
+        };
+
         /**
          * Split functions into mini-buckets containing at most aMaxBucketSize variables
          * If aMaxBucketSize is less than maximum scope size, maximum scope size is used
@@ -151,23 +577,181 @@ public:
 
         double evalAssignment(Assignment &a) const;
 
+        /**
+         * Evaluates a complete assignment given as a vector indexed by variable id
+         */
+        double evalAssignment(const FlatAssignment & aValues) const {
+                assert(aValues.size() == mState->mVariables->size());
+                return mModel->getStore()->evalAssignment(&aValues[0]);
+        };
+
+        /**
+         * Logarithm of evalAssignment, summed over the constraints so that it does not underflow
+         * (-HUGE_VAL if the assignment is not a solution)
+         */
+        double evalLogAssignment(Assignment &a) const;
+
+        double evalLogAssignment(const FlatAssignment & aValues) const {
+                assert(aValues.size() == mState->mVariables->size());
+                return mModel->getStore()->evalLogAssignment(&aValues[0]);
+        };
+
+        /**
+         * Computes outLogWeights[k] = log(evalAssignment(ioValues)) with the variable aVarId set to
+         * aCandidates[k], in a single pass over the constraints (ioValues is the same on return)
+         */
+        void conditionalLogWeights(VarIdType aVarId, const std::vector<VarType> & aCandidates,
+                        FlatAssignment & ioValues, std::vector<double> & outLogWeights) const {
+                assert(aVarId < ioValues.size());
+                outLogWeights.resize(aCandidates.size());
+                if (!aCandidates.empty())
+                        mModel->getStore()->conditionalLogWeights(aVarId, &aCandidates[0], aCandidates.size(), &ioValues[0], &outLogWeights[0]);
+        };
+
         const Variable * getVariableById(VarIdType aId) const {
-                return (*mVariables)[aId];
+                return (*mState->mVariables)[aId];
         };
 
         /**
          * Non-const version of the previous method
          */
         Variable * getVariableById(VarIdType aId) {
-                return (*mVariables)[aId];
+                return (*mState->mVariables)[aId];
         }
 
-        const VariableMap * getVariables() {
-                return mVariables;
+        const VariableArray * getVariables() const {
+                return mState->mVariables;
         };
 
-        const ConstraintList * getConstraints() {
-                return mConstraints;
+        /**
+         * Makes the propagation explain the values it removes by the depths of the assignments
+         * (setAssignmentDepth) which caused the removal, for conflict-directed backjumping
+         */
+        void trackConflicts();
+
+        bool isTrackingConflicts() const {
+                return mState->mTrackConflicts;
+        };
+
+        /**
+         * Depth at which the variable has been assigned in the search, -1 when it is unassigned
+         */
+        void setAssignmentDepth(VarIdType aVarId, int aDepth) {
+                mState->mAssignmentDepths[aVarId] = aDepth;
+        };
+
+        int getAssignmentDepth(VarIdType aVarId) const {
+                return mState->mAssignmentDepths[aVarId];
+        };
+
+        /**
+         * Depths of the assignments which removed values from the domain of the variable
+         */
+        const ConflictSet & getConflict(VarIdType aVarId) const {
+                return mState->mConflicts[aVarId];
+        };
+
+        /**
+         * Depths of the assignments which caused the last failure of propagateConstraints
+         */
+        const ConflictSet & getFailureConflict() const {
+                return mState->mFailureConflict;
+        };
+
+        /**
+         * The explanations changed after getConflictTrailSize returned aTrailSize are restored
+         * by restoreConflicts (together with the domains)
+         */
+        size_t getConflictTrailSize() const {
+                return mState->mConflictTrail.size();
+        };
+
+        void restoreConflicts(size_t aTrailSize);
+
+        /**
+         * Adds aReason to the conflict of a variable whose values have been removed outside
+         * of the propagation
+         */
+        void explainRemoval(VarIdType aVarId, const ConflictSet & aReason);
+
+        /**
+         * 1 + the number of times the propagation failed because the constraint emptied a domain
+         */
+        unsigned int getConstraintWeight(size_t aConstraint) const {
+                return mState->mConstraintWeights[aConstraint];
+        };
+
+        const ConstraintList * getConstraints() const {
+                return mModel->getConstraints();
+        };
+
+        size_t getNumConstraints() const {
+                return mModel->getNumConstraints();
+        };
+
+        Constraint * getConstraint(size_t aIndex) const {
+                return mModel->getConstraint(aIndex);
+        };
+
+        /**
+         * Variables of the constraint with a given index (in the order of its scope)
+         */
+        const VarIdType * getScopeBegin(size_t aConstraint) const {
+                return mModel->getScopeBegin(aConstraint);
+        };
+
+        const VarIdType * getScopeEnd(size_t aConstraint) const {
+                return mModel->getScopeEnd(aConstraint);
+        };
+
+        /**
+         * Arcs (pairs variable-constraint) of a given variable are
+         * getArcsBegin(aVarId) .. getArcsEnd(aVarId) - 1
+         */
+        size_t getArcsBegin(VarIdType aVarId) const {
+                return mModel->getArcsBegin(aVarId);
+        };
+
+        size_t getArcsEnd(VarIdType aVarId) const {
+                return mModel->getArcsEnd(aVarId);
+        };
+
+        /**
+         * Index of the constraint of an arc
+         */
+        size_t getArcConstraint(size_t aArc) const {
+                return mModel->getArcConstraint(aArc);
+        };
+
+        /**
+         * Position of the variable of an arc in the scope of the constraint
+         */
+        unsigned int getArcPosition(size_t aArc) const {
+                return mModel->getArcPosition(aArc);
+        };
+
+        /**
+         * Indices of the constraints whose scopes are subsets of aScope (in the order
+         * of the constraint list)
+         */
+        void getConstraintsWithinScope(const Scope & aScope, std::vector<size_t> & outConstraints) const;
+
+        const ProblemMapping * getMapping() const {
+                return mModel->getMapping();
+        };
+
+        /**
+         * Hash of the original variables and domains, the constraint scopes and the values of
+         * the constraints on (at most PROBLEM_HASH_TUPLES of) their tuples; it identifies the
+         * problem in the cache files
+         */
+        unsigned long getContentHash() const;
+
+        /**
+         * Converts an assignment to the original variable ids and values (for output)
+         */
+        Assignment decodeAssignment(const Assignment & aAssignment) const {
+                return mModel->getMapping()->decodeAssignment(aAssignment);
         };
 
         /**
@@ -198,15 +782,50 @@ public:
         std::string pprintVariables() const;
 
 protected:
+        const ProblemModel * mModel;
+        SearchState * mState;
 
-        VariableMap *mVariables;
-        ConstraintList *mConstraints;
-
-        std::map<VarIdType, ConstraintList> mConstraintMap;
+        // False for the problems sharing the model of another one
+        bool mOwnsModel;
 private:
-        bool _propagateConstraintsInternal(Assignment &aEvidence, 
-                std::set<std::pair<Constraint *, VarIdType> > & aConstraintQueue,
+        CSPProblem(const CSPProblem &);
+        CSPProblem & operator=(const CSPProblem &);
+
+        void _enqueueArc(size_t aArc, const Assignment & aEvidence);
+
+        /**
+         * Takes the next arc from the cheapest non-empty tier, returns false if all
+         * the tiers are empty
+         */
+        bool _dequeueArc(size_t & outArc);
+
+        /**
+         * Adds the arcs of all the constraints of aVarId (except those of aVarId itself)
+         * which react to aEvents to the propagation queue
+         */
+        void _enqueueNeighbours(VarIdType aVarId, const Assignment & aEvidence, unsigned int aEvents);
+
+        /**
+         * Adds the explanation of the values removed by the revision of aArc to the conflict
+         * of its variable: the depths of the other assigned variables of the constraint and
+         * the conflicts of the unassigned ones
+         */
+        void _explainRevision(size_t aArc);
+
+        bool _propagateConstraintsInternal(Assignment &aEvidence,
                 std::map<VarIdType, Domain> & outRemovedValues);
+
+        /**
+         * Removes the values of the variable of aArc without support in its constraint,
+         * returns true if some value was removed
+         */
+        bool _reviseArc(size_t aArc, Assignment & aEvidence, std::map<VarIdType, Domain> & outRemovedValues);
+
+        /**
+         * The same for hard binary constraints, using the whole-domain revision of the
+         * constraint or the residual supports
+         */
+        bool _reviseBinaryArc(size_t aArc, const Assignment & aEvidence, std::map<VarIdType, Domain> & outRemovedValues);
 };
 
 class CSPSampler {
@@ -222,10 +841,61 @@ public:
          * Returns false if no solution was found
          */
         virtual bool getSample(Assignment & aAssignment) = 0;
+
+        /**
+         * True if the last getSample gave up at a limit of its search, so that false
+         * did not mean that no solution exists
+         */
+        virtual bool sampleAbandoned() const {
+                return false;
+        };
+
+        /**
+         * The number of restarts of the searches of all the samples
+         */
+        virtual unsigned long getNumRestarts() const {
+                return 0;
+        };
+
+        /**
+         * Log of the importance weight of the last sample, 0 if the samples follow the
+         * distribution of the problem
+         */
+        virtual double getSampleLogWeight() const {
+                return 0;
+        };
+
+        /**
+         * The sampling started at aStart and has to end at aDeadline (as current_time(),
+         * 0 for no deadline). A sampler may lower its effort as the deadline nears and
+         * abandon the sample it searches for when it passes.
+         */
+        virtual void setTimeBudget(double aStart, double aDeadline) {};
+
+        /**
+         * A quiet sampler does not print the progress of its search (the IJGP runs and the
+         * backtracks); the samplers sampling in other threads than the output are quiet, as
+         * their lines would split the lines of the samples
+         */
+        virtual void setQuiet(bool aQuiet) {};
+
+        /**
+         * Creates a sampler of the same distribution with its own working copy of the
+         * problem, which can sample in another thread. Returns 0 if the sampler can not
+         * be copied.
+         */
+        virtual CSPSampler * createWorker() const {
+                return 0;
+        };
 protected:
         CSPProblem * mProblem;
 };
 
+/**
+ * Remaps all the constraints in the list to the dense indices of aMapping
+ */
+void remap_constraints(ConstraintList * aConstraints, const ProblemMapping & aMapping);
+
 std::string assignment_pprint(const Assignment & a);
 
 std::string scope_pprint(const Scope & aScope);
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+
+#include "distribution_cache.h"
+
+DistributionCache::DistributionCache(size_t aMaxSize):
+        mMaxSize(aMaxSize), mNumLookups(0), mNumHits(0) {
+        assert(aMaxSize > 0);
+}
+
+bool DistributionCache::find(const Key & aKey, ProbabilityDistribution & outDistribution) {
+        ++mNumLookups;
+
+        Index::iterator indexIt = mIndex.find(HashedKey(_hash(aKey), aKey));
+        if (indexIt == mIndex.end())
+                return false;
+
+        // Move the entry to the front
+        mEntries.splice(mEntries.begin(), mEntries, indexIt->second);
+        outDistribution = indexIt->second->distribution;
+
+        ++mNumHits;
+        return true;
+}
+
+void DistributionCache::insert(const Key & aKey, const ProbabilityDistribution & aDistribution) {
+        HashedKey key(_hash(aKey), aKey);
+        if (mIndex.find(key) != mIndex.end())
+                return;
+
+        if (mIndex.size() == mMaxSize) {
+                mIndex.erase(mEntries.back().key);
+                mEntries.pop_back();
+        }
+
+        mEntries.push_front(Entry());
+        mEntries.front().key = key;
+        mEntries.front().distribution = aDistribution;
+        mIndex[key] = mEntries.begin();
+}
+
+unsigned long DistributionCache::_hash(const Key & aKey) {
+        // FNV-1a over the elements
+        unsigned long hash = 2166136261UL;
+        for (Key::const_iterator kIt = aKey.begin(); kIt != aKey.end(); ++kIt) {
+                hash = (hash ^ (unsigned long)*kIt) * 16777619UL;
+        }
+
+        return hash;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DISTRIBUTION_CACHE_H_
+#define DISTRIBUTION_CACHE_H_
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include "csp.h"
+
+/**
+ * Bounded cache of the conditional distributions computed in the clusters of a join
+ * graph. The key identifies everything the distribution depends on: the cluster, the
+ * messages (by their epoch), the target variable, the evidence in the cluster and the
+ * domains of its other variables. When the cache is full, the least recently used
+ * distribution is dropped.
+ */
+class DistributionCache {
+public:
+        typedef std::vector<long> Key;
+
+        DistributionCache(size_t aMaxSize);
+
+        /**
+         * Finds the distribution of the key, returns false if it is not cached
+         */
+        bool find(const Key & aKey, ProbabilityDistribution & outDistribution);
+
+        void insert(const Key & aKey, const ProbabilityDistribution & aDistribution);
+
+        size_t getMaxSize() const {
+                return mMaxSize;
+        };
+
+        unsigned long getNumLookups() const {
+                return mNumLookups;
+        };
+
+        unsigned long getNumHits() const {
+                return mNumHits;
+        };
+private:
+        // The keys are compared by their hash first
+        typedef std::pair<unsigned long, Key> HashedKey;
+
+        struct Entry {
+                HashedKey key;
+                ProbabilityDistribution distribution;
+        };
+
+        typedef std::map<HashedKey, std::list<Entry>::iterator> Index;
+
+        static unsigned long _hash(const Key & aKey);
+
+        size_t mMaxSize;
+
+        // The entries from the most recently used
+        std::list<Entry> mEntries;
+        Index mIndex;
+
+        unsigned long mNumLookups, mNumHits;
+};
+
+#endif // DISTRIBUTION_CACHE_H_
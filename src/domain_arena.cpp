@@ -0,0 +1,139 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "domain_arena.h"
+
+size_t DomainArena::addDomain(unsigned int aNumValues) {
+        // Every domain has at least one word, so that its words can always be addressed
+        size_t numWords = aNumValues / WORD_BITS + 1;
+
+        mOffsets.push_back(mWords.size());
+        mNumValues.push_back(aNumValues);
+        mSizes.push_back(aNumValues);
+
+        mWords.resize(mWords.size() + numWords, ~0UL);
+
+        // Clear the bits above the last value
+        unsigned long & lastWord = mWords.back();
+        lastWord = (aNumValues % WORD_BITS == 0) ? 0UL : (~0UL >> (WORD_BITS - aNumValues % WORD_BITS));
+
+        return mOffsets.size() - 1;
+}
+
+VarType DomainIterator::nextValue(const unsigned long * aWords, unsigned int aNumValues, VarType aValue) {
+        assert(aValue >= 0);
+        if ((unsigned int)aValue >= aNumValues)
+                return aNumValues;
+
+        size_t wordIdx = aValue / DomainArena::WORD_BITS;
+        unsigned long word = aWords[wordIdx] & (~0UL << (aValue % DomainArena::WORD_BITS));
+        size_t lastWordIdx = aNumValues / DomainArena::WORD_BITS;
+
+        while (word == 0) {
+                if (++wordIdx > lastWordIdx)
+                        return aNumValues;
+                word = aWords[wordIdx];
+        }
+
+        // The bits above the last value are always clear
+        return wordIdx * DomainArena::WORD_BITS + __builtin_ctzl(word);
+}
+
+VarType DomainIterator::previousValue(const unsigned long * aWords, VarType aValue) {
+        if (aValue < 0)
+                return -1;
+
+        size_t wordIdx = aValue / DomainArena::WORD_BITS;
+        unsigned int shift = DomainArena::WORD_BITS - 1 - aValue % DomainArena::WORD_BITS;
+        unsigned long word = aWords[wordIdx] & (~0UL >> shift);
+
+        while (word == 0) {
+                if (wordIdx == 0)
+                        return -1;
+                word = aWords[--wordIdx];
+        }
+
+        return wordIdx * DomainArena::WORD_BITS + DomainArena::WORD_BITS - 1 - __builtin_clzl(word);
+}
+
+DomainView::const_iterator DomainView::lower_bound(VarType aValue) const {
+        if (aValue < 0)
+                aValue = 0;
+
+        return const_iterator(_words(), _numValues(), DomainIterator::nextValue(_words(), _numValues(), aValue));
+}
+
+unsigned int DomainView::countRange(VarType aLowerBound, VarType aUpperBound) const {
+        if (aLowerBound < 0)
+                aLowerBound = 0;
+        if (aUpperBound > (VarType)_numValues())
+                aUpperBound = _numValues();
+        if (aLowerBound >= aUpperBound)
+                return 0;
+
+        const unsigned long * words = _words();
+        size_t firstWord = aLowerBound / DomainArena::WORD_BITS;
+        size_t lastWord = (aUpperBound - 1) / DomainArena::WORD_BITS;
+        unsigned int result = 0;
+
+        for (size_t w = firstWord; w <= lastWord; ++w) {
+                unsigned long word = words[w];
+                if (w == firstWord)
+                        word &= ~0UL << (aLowerBound % DomainArena::WORD_BITS);
+                if (w == lastWord)
+                        word &= ~0UL >> (DomainArena::WORD_BITS - 1 - (aUpperBound - 1) % DomainArena::WORD_BITS);
+
+                result += __builtin_popcountl(word);
+        }
+
+        return result;
+}
+
+void DomainView::insert(VarType aValue) {
+        assert(aValue >= 0 && (unsigned int)aValue < _numValues());
+
+        unsigned long & word = _words()[aValue / DomainArena::WORD_BITS];
+        unsigned long bit = 1UL << (aValue % DomainArena::WORD_BITS);
+
+        if (!(word & bit)) {
+                word |= bit;
+                ++mArena->mSizes[mDomain];
+        }
+}
+
+size_t DomainView::erase(VarType aValue) {
+        if (!count(aValue))
+                return 0;
+
+        _words()[aValue / DomainArena::WORD_BITS] &= ~(1UL << (aValue % DomainArena::WORD_BITS));
+        --mArena->mSizes[mDomain];
+
+        return 1;
+}
+
+void DomainView::clear() {
+        unsigned long * words = _words();
+        for (size_t w = 0; w <= _numValues() / DomainArena::WORD_BITS; ++w) {
+                words[w] = 0;
+        }
+
+        mArena->mSizes[mDomain] = 0;
+}
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DOMAIN_ARENA_H_
+#define DOMAIN_ARENA_H_
+
+#include <assert.h>
+#include <limits.h>
+#include <stddef.h>
+#include <iterator>
+#include <vector>
+
+#include "types.h"
+
+class DomainView;
+
+/**
+ * Domains of all the variables of a problem, stored as bit sets over value
+ * indices in a single block of memory.
+ *
+ * The arena can be copied, which gives e.g. a sampler its own domains
+ * (see DomainView).
+ */
+class DomainArena {
+public:
+        DomainArena() {};
+
+        /**
+         * Allocates a domain containing all the values 0 .. aNumValues - 1,
+         * returns its index
+         */
+        size_t addDomain(unsigned int aNumValues);
+
+        size_t getNumDomains() const {
+                return mOffsets.size();
+        };
+
+        static const unsigned int WORD_BITS = sizeof(unsigned long) * CHAR_BIT;
+private:
+        friend class DomainView;
+
+        std::vector<unsigned long> mWords;
+
+        // First word, number of possible values and current size of each domain
+        std::vector<size_t> mOffsets;
+        std::vector<unsigned int> mNumValues;
+        std::vector<unsigned int> mSizes;
+};
+
+/**
+ * Iterator over the values of a DomainView (bidirectional, the values are read-only)
+ */
+class DomainIterator {
+public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef VarType value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const VarType * pointer;
+        typedef VarType reference;
+
+        DomainIterator(): mWords(0), mNumValues(0), mValue(0) {};
+
+        DomainIterator(const unsigned long * aWords, unsigned int aNumValues, VarType aValue):
+                mWords(aWords), mNumValues(aNumValues), mValue(aValue) {};
+
+        VarType operator*() const {
+                return mValue;
+        };
+
+        DomainIterator & operator++() {
+                mValue = nextValue(mWords, mNumValues, mValue + 1);
+                return *this;
+        };
+
+        DomainIterator operator++(int) {
+                DomainIterator result = *this;
+                ++(*this);
+                return result;
+        };
+
+        DomainIterator & operator--() {
+                mValue = previousValue(mWords, mValue - 1);
+                assert(mValue >= 0);
+                return *this;
+        };
+
+        DomainIterator operator--(int) {
+                DomainIterator result = *this;
+                --(*this);
+                return result;
+        };
+
+        bool operator==(const DomainIterator & aIterator) const {
+                return mValue == aIterator.mValue;
+        };
+
+        bool operator!=(const DomainIterator & aIterator) const {
+                return mValue != aIterator.mValue;
+        };
+
+        /**
+         * The first value >= aValue in the bit set (aNumValues if there is none)
+         */
+        static VarType nextValue(const unsigned long * aWords, unsigned int aNumValues, VarType aValue);
+
+        /**
+         * The last value <= aValue in the bit set (-1 if there is none)
+         */
+        static VarType previousValue(const unsigned long * aWords, VarType aValue);
+private:
+        const unsigned long * mWords;
+        unsigned int mNumValues;
+        VarType mValue; // mNumValues for the end iterator
+};
+
+/**
+ * Domain of one variable in a DomainArena, with the same interface as Domain
+ * for reading. A view is only a pointer to the arena and an index, so it can
+ * be created for any copy of the arena.
+ */
+class DomainView {
+public:
+        typedef DomainIterator const_iterator;
+        typedef DomainIterator iterator;
+        typedef std::reverse_iterator<DomainIterator> const_reverse_iterator;
+
+        DomainView(DomainArena * aArena, size_t aDomain): mArena(aArena), mDomain(aDomain) {
+                assert(aArena);
+                assert(aDomain < aArena->getNumDomains());
+        };
+
+        const_iterator begin() const {
+                return const_iterator(_words(), _numValues(), DomainIterator::nextValue(_words(), _numValues(), 0));
+        };
+
+        const_iterator end() const {
+                return const_iterator(_words(), _numValues(), _numValues());
+        };
+
+        const_reverse_iterator rbegin() const {
+                return const_reverse_iterator(end());
+        };
+
+        const_reverse_iterator rend() const {
+                return const_reverse_iterator(begin());
+        };
+
+        size_t size() const {
+                return mArena->mSizes[mDomain];
+        };
+
+        bool empty() const {
+                return size() == 0;
+        };
+
+        size_t count(VarType aValue) const {
+                return (aValue >= 0 && (unsigned int)aValue < _numValues() &&
+                                (_words()[aValue / DomainArena::WORD_BITS] >> (aValue % DomainArena::WORD_BITS)) & 1) ? 1 : 0;
+        };
+
+        const_iterator find(VarType aValue) const {
+                return count(aValue) ? const_iterator(_words(), _numValues(), aValue) : end();
+        };
+
+        /**
+         * The first value >= aValue
+         */
+        const_iterator lower_bound(VarType aValue) const;
+
+        /**
+         * The first value > aValue
+         */
+        const_iterator upper_bound(VarType aValue) const {
+                return lower_bound(aValue + 1);
+        };
+
+        /**
+         * Number of values in the range <aLowerBound, aUpperBound)
+         */
+        unsigned int countRange(VarType aLowerBound, VarType aUpperBound) const;
+
+        /**
+         * Number of possible values (the domain is a subset of 0 .. getNumValues() - 1)
+         */
+        unsigned int getNumValues() const {
+                return _numValues();
+        };
+
+        void insert(VarType aValue);
+
+        size_t erase(VarType aValue);
+
+        void clear();
+private:
+        unsigned long * _words() const {
+                return &mArena->mWords[mArena->mOffsets[mDomain]];
+        };
+
+        unsigned int _numValues() const {
+                return mArena->mNumValues[mDomain];
+        };
+
+        DomainArena * mArena;
+        size_t mDomain;
+};
+
+#endif // DOMAIN_ARENA_H_
@@ -96,7 +96,7 @@ DomainIntervalMap merge_intervals(const DomainIntervalMap & aList1, const Domain
 }
 
 DomainIntervalMap normalize_intervals(const DomainIntervalMap & aList) {
-        double totalProbability;
+        double totalProbability = 0.0;
         DomainIntervalMap result;
         for (DomainIntervalMap::const_iterator intIt = aList.begin(); intIt != aList.end(); ++intIt) {
                 totalProbability += intIt->second;
@@ -230,12 +230,12 @@ std::string interval_list_pprint(const DomainIntervalMap & aList) {
         return out.str();
 }
 
-DomainIntervalMap adjust_intervals_to_domain(const DomainIntervalMap & aList, const Domain & aDomain) {
+DomainIntervalMap adjust_intervals_to_domain(const DomainIntervalMap & aList, const DomainView & aDomain) {
         DomainIntervalMap result;
 
         for (DomainIntervalMap::const_iterator intIt = aList.begin(); intIt != aList.end(); ++intIt) {
-                Domain::const_iterator domLB = aDomain.lower_bound(intIt->first.lowerBound);
-                Domain::const_iterator domUB = aDomain.lower_bound(intIt->first.upperBound);
+                DomainView::const_iterator domLB = aDomain.lower_bound(intIt->first.lowerBound);
+                DomainView::const_iterator domUB = aDomain.lower_bound(intIt->first.upperBound);
                 if (domLB == aDomain.end()) {
                         // If there are no greater keys in the domain than in the interval, quit
                         break;
@@ -252,11 +252,11 @@ DomainIntervalMap adjust_intervals_to_domain(const DomainIntervalMap & aList, co
         return result;
 }
 
-DomainIntervalMap uniform_intervals_for_domain(const Domain & aDomain, unsigned int aMaxIntervals) {
+DomainIntervalMap uniform_intervals_for_domain(const DomainView & aDomain, unsigned int aMaxIntervals) {
         DomainIntervalMap result;
         int valuesPerInterval = max(aDomain.size() / aMaxIntervals, 1);
 
-        Domain::const_iterator domIt = aDomain.begin();
+        DomainView::const_iterator domIt = aDomain.begin();
 
         while (domIt != aDomain.end()) {
                 int i = 0;
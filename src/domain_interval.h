@@ -5,6 +5,7 @@
 #include <map>
 
 #include "types.h"
+#include "domain_arena.h"
 
 struct DomainInterval {
         DomainInterval():
@@ -53,8 +54,8 @@ DomainIntervalMap join_intervals(const DomainIntervalMap & aList, unsigned int a
 
 std::string interval_list_pprint(const DomainIntervalMap & aList);
 
-DomainIntervalMap adjust_intervals_to_domain(const DomainIntervalMap & aList, const Domain & aDomain);
+DomainIntervalMap adjust_intervals_to_domain(const DomainIntervalMap & aList, const DomainView & aDomain);
 
-DomainIntervalMap uniform_intervals_for_domain(const Domain & aDomain, unsigned int aMaxDomainIntervals);
+DomainIntervalMap uniform_intervals_for_domain(const DomainView & aDomain, unsigned int aMaxDomainIntervals);
 
 #endif // DOMAIN_INTERVAL_H_
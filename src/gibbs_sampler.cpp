@@ -20,6 +20,7 @@
  */
 
 #include <assert.h>
+#include <math.h>
 #include <iostream>
 
 #include "csp.h"
@@ -47,61 +48,64 @@ bool GibbsSampler::getSample(Assignment & aAssignment) {
                 mInitialized = true;
         }
         
-        aAssignment = mSample;
+        aAssignment.clear();
+        for (VarIdType i = 0; i < mSample.size(); ++i) {
+                aAssignment[i] = mSample[i];
+        }
         return true;
 }
 
 void GibbsSampler::initSampleInternal() {
-        for (VariableMap::const_iterator varIt = mProblem->getVariables()->begin();
-                        varIt != mProblem->getVariables()->end(); ++varIt) {
-
-                mSample[varIt->first] = random_select(varIt->second->getDomain()); 
+        mSample.resize(mProblem->getVariables()->size());
+        for (VarIdType varId = 0; varId < mSample.size(); ++varId) {
+                mSample[varId] = random_select(mProblem->getVariableById(varId)->getDomain()); 
         }
 }
 
 void GibbsSampler::modifySampleInternal() {
 
         // Modify values for all variables in the problem
-        for (VariableMap::const_iterator varIt = mProblem->getVariables()->begin();
-                        varIt != mProblem->getVariables()->end(); ++varIt) {
+        for (VarIdType varId = 0; varId < mSample.size(); ++varId) {
 
-                //std::cout << "Processing variable x_" << (*varIt)->getId() << std::endl;
-                const Domain * dom = varIt->second->getDomain();
+                //std::cout << "Processing variable x_" << varId << std::endl;
+                const DomainView * dom = mProblem->getVariableById(varId)->getDomain();
                 size_t domSize = dom->size();
 
                 // Sum of conditional probabilities P(X_j|X_{-j}), 
                 // non-normalized (therefore we need to actually compute the total...)
                 double totalProbability = 0; 
 
-                double *domainProbabilities = new double[domSize];
+                // Evaluate the problem for all the values from the domain in one pass
+                std::vector<VarType> candidates(dom->begin(), dom->end());
+                std::vector<double> domainProbabilities(domSize);
+                mProblem->conditionalLogWeights(varId, candidates, mSample, domainProbabilities);
 
-                int domainCounter = 0;
-
-                // Compute probability for each possible value from the domain
-                for (Domain::iterator domIt = dom->begin(); domIt != dom->end(); ++domIt, ++domainCounter) {
-                        mSample[varIt->second->getId()] = *domIt;
-                        double e = mProblem->evalAssignment(mSample);
+                for (size_t k = 0; k < domSize; ++k) {
+                        double e = exp(domainProbabilities[k]);
                         e = max(e, EPSILON);
 
-                        domainProbabilities[domainCounter] = e;
-                        totalProbability += domainProbabilities[domainCounter];
+                        domainProbabilities[k] = e;
+                        totalProbability += domainProbabilities[k];
                 }
 
+                // The variable keeps the last value if none is selected below
+                mSample[varId] = candidates.back();
+
                 if (totalProbability < EPSILON) {
-                        mSample[varIt->second->getId()] = random_select(dom);
+                        mSample[varId] = random_select(dom);
                 } else {
 
-                        double selectedProbability = (rand()*1.0/RAND_MAX) * totalProbability;
+                        double selectedProbability = (random_int()*1.0/RAND_MAX) * totalProbability;
                                  
                         double accumulatedProbability = 0.0;
-                        domainCounter = 0;
-                        for (Domain::iterator domIt = dom->begin();
+                        size_t domainCounter = 0;
+                        for (DomainView::iterator domIt = dom->begin();
                                         domIt != dom->end(); ++domIt, ++domainCounter) {
         
                                 accumulatedProbability += domainProbabilities[domainCounter];
         
                                 if (accumulatedProbability >= selectedProbability) {
-                                        mSample[varIt->second->getId()] = *domIt;
+                                        mSample[varId] = *domIt;
                                         break;
                                 }
                         }
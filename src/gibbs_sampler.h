@@ -35,7 +35,7 @@ private:
 
         unsigned int mBurnIn; // How many steps we should perform before outputting a given sample
 
-        Assignment mSample;
+        FlatAssignment mSample; // Current sample indexed by variable id
 
         bool mInitialized;
 };
@@ -36,24 +36,22 @@
 Graph * Graph::createCSPPrimalGraph(CSPProblem * p) {
         std::map<VarIdType, Vertex *> *vertices = new std::map<VarIdType, Vertex *>();
 
-        for (VariableMap::const_iterator varIt = p->getVariables()->begin(); varIt != p->getVariables()->end(); ++varIt) {
+        for (VarIdType varId = 0; varId < p->getVariables()->size(); ++varId) {
                 // Create vertex for each variable
-                Vertex * v = new Vertex(varIt->first);
-                (*vertices)[varIt->first] = v;
+                Vertex * v = new Vertex(varId);
+                (*vertices)[varId] = v;
         }
 
-        for (ConstraintList::const_iterator ctrIt = p->getConstraints()->begin(); ctrIt != p->getConstraints()->end(); ++ctrIt) {
-                // Add an edge for each constraint
-                Scope s = (*ctrIt)->getScope();
-
-                for (Scope::iterator scIt1 = s.begin(); scIt1 != s.end(); ++scIt1) {
-                        Vertex * v1 = (*vertices)[*scIt1];
-                        Scope::iterator scIt2 = scIt1;
-                        ++scIt2;
-                        for (; scIt2 != s.end(); ++scIt2) {
-                                Vertex * v2 = (*vertices)[*scIt2];
-                                v1->addNeighbour(v2);
-                                v2->addNeighbour(v1);
+        for (VarIdType varId = 0; varId < p->getVariables()->size(); ++varId) {
+                // Add an edge for each variable sharing a constraint with the current one
+                Vertex * v1 = (*vertices)[varId];
+
+                for (size_t arc = p->getArcsBegin(varId); arc != p->getArcsEnd(varId); ++arc) {
+                        size_t c = p->getArcConstraint(arc);
+
+                        for (const VarIdType * scIt = p->getScopeBegin(c); scIt != p->getScopeEnd(c); ++scIt) {
+                                if (*scIt != varId)
+                                        v1->addNeighbour((*vertices)[*scIt]);
                         }
                 }
         }
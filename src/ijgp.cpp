@@ -21,6 +21,7 @@
 
 #include <assert.h>
 #include <math.h>
+#include <pthread.h>
 
 #include <iostream>
 #include <vector>
@@ -34,7 +35,8 @@
 #include "utils.h"
 
 JoinGraph::JoinGraph(const JoinGraph & aGraph):
-        mOrdering(aGraph.mOrdering) {
+        mOrdering(aGraph.mOrdering), mTolerance(aGraph.mTolerance), mEpoch(aGraph.mEpoch), mClock(0),
+        mQuiet(aGraph.mQuiet) {
 
         // Create nodes
         for (std::map<Scope, JoinGraphNode *>::const_iterator nodesIt = aGraph.mNodes.begin();
@@ -139,16 +141,12 @@ JoinGraph * JoinGraph::createJoinGraph(CSPProblem * aProblem, unsigned int aMaxB
 
                         // Append all constraints from the CSPProblem which match the current node's
                         // scope to that node
-                        for (ConstraintList::const_iterator ctrIt = aProblem->getConstraints()->begin();
-                                        ctrIt != aProblem->getConstraints()->end();
-                                        ++ctrIt) {
+                        std::vector<size_t> nodeConstraints;
+                        aProblem->getConstraintsWithinScope(*mbIt, nodeConstraints);
 
-                                Scope ctrScope = (*ctrIt)->getScope();
-                                Scope nodeScope = node->getScope();
-
-                                if (std::includes(nodeScope.begin(), nodeScope.end(), ctrScope.begin(), ctrScope.end())) {
-                                        node->addConstraint(*ctrIt);
-                                }
+                        for (std::vector<size_t>::const_iterator ctrIt = nodeConstraints.begin();
+                                        ctrIt != nodeConstraints.end(); ++ctrIt) {
+                                node->addConstraint(aProblem->getConstraint(*ctrIt));
                         }
 
                         // If there is an edge from this mini-bucket to some other bucket created before,
@@ -268,8 +266,17 @@ JoinGraphMessage * JoinGraphNode::getMessage(const CSPProblem * aProblem, JoinGr
 
         std::vector<VarType> messageScopeValues;
 
+        // The tuples the hard factors rule out are not enumerated, the variables are assigned
+        // in the message scope first and then the marginalized ones
+        std::vector<VarIdType> order(messageScope.begin(), messageScope.end());
+        order.insert(order.end(), marginalizedScope.begin(), marginalizedScope.end());
+
+        ZeroChecks zeroChecks;
+        bool allZero;
+        _prepareZeroChecks(order, aEvidence, aEdge->targetNode(), zeroChecks, allZero);
+
         _computeMessage(message, aProblem, messageScope, marginalizedScope, messageScopeValues, 
-                        partialAssignment, aEdge->targetNode());
+                        partialAssignment, zeroChecks, allZero, aEdge->targetNode());
 
         message->normalize();
 
@@ -333,38 +340,112 @@ ProbabilityDistribution JoinGraphNode::conditionalDistribution(CSPProblem * aPro
         std::set_difference(mScope.begin(), mScope.end(), evidenceScope.begin(), evidenceScope.end(),
                         std::inserter(marginalizedScope, marginalizedScope.begin()));
 
-        const Domain * d = aTargetVariable->getDomain();
+        const DomainView * d = aTargetVariable->getDomain();
 
         Assignment::iterator targetVarIt = partialEvidence.find(targetVarId);
         if (targetVarIt != partialEvidence.end()) {
                 // The target variable is already in the evidence, therefore we create
                 // only a simple distribution (0, 0, ..., 0, 1, 0, ..., 0)
-                for (Domain::iterator domIt = d->begin(); domIt != d->end(); ++domIt) {
+                for (DomainView::iterator domIt = d->begin(); domIt != d->end(); ++domIt) {
                         result[*domIt] = 0.0;
                 }
                 result[targetVarIt->second] = 1.0;
 
                 assert(false); // This should never happen in the debugging, though...
         } else {
+                std::vector<VarIdType> order(1, targetVarId);
+                order.insert(order.end(), marginalizedScope.begin(), marginalizedScope.end());
 
-                for (Domain::iterator domIt = d->begin(); domIt != d->end(); ++domIt) {
+                ZeroChecks zeroChecks;
+                bool allZero;
+                _prepareZeroChecks(order, aEvidence, 0, zeroChecks, allZero);
+
+                for (DomainView::iterator domIt = d->begin(); domIt != d->end(); ++domIt) {
                         partialEvidence[targetVarId] = *domIt;
 
-                        result[*domIt] = _marginalizeOut(aProblem, marginalizedScope, partialEvidence);
+                        if (allZero || _isZero(zeroChecks, targetVarId, partialEvidence))
+                                result[*domIt] = 0.0;
+                        else
+                                result[*domIt] = _marginalizeOut(aProblem, marginalizedScope, partialEvidence,
+                                                zeroChecks);
                 }
         }
 
         return result;
 }
 
+void JoinGraphNode::_prepareZeroChecks(const std::vector<VarIdType> & aOrder, const Assignment & aEvidence,
+                const JoinGraphNode * const aExcludeNode, ZeroChecks & outChecks, bool & outAllZero) {
+
+        ConstraintList candidates;
+        for (ConstraintList::iterator ctrIt = mConstraints.begin(); ctrIt != mConstraints.end(); ++ctrIt) {
+                if ((*ctrIt)->canBeZero())
+                        candidates.push_back(*ctrIt);
+        }
+
+        for (std::map<JoinGraphNode *, JoinGraphMessage *>::iterator msgIt = mMessages.begin();
+                        msgIt != mMessages.end(); ++msgIt) {
+                if (msgIt->first != aExcludeNode && msgIt->second->canBeZero())
+                        candidates.push_back(msgIt->second);
+        }
+
+        outAllZero = false;
+        Assignment evidence = aEvidence;
+
+        for (ConstraintList::iterator cIt = candidates.begin(); cIt != candidates.end(); ++cIt) {
+                // The factor is checked as soon as the last of its variables is assigned
+                Scope scope = (*cIt)->getScope();
+                int lastPosition = -1;
+                bool enumerated = true;
+
+                for (Scope::const_iterator scIt = scope.begin(); scIt != scope.end() && enumerated; ++scIt) {
+                        if (aEvidence.find(*scIt) != aEvidence.end())
+                                continue;
+
+                        std::vector<VarIdType>::const_iterator posIt = std::find(aOrder.begin(), aOrder.end(), *scIt);
+                        if (posIt == aOrder.end())
+                                enumerated = false;
+                        else
+                                lastPosition = std::max(lastPosition, (int) (posIt - aOrder.begin()));
+                }
+
+                if (!enumerated)
+                        continue;
+
+                if (lastPosition < 0) {
+                        if ((**cIt)(evidence) == 0.0)
+                                outAllZero = true;
+                } else {
+                        outChecks[aOrder[lastPosition]].push_back(*cIt);
+                }
+        }
+}
+
+bool JoinGraphNode::_isZero(const ZeroChecks & aChecks, VarIdType aVarId, Assignment & aAssignment) {
+        ZeroChecks::const_iterator checkIt = aChecks.find(aVarId);
+        if (checkIt == aChecks.end())
+                return false;
+
+        for (ConstraintList::const_iterator cIt = checkIt->second.begin();
+                        cIt != checkIt->second.end(); ++cIt) {
+                if ((**cIt)(aAssignment) == 0.0)
+                        return true;
+        }
+
+        return false;
+}
+
 void JoinGraphNode::_computeMessage(JoinGraphMessage * aMessage, const CSPProblem * aProblem,
                 Scope & aMessageScope, Scope & aMarginalizedScope, std::vector<VarType> & aMessageScopeValues,
-                Assignment & aAssignment, const JoinGraphNode * const aExcludeNode) {
+                Assignment & aAssignment, const ZeroChecks & aZeroChecks, bool aZero,
+                const JoinGraphNode * const aExcludeNode) {
 
         // If all variables from the message scope have been assigned, we can start marginalizing out
         // the remaining variables
         if (aMessageScope.empty()) {
-                double probability = _marginalizeOut(aProblem, aMarginalizedScope, aAssignment, aExcludeNode);
+                double probability = 0.0;
+                if (!aZero)
+                        probability = _marginalizeOut(aProblem, aMarginalizedScope, aAssignment, aZeroChecks, aExcludeNode);
                 aMessage->setProbability(aMessageScopeValues, probability);
 
                 //std::cout << "JoinGraphNode::_computeMessage | aMessage " << aMessage << std::endl;
@@ -372,15 +453,18 @@ void JoinGraphNode::_computeMessage(JoinGraphMessage * aMessage, const CSPProble
                 VarIdType assignedVariable = *(aMessageScope.begin());
                 aMessageScope.erase(aMessageScope.begin());
 
-                const Domain * d = aProblem->getVariableById(assignedVariable)->getDomain();
+                const DomainView * d = aProblem->getVariableById(assignedVariable)->getDomain();
 
-                for (Domain::const_iterator domIt = d->begin(); domIt != d->end(); ++domIt) {
+                for (DomainView::const_iterator domIt = d->begin(); domIt != d->end(); ++domIt) {
                         // Assign selected value from the variable domain to the variable
                         aAssignment[assignedVariable] = *domIt;
                         aMessageScopeValues.push_back(*domIt);
 
+                        // The tuples extending a zero are still stored, with the probability 0
+                        bool zero = aZero || _isZero(aZeroChecks, assignedVariable, aAssignment);
+
                         _computeMessage(aMessage, aProblem, aMessageScope, aMarginalizedScope, 
-                                        aMessageScopeValues, aAssignment, aExcludeNode);
+                                        aMessageScopeValues, aAssignment, aZeroChecks, zero, aExcludeNode);
 
                         // Restore previous assignment
                         aMessageScopeValues.pop_back();
@@ -392,7 +476,8 @@ void JoinGraphNode::_computeMessage(JoinGraphMessage * aMessage, const CSPProble
 }
 
 double JoinGraphNode::_marginalizeOut(const CSPProblem * aProblem, Scope & aMarginalizedScope,
-                Assignment & aAssignment, const JoinGraphNode * const aExcludeNode) {
+                Assignment & aAssignment, const ZeroChecks & aZeroChecks,
+                const JoinGraphNode * const aExcludeNode) {
 
         // Sum over all possible values of the given variable
         if (aMarginalizedScope.empty()) {
@@ -404,13 +489,15 @@ double JoinGraphNode::_marginalizeOut(const CSPProblem * aProblem, Scope & aMarg
                 VarIdType marginalizedVariable = *(aMarginalizedScope.begin());
                 aMarginalizedScope.erase(aMarginalizedScope.begin());
 
-                const Domain * d = aProblem->getVariableById(marginalizedVariable)->getDomain();
+                const DomainView * d = aProblem->getVariableById(marginalizedVariable)->getDomain();
 
-                for (Domain::const_iterator domIt = d->begin(); domIt != d->end(); ++domIt) {
+                for (DomainView::const_iterator domIt = d->begin(); domIt != d->end(); ++domIt) {
                         // Assign selected value from the variable domain to the variable
                         aAssignment[marginalizedVariable] = *domIt;
 
-                        sum += _marginalizeOut(aProblem, aMarginalizedScope, aAssignment, aExcludeNode);
+                        if (!_isZero(aZeroChecks, marginalizedVariable, aAssignment))
+                                sum += _marginalizeOut(aProblem, aMarginalizedScope, aAssignment, aZeroChecks,
+                                                aExcludeNode);
 
                         // Restore previous assignment
                         aAssignment.erase(marginalizedVariable);
@@ -463,9 +550,18 @@ double JoinGraphMessage::operator()(Assignment &a) const {
 void JoinGraphMessage::normalize() {
 
         if (mTotalProbability > 0.0) {
+                // The hard constraints usually leave most of the tuples with 0, these are not kept then
+                mSparse = 2 * mNumZeros > mProbabilityTable.size();
+
                 for (std::map<std::vector<VarType>, double>::iterator pIt = mProbabilityTable.begin();
-                                pIt != mProbabilityTable.end(); ++pIt) {
+                                pIt != mProbabilityTable.end(); ) {
+                        if (mSparse && pIt->second == 0.0) {
+                                mProbabilityTable.erase(pIt++);
+                                continue;
+                        }
+
                         pIt->second = pIt->second / mTotalProbability;
+                        ++pIt;
                 }
         } else {
                 double uniformProbability = 1.0 / mProbabilityTable.size();
@@ -474,6 +570,7 @@ void JoinGraphMessage::normalize() {
                                 pIt != mProbabilityTable.end(); ++pIt) {
                         pIt->second = uniformProbability;
                 }
+                mNumZeros = 0;
         }
 
         mTotalProbability = 1.0;
@@ -482,6 +579,9 @@ void JoinGraphMessage::normalize() {
 
 double JoinGraphMessage::KLDivergence(const JoinGraphMessage * aOldMessage) const {
         assert(aOldMessage);
+
+        if (mSparse || aOldMessage->mSparse)
+                return _sparseKLDivergence(aOldMessage);
         
         double divergence = 0.0;
         
@@ -500,12 +600,35 @@ double JoinGraphMessage::KLDivergence(const JoinGraphMessage * aOldMessage) cons
         return divergence;
 }
 
+double JoinGraphMessage::_sparseKLDivergence(const JoinGraphMessage * aOldMessage) const {
+        // As with the full tables, the divergence is not finite if the old message has a zero
+        // or the new one has a zero where the old one does not
+        if (aOldMessage->mNumZeros > 0)
+                return JOIN_GRAPH_KL_DIVERGENCE_MAX;
+
+        double divergence = 0.0;
+        for (std::map<std::vector<VarType>, double>::const_iterator pOldIt = aOldMessage->mProbabilityTable.begin();
+                        pOldIt != aOldMessage->mProbabilityTable.end(); ++pOldIt) {
+
+                std::map<std::vector<VarType>, double>::const_iterator pIt = mProbabilityTable.find(pOldIt->first);
+                if (pIt == mProbabilityTable.end() || pIt->second == 0.0)
+                        return JOIN_GRAPH_KL_DIVERGENCE_MAX;
+
+                divergence += pIt->second * log(pIt->second / pOldIt->second);
+        }
+
+        return divergence;
+}
+
 void JoinGraph::purgeMessages() {
         for (std::map<Scope, JoinGraphNode *>::iterator nodeIt = mNodes.begin();
                         nodeIt != mNodes.end(); ++nodeIt) {
 
                 nodeIt->second->purgeMessages();
         }
+
+        _invalidateLocalStates();
+        mEpoch = _newEpoch();
 }
 
 void JoinGraph::orderNodes() {
@@ -518,7 +641,7 @@ void JoinGraph::orderNodes() {
         }
 }
 
-void JoinGraph::iterativePropagation(CSPProblem * aProblem, Assignment & aEvidence, unsigned int aMaxIterations) {
+unsigned int JoinGraph::iterativePropagation(CSPProblem * aProblem, Assignment & aEvidence, unsigned int aMaxIterations) {
 
         Scope evidenceScope;
 
@@ -528,12 +651,15 @@ void JoinGraph::iterativePropagation(CSPProblem * aProblem, Assignment & aEviden
 
 
         unsigned int numIterations = 0;
-        std::cout << "IJGP ";
+        if (!mQuiet)
+                std::cout << "IJGP ";
 
         while (numIterations < aMaxIterations) {
 
-                std::cout << ".";
-                std::cout.flush();
+                if (!mQuiet) {
+                        std::cout << ".";
+                        std::cout.flush();
+                }
 
                 // Walk along the ordering of the clusters
                 for (std::vector<Scope>::iterator nodeScopeIt = mOrdering.begin();
@@ -572,9 +698,11 @@ void JoinGraph::iterativePropagation(CSPProblem * aProblem, Assignment & aEviden
                         std::cout << "KL divergence is " << kl_divergence << std::endl;
                 */
 
-                if (kl_err >= 0 && fabs(kl_divergence) < JOIN_GRAPH_KL_DIVERGENCE_MIN) {
+                if (kl_err >= 0 && fabs(kl_divergence) < mTolerance) {
                         //std::cout << "Breaking, KL divergence is " << kl_divergence << std::endl;
-                        std::cout << ";";
+                        if (!mQuiet)
+                                std::cout << ";";
+                        ++numIterations;
                         break;
                 }
 
@@ -582,9 +710,228 @@ void JoinGraph::iterativePropagation(CSPProblem * aProblem, Assignment & aEviden
                 ++numIterations;
         }
 
-        std::cout << " ";
-        std::cout << assignment_pprint(aEvidence);
-        std::cout << std::endl;
+        if (!mQuiet) {
+                std::cout << " ";
+                std::cout << assignment_pprint(aEvidence);
+                std::cout << std::endl;
+        }
+
+        // The lazy propagation does not know the evidence of these messages
+        _invalidateLocalStates();
+        mEpoch = _newEpoch();
+
+        return numIterations;
+}
+
+unsigned int JoinGraph::lazyPropagation(CSPProblem * aProblem, Assignment & aEvidence, Variable * aTargetVariable,
+                unsigned int aMaxDepth, unsigned int aMaxIterations) {
+
+        assert(aTargetVariable);
+
+        Scope evidenceScope;
+        for (Assignment::iterator aIt = aEvidence.begin(); aIt != aEvidence.end(); ++aIt) {
+                evidenceScope.insert(aIt->first);
+        }
+
+        const Scope * targetScope = getDistributionScope(aTargetVariable->getId());
+        assert(targetScope);
+        JoinGraphNode * target = mNodes[*targetScope];
+
+        unsigned int numComputed = 0;
+        unsigned int numIterations = 0;
+        if (!mQuiet)
+                std::cout << "IJGP ";
+
+        while (numIterations < aMaxIterations) {
+                if (!mQuiet) {
+                        std::cout << ".";
+                        std::cout.flush();
+                }
+
+                std::map<std::pair<JoinGraphNode *, JoinGraphNode *>, unsigned int> refreshed;
+                std::set<JoinGraphNode *> updatedStates;
+                double divergence = 0.0;
+                unsigned int numSweepComputed = 0;
+
+                for (std::list<JoinGraphEdge *>::iterator edgeIt = target->mEdges.begin();
+                                edgeIt != target->mEdges.end(); ++edgeIt) {
+
+                        _refreshMessage(aProblem, aEvidence, evidenceScope, (*edgeIt)->targetNode(), target, aMaxDepth,
+                                        refreshed, updatedStates, divergence, numSweepComputed);
+                }
+
+                ++numIterations;
+                numComputed += numSweepComputed;
+
+                if (numSweepComputed == 0 || divergence / numSweepComputed < mTolerance) {
+                        if (!mQuiet)
+                                std::cout << ";";
+                        break;
+                }
+        }
+
+        if (!mQuiet) {
+                std::cout << " ";
+                std::cout << assignment_pprint(aEvidence);
+                std::cout << std::endl;
+        }
+
+        if (numComputed > 0)
+                mEpoch = _newEpoch();
+
+        return numComputed;
+}
+
+void JoinGraph::_refreshMessage(const CSPProblem * aProblem, const Assignment & aEvidence, const Scope & aEvidenceScope,
+                JoinGraphNode * aSource, JoinGraphNode * aTarget, unsigned int aDepth,
+                std::map<std::pair<JoinGraphNode *, JoinGraphNode *>, unsigned int> & ioRefreshed,
+                std::set<JoinGraphNode *> & ioUpdatedStates, double & ioDivergence, unsigned int & ioNumComputed) {
+
+        unsigned int & refreshedDepth = ioRefreshed[std::make_pair(aSource, aTarget)];
+        if (refreshedDepth >= aDepth)
+                return;
+        refreshedDepth = aDepth;
+
+        // The messages into the source first, the loops of the graph end at the depth
+        if (aDepth > 1) {
+                for (std::list<JoinGraphEdge *>::iterator edgeIt = aSource->mEdges.begin();
+                                edgeIt != aSource->mEdges.end(); ++edgeIt) {
+
+                        if ((*edgeIt)->targetNode() != aTarget) {
+                                _refreshMessage(aProblem, aEvidence, aEvidenceScope, (*edgeIt)->targetNode(), aSource,
+                                                aDepth - 1, ioRefreshed, ioUpdatedStates, ioDivergence, ioNumComputed);
+                        }
+                }
+        }
+
+        if (ioUpdatedStates.insert(aSource).second) {
+                std::vector<long> state;
+                _localState(aSource->mScope, aProblem, aEvidence, state);
+                if (state != aSource->mLocalState) {
+                        aSource->mLocalState.swap(state);
+                        aSource->mStateStamp = ++mClock;
+                }
+        }
+
+        // The message is dirty if it is older than the state of the source or than a message into it
+        std::map<JoinGraphNode *, unsigned long>::const_iterator stampIt = aTarget->mMessageStamps.find(aSource);
+        unsigned long stamp = (stampIt != aTarget->mMessageStamps.end()) ? stampIt->second : 0;
+        bool dirty = aTarget->mMessages.find(aSource) == aTarget->mMessages.end() || aSource->mStateStamp > stamp;
+
+        for (std::map<JoinGraphNode *, unsigned long>::const_iterator inIt = aSource->mMessageStamps.begin();
+                        !dirty && inIt != aSource->mMessageStamps.end(); ++inIt) {
+
+                dirty = inIt->first != aTarget && inIt->second > stamp;
+        }
+
+        if (!dirty)
+                return;
+
+        JoinGraphEdge * edge = 0;
+        for (std::list<JoinGraphEdge *>::iterator edgeIt = aSource->mEdges.begin();
+                        !edge && edgeIt != aSource->mEdges.end(); ++edgeIt) {
+
+                if ((*edgeIt)->targetNode() == aTarget)
+                        edge = *edgeIt;
+        }
+        assert(edge);
+
+        JoinGraphMessage * message = aSource->getMessage(aProblem, edge, aEvidence, aEvidenceScope);
+
+        std::map<JoinGraphNode *, JoinGraphMessage *>::const_iterator oldIt = aTarget->mMessages.find(aSource);
+        if (oldIt != aTarget->mMessages.end() && oldIt->second->getScope() == message->getScope())
+                ioDivergence += message->KLDivergence(oldIt->second);
+        else
+                ioDivergence += JOIN_GRAPH_KL_DIVERGENCE_MAX;
+
+        aTarget->setMessage(aSource, message);
+        aTarget->mMessageStamps[aSource] = ++mClock;
+        ++ioNumComputed;
+}
+
+JoinGraphMessages::~JoinGraphMessages() {
+        for (std::vector<Entry>::iterator entryIt = mEntries.begin(); entryIt != mEntries.end(); ++entryIt) {
+                delete entryIt->message;
+        }
+}
+
+JoinGraphMessages * JoinGraph::saveMessages() const {
+        JoinGraphMessages * messages = new JoinGraphMessages();
+
+        for (JoinGraphNodeMap::const_iterator nodeIt = mNodes.begin(); nodeIt != mNodes.end(); ++nodeIt) {
+                for (std::map<JoinGraphNode *, JoinGraphMessage *>::const_iterator msgIt = nodeIt->second->mMessages.begin();
+                                msgIt != nodeIt->second->mMessages.end(); ++msgIt) {
+
+                        JoinGraphMessages::Entry entry;
+                        entry.target = nodeIt->first;
+                        entry.source = msgIt->first->getScope();
+                        entry.message = new JoinGraphMessage(*msgIt->second);
+                        messages->mEntries.push_back(entry);
+                }
+        }
+        messages->mEpoch = mEpoch;
+
+        return messages;
+}
+
+void JoinGraph::restoreMessages(const JoinGraphMessages & aMessages) {
+        purgeMessages();
+
+        for (std::vector<JoinGraphMessages::Entry>::const_iterator entryIt = aMessages.mEntries.begin();
+                        entryIt != aMessages.mEntries.end(); ++entryIt) {
+
+                JoinGraphNode * target = mNodes[entryIt->target];
+                target->mMessages[mNodes[entryIt->source]] = new JoinGraphMessage(*entryIt->message);
+        }
+
+        _invalidateLocalStates();
+        mEpoch = aMessages.mEpoch;
+}
+
+void JoinGraph::_invalidateLocalStates() {
+        for (std::map<Scope, JoinGraphNode *>::iterator nodeIt = mNodes.begin(); nodeIt != mNodes.end(); ++nodeIt) {
+                nodeIt->second->mLocalState.clear();
+        }
+}
+
+unsigned long JoinGraph::_newEpoch() {
+        static pthread_mutex_t epochMutex = PTHREAD_MUTEX_INITIALIZER;
+        static unsigned long lastEpoch = 0;
+
+        pthread_mutex_lock(&epochMutex);
+        unsigned long epoch = ++lastEpoch;
+        pthread_mutex_unlock(&epochMutex);
+
+        return epoch;
+}
+
+void JoinGraph::_distributionKey(unsigned int aNodeIndex, const Scope & aScope, const CSPProblem * aProblem,
+                const Variable * aTargetVariable, const Assignment & aEvidence, DistributionCache::Key & outKey) const {
+
+        outKey.push_back(aNodeIndex);
+        outKey.push_back((long)mEpoch);
+        outKey.push_back(aTargetVariable->getId());
+
+        _localState(aScope, aProblem, aEvidence, outKey);
+}
+
+void JoinGraph::_localState(const Scope & aScope, const CSPProblem * aProblem, const Assignment & aEvidence,
+                std::vector<long> & outState) {
+
+        for (Scope::const_iterator scIt = aScope.begin(); scIt != aScope.end(); ++scIt) {
+                Assignment::const_iterator aIt = aEvidence.find(*scIt);
+                if (aIt != aEvidence.end()) {
+                        outState.push_back(aIt->second);
+                        continue;
+                }
+
+                // The domain of an unassigned variable, after its negated size (the values are not negative)
+                const DomainView * domain = aProblem->getVariableById(*scIt)->getDomain();
+                outState.push_back(-1 - (long)domain->size());
+                for (DomainView::const_iterator domIt = domain->begin(); domIt != domain->end(); ++domIt) {
+                        outState.push_back(*domIt);
+                }
+        }
 }
 
 int JoinGraph::KLDivergence(double & outDivergence) {
@@ -606,18 +953,42 @@ int JoinGraph::KLDivergence(double & outDivergence) {
         return 0;
 }
 
+const Scope * JoinGraph::getDistributionScope(VarIdType aVarId) const {
+        for (std::map<Scope, JoinGraphNode *>::const_iterator nodeIt = mNodes.begin();
+                        nodeIt != mNodes.end(); ++nodeIt) {
+
+                if (nodeIt->first.find(aVarId) != nodeIt->first.end())
+                        return &nodeIt->first;
+        }
+
+        return 0;
+}
+
 ProbabilityDistribution JoinGraph::conditionalDistribution(CSPProblem * aProblem, 
-                        Variable * aTargetVariable, const Assignment & aEvidence) {
+                        Variable * aTargetVariable, const Assignment & aEvidence, DistributionCache * aCache) {
 
         // Find a node whose scope contains target variable
         assert(aTargetVariable);
         
+        unsigned int nodeIndex = 0;
         for (std::map<Scope, JoinGraphNode *>::iterator nodeIt = mNodes.begin();
-                        nodeIt != mNodes.end(); ++nodeIt) {
+                        nodeIt != mNodes.end(); ++nodeIt, ++nodeIndex) {
 
                 if (nodeIt->first.find(aTargetVariable->getId()) != nodeIt->first.end()) {
                         // We have found the node
-                        return nodeIt->second->conditionalDistribution(aProblem, aTargetVariable, aEvidence);
+                        if (!aCache)
+                                return nodeIt->second->conditionalDistribution(aProblem, aTargetVariable, aEvidence);
+
+                        DistributionCache::Key key;
+                        _distributionKey(nodeIndex, nodeIt->first, aProblem, aTargetVariable, aEvidence, key);
+
+                        ProbabilityDistribution distribution;
+                        if (!aCache->find(key, distribution)) {
+                                distribution = nodeIt->second->conditionalDistribution(aProblem, aTargetVariable, aEvidence);
+                                aCache->insert(key, distribution);
+                        }
+
+                        return distribution;
                 }
         }
 
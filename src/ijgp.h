@@ -29,17 +29,24 @@
 #include <algorithm>
 
 #include "csp.h"
+#include "distribution_cache.h"
 #include "graph.h"
 
 #define MAX_PROPAGATION_ITERATIONS 10
 
+const int JOIN_GRAPH_ERROR_KL_UNDEFINED = -1;
+const double JOIN_GRAPH_KL_DIVERGENCE_MAX = 1e10;
+const double JOIN_GRAPH_KL_DIVERGENCE_MIN = 1e-2;
+
+const double KL_EPSILON = 1e-10;
+
 class JoinGraphEdge;
 
 class JoinGraphMessage;
 
 class JoinGraphNode {
 public:
-        JoinGraphNode(const Scope & s): mScope(s) {};
+        JoinGraphNode(const Scope & s): mScope(s), mStateStamp(0) {};
 
         ~JoinGraphNode();
 
@@ -79,12 +86,33 @@ public:
 private:
         friend class JoinGraph;
 
+        /**
+         * The factors of the node which may evaluate to 0, by the variable whose assignment
+         * completes their scope during the enumeration
+         */
+        typedef std::map<VarIdType, ConstraintList> ZeroChecks;
+
+        /**
+         * Finds the factors (the constraints and the messages except the one from aExcludeNode)
+         * that may evaluate to 0, for the variables assigned in the order aOrder on top of
+         * aEvidence. outAllZero is set if the evidence alone makes some of them 0.
+         */
+        void _prepareZeroChecks(const std::vector<VarIdType> & aOrder, const Assignment & aEvidence,
+                const JoinGraphNode * const aExcludeNode, ZeroChecks & outChecks, bool & outAllZero);
+
+        /**
+         * True if a factor completed by assigning aVarId evaluates to 0 in aAssignment
+         */
+        static bool _isZero(const ZeroChecks & aChecks, VarIdType aVarId, Assignment & aAssignment);
+
         void _computeMessage(JoinGraphMessage * aMessage, const CSPProblem * aProblem,
                 Scope & aMessageScope, Scope & aMarginalizedScope, std::vector<VarType> & aMessageScopeValues,
-                Assignment & aAssignment, const JoinGraphNode * const aExcludeNode = 0);
+                Assignment & aAssignment, const ZeroChecks & aZeroChecks, bool aZero,
+                const JoinGraphNode * const aExcludeNode = 0);
 
         double _marginalizeOut(const CSPProblem * aProblem, Scope & aMarginalizedScope,
-                Assignment & aAssignment, const JoinGraphNode * const aExcludeNode = 0);
+                Assignment & aAssignment, const ZeroChecks & aZeroChecks,
+                const JoinGraphNode * const aExcludeNode = 0);
 
         double _evalAssignment(Assignment & aAssignment, const JoinGraphNode * const aExcludeNode = 0);
 
@@ -104,6 +132,16 @@ private:
          * stop iterating or not
          */
         std::map<JoinGraphNode *, JoinGraphMessage *> mOldMessages;
+
+        /**
+         * For the lazy propagation: the evidence and the domains of the scope (as in
+         * JoinGraph::_localState(), empty if unknown) the messages of the node were last
+         * computed with, the clock of the graph when they changed, and when the messages
+         * into the node were computed
+         */
+        std::vector<long> mLocalState;
+        unsigned long mStateStamp;
+        std::map<JoinGraphNode *, unsigned long> mMessageStamps;
 };
 
 class JoinGraphEdge {
@@ -128,9 +166,33 @@ private:
 
 typedef std::map<Scope, JoinGraphNode *> JoinGraphNodeMap;
 
+/**
+ * Copy of the messages of a join graph, which can be restored into any copy of the graph
+ */
+class JoinGraphMessages {
+public:
+        JoinGraphMessages(): mEpoch(0) {};
+
+        ~JoinGraphMessages();
+private:
+        JoinGraphMessages(const JoinGraphMessages &);
+        JoinGraphMessages & operator=(const JoinGraphMessages &);
+
+        friend class JoinGraph;
+
+        struct Entry {
+                Scope target;
+                Scope source;
+                JoinGraphMessage * message;
+        };
+
+        std::vector<Entry> mEntries;
+        unsigned long mEpoch;
+};
+
 class JoinGraph {
 public:
-        JoinGraph() {};
+        JoinGraph(): mTolerance(JOIN_GRAPH_KL_DIVERGENCE_MIN), mEpoch(_newEpoch()), mClock(0), mQuiet(false) {};
 
         JoinGraph(const JoinGraph & aGraph);
         ~JoinGraph();
@@ -139,9 +201,47 @@ public:
          * Performs iterative join-graph propagation on this graph
          * given evidence
          */
-        void iterativePropagation(CSPProblem * aProblem, Assignment & aEvidence,
+        unsigned int iterativePropagation(CSPProblem * aProblem, Assignment & aEvidence,
                         unsigned int aMaxIterations = MAX_PROPAGATION_ITERATIONS);
 
+        /**
+         * Demand-driven propagation: only the messages on which the distribution of the
+         * target variable depends are computed, to aMaxDepth edges from its node. A message
+         * is dirty (and computed again) when the evidence or the domains of the scope of its
+         * source node, or a message into the source node, changed after it was computed.
+         * The messages are brought up to date at most aMaxIterations times, until none is
+         * dirty or their KL divergence is less than the tolerance. Returns the number of the
+         * computed messages.
+         */
+        unsigned int lazyPropagation(CSPProblem * aProblem, Assignment & aEvidence, Variable * aTargetVariable,
+                        unsigned int aMaxDepth, unsigned int aMaxIterations = MAX_PROPAGATION_ITERATIONS);
+
+        /**
+         * The propagation stops when the KL divergence between the old and new messages
+         * is less than aTolerance
+         */
+        void setConvergenceTolerance(double aTolerance) {
+                mTolerance = aTolerance;
+        };
+
+        /**
+         * A quiet graph (and its copies) does not print the progress of the propagation
+         */
+        void setQuiet(bool aQuiet) {
+                mQuiet = aQuiet;
+        };
+
+        /**
+         * Copies the current messages
+         */
+        JoinGraphMessages * saveMessages() const;
+
+        /**
+         * Replaces the messages by those saved from a copy of the graph. The next propagation
+         * starts from them and compares its first sweep with them.
+         */
+        void restoreMessages(const JoinGraphMessages & aMessages);
+
         /**
          * Cleans up messages from previous computations
          */
@@ -168,30 +268,81 @@ public:
         void pprint();
 
         /**
-         * Compute conditional probability distribution P(X_j|e)
+         * Compute conditional probability distribution P(X_j|e), looking it up in aCache first
+         * (and storing it there) if it is given
          */
         ProbabilityDistribution conditionalDistribution(CSPProblem * aProblem, 
-                        Variable * aTargetVariable, const Assignment & aEvidence);
+                        Variable * aTargetVariable, const Assignment & aEvidence, DistributionCache * aCache = 0);
+
+        /**
+         * The scope of the node in which conditionalDistribution() computes the distribution
+         * of the variable, 0 if there is none
+         */
+        const Scope * getDistributionScope(VarIdType aVarId) const;
 
 private:
+        /**
+         * A new epoch of the messages, unique in the program
+         */
+        static unsigned long _newEpoch();
+
+        /**
+         * The key of the distribution of the target variable in the node with the given index and scope
+         */
+        void _distributionKey(unsigned int aNodeIndex, const Scope & aScope, const CSPProblem * aProblem,
+                        const Variable * aTargetVariable, const Assignment & aEvidence, DistributionCache::Key & outKey) const;
+
+        /**
+         * Appends the evidence of the variables of aScope, and the domains of the unassigned ones
+         */
+        static void _localState(const Scope & aScope, const CSPProblem * aProblem, const Assignment & aEvidence,
+                        std::vector<long> & outState);
+
+        /**
+         * Forgets the local states of the nodes, so that the lazy propagation computes their messages again
+         */
+        void _invalidateLocalStates();
+
+        /**
+         * Brings the message from aSource to aTarget up to date, with the messages into aSource to
+         * aDepth - 1 edges further. ioRefreshed holds the depths to which the messages have been
+         * brought up to date in this sweep.
+         */
+        void _refreshMessage(const CSPProblem * aProblem, const Assignment & aEvidence, const Scope & aEvidenceScope,
+                        JoinGraphNode * aSource, JoinGraphNode * aTarget, unsigned int aDepth,
+                        std::map<std::pair<JoinGraphNode *, JoinGraphNode *>, unsigned int> & ioRefreshed,
+                        std::set<JoinGraphNode *> & ioUpdatedStates, double & ioDivergence, unsigned int & ioNumComputed);
+
         /**
          * An (arbitrary) ordering of the graph nodes
          */
         std::vector<Scope> mOrdering;
 
         std::map<Scope, JoinGraphNode *> mNodes;
+
+        double mTolerance;
+
+        // Changes whenever the messages do, the copies of the messages keep it
+        unsigned long mEpoch;
+
+        // Orders the changes of the local states and of the messages for the lazy propagation
+        unsigned long mClock;
+
+        bool mQuiet;
 };
 
 class JoinGraphMessage: public Constraint {
 public:
         JoinGraphMessage(const Scope & aScope):
-                mScope(aScope), mTotalProbability(0.0), mNormalized(false) {};
+                mScope(aScope), mTotalProbability(0.0), mNormalized(false), mNumZeros(0), mSparse(false) {};
 
         void setProbability(const std::vector<VarType> & aScopeValues, double aProbability) {
                 assert(!mNormalized); // After normalization, no probability should be adjusted
 
                 mProbabilityTable[aScopeValues] = aProbability;
                 mTotalProbability += aProbability;
+                if (aProbability == 0.0)
+                        ++mNumZeros;
         }
 
         virtual Scope getScope() const {
@@ -200,21 +351,32 @@ public:
 
         virtual double operator()(Assignment &a) const;
 
+        virtual bool canBeZero() const {
+                return mNumZeros > 0;
+        };
+
+        /**
+         * Normalizes the probabilities; when most of them are 0, only the others are kept
+         */
         void normalize();
 
         double KLDivergence(const JoinGraphMessage * aOldMessage) const;
 private:
+        /**
+         * KLDivergence() when one of the messages does not keep its zeros
+         */
+        double _sparseKLDivergence(const JoinGraphMessage * aOldMessage) const;
+
         std::map<std::vector<VarType>, double> mProbabilityTable;
         Scope mScope;
         double mTotalProbability;
         bool mNormalized;
-};
 
-const int JOIN_GRAPH_ERROR_KL_UNDEFINED = -1;
-const double JOIN_GRAPH_KL_DIVERGENCE_MAX = 1e10;
-const double JOIN_GRAPH_KL_DIVERGENCE_MIN = 1e-2;
+        // The number of the tuples with the probability 0, which are not in the table if it is sparse
+        unsigned int mNumZeros;
+        bool mSparse;
+};
 
-const double KL_EPSILON = 1e-10;
 
 #endif // IJGP_H_
 
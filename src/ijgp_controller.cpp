@@ -0,0 +1,91 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+#include <math.h>
+
+#include "ijgp_controller.h"
+
+// The runs before which the averages are not used (every run is made)
+static const unsigned long IJGP_CONTROLLER_WARMUP_RUNS = 5;
+
+// The weight of the last run in the moving averages
+static const double IJGP_CONTROLLER_SMOOTHING = 0.1;
+
+IJGPController::IJGPController(double aGainRate):
+        mGainRate(aGainRate), mGainPerChange(0), mRunTime(0), mNumRuns(0), mNumSkipped(0) {
+        assert(aGainRate >= 0);
+}
+
+bool IJGPController::shouldRun(unsigned int aNumChanged, bool aFailed) {
+        bool run = aNumChanged > 0 && (aFailed || mNumRuns < IJGP_CONTROLLER_WARMUP_RUNS
+                        || mGainPerChange * aNumChanged >= mGainRate * mRunTime);
+
+        if (!run)
+                ++mNumSkipped;
+
+        return run;
+}
+
+void IJGPController::recordRun(unsigned int aNumChanged, double aTime,
+                const ProbabilityDistribution & aBefore, const ProbabilityDistribution & aAfter) {
+
+        assert(aNumChanged > 0);
+        double gainPerChange = _gain(aBefore, aAfter) / aNumChanged;
+
+        if (mNumRuns == 0) {
+                mGainPerChange = gainPerChange;
+                mRunTime = aTime;
+        } else {
+                mGainPerChange += IJGP_CONTROLLER_SMOOTHING * (gainPerChange - mGainPerChange);
+                mRunTime += IJGP_CONTROLLER_SMOOTHING * (aTime - mRunTime);
+        }
+
+        ++mNumRuns;
+}
+
+double IJGPController::_gain(const ProbabilityDistribution & aBefore, const ProbabilityDistribution & aAfter) {
+        double totalBefore = 0, totalAfter = 0;
+        for (ProbabilityDistribution::const_iterator pIt = aBefore.begin(); pIt != aBefore.end(); ++pIt) {
+                totalBefore += pIt->second;
+        }
+        for (ProbabilityDistribution::const_iterator pIt = aAfter.begin(); pIt != aAfter.end(); ++pIt) {
+                totalAfter += pIt->second;
+        }
+
+        if (totalBefore == 0 || totalAfter == 0)
+                return 0;
+
+        double gain = 0;
+        for (ProbabilityDistribution::const_iterator pIt = aBefore.begin(); pIt != aBefore.end(); ++pIt) {
+                double before = pIt->second / totalBefore;
+                ProbabilityDistribution::const_iterator afterIt = aAfter.find(pIt->first);
+                double after = (afterIt != aAfter.end()) ? afterIt->second / totalAfter : 0;
+
+                if (after == 0) {
+                        gain += before; // A failure avoided
+                } else if (before > 0) {
+                        gain += after * log(after / before);
+                }
+        }
+
+        return gain;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef IJGP_CONTROLLER_H_
+#define IJGP_CONTROLLER_H_
+
+#include "types.h"
+
+/**
+ * Decides when the IJGP sampler runs IJGP again, by weighing its expected benefit
+ * against its cost. The benefit of a run is how much it changes the distribution of the
+ * sampled variable (the KL divergence of the new distribution from the old one, plus the
+ * probability of the values it finds inconsistent, i.e. the failures it avoids), expected
+ * to be proportional to the number of evidence variables of the cluster of the variable
+ * that changed since the last run. The cost is the time of a run. A run is worth it when
+ * the expected benefit reaches the gain rate times its expected time, or when the search
+ * has failed since the last run.
+ */
+class IJGPController {
+public:
+        /**
+         * aGainRate is the benefit per second of IJGP which is worth a run
+         */
+        IJGPController(double aGainRate);
+
+        /**
+         * Whether to run IJGP when aNumChanged evidence variables in the cluster have changed
+         * since the last run and aFailed tells if the search has failed since then
+         */
+        bool shouldRun(unsigned int aNumChanged, bool aFailed);
+
+        /**
+         * Records a run on aNumChanged changed evidence variables which took aTime seconds and
+         * changed the (unnormalized) distribution of the sampled variable from aBefore to aAfter
+         */
+        void recordRun(unsigned int aNumChanged, double aTime,
+                        const ProbabilityDistribution & aBefore, const ProbabilityDistribution & aAfter);
+
+        unsigned long getNumRuns() const {
+                return mNumRuns;
+        };
+
+        unsigned long getNumSkipped() const {
+                return mNumSkipped;
+        };
+private:
+        /**
+         * The benefit of a run which changed the distribution from aBefore to aAfter
+         */
+        static double _gain(const ProbabilityDistribution & aBefore, const ProbabilityDistribution & aAfter);
+
+        double mGainRate;
+
+        // Moving averages of the benefit per changed variable and of the time of a run
+        double mGainPerChange;
+        double mRunTime;
+
+        unsigned long mNumRuns, mNumSkipped;
+};
+
+#endif // IJGP_CONTROLLER_H_
@@ -19,6 +19,8 @@
  *
  */
 
+#include <math.h>
+
 #include <iostream>
 
 #include "csp.h"
@@ -29,8 +31,19 @@
 IJGPSampler::IJGPSampler(CSPProblem * aProblem, unsigned int aMaxBucketSize, double aIJGPProbability,
                 unsigned int aMaxIJGPIterations):
         CSPSampler(aProblem), mJoinGraph(0), mMaxBucketSize(aMaxBucketSize), mIJGPProbability(aIJGPProbability),
-        mMaxIJGPIterations(aMaxIJGPIterations) {
-        
+        mMaxIJGPIterations(aMaxIJGPIterations), mSampleFrames(aProblem->getVariables()->size()),
+        mSelector(aProblem, ORDERING_LEX), mBackjumping(false), mQuiet(false), mNogoods(0),
+        mRestartSchedule(RESTART_NONE, 1, 1.0), mSampleTimeLimit(0), mBacktrackLimit(0), mNumBacktracks(0),
+        mSampleDeadline(0), mRunAborted(false), mSampleAbandoned(false), mNumRestarts(0),
+        mBudgetStart(0), mBudgetDeadline(0), mIJGPEffort(1.0), mWarmStart(false),
+        mWarmStartCacheSize(0), mLazyDepth(0), mDepthMessages(aProblem->getVariables()->size() + 1, (JoinGraphMessages *)0),
+        mDepthEvidence(mDepthMessages.size()), mDistributionCache(0), mIJGPController(0), mFailedSinceIJGP(false),
+        mSampleLogProposal(0), mSampleLogWeight(0), mShuttingDown(false), mSearchSeed(0), mNumSearches(0),
+        mOwner(0), mStolenFrame(0) {
+
+        pthread_mutex_init(&mSearchMutex, 0);
+        pthread_cond_init(&mSearchChanged, 0);
+
         mOriginalJoinGraph = JoinGraph::createJoinGraph(aProblem, aMaxBucketSize);
 
         Assignment evidence;
@@ -42,80 +55,865 @@ IJGPSampler::IJGPSampler(CSPProblem * aProblem, unsigned int aMaxBucketSize, dou
         mOriginalJoinGraph->iterativePropagation(mProblem, evidence, mMaxIJGPIterations);
 }
 
+IJGPSampler::IJGPSampler(const IJGPSampler & aSampler):
+        CSPSampler(aSampler.mProblem->createWorkingCopy()), mJoinGraph(0),
+        mOriginalJoinGraph(new JoinGraph(*aSampler.mOriginalJoinGraph)), mMaxBucketSize(aSampler.mMaxBucketSize),
+        mIJGPProbability(aSampler.mIJGPProbability), mMaxIJGPIterations(aSampler.mMaxIJGPIterations),
+        mNoSolutionExists(aSampler.mNoSolutionExists), mSampleFrames(aSampler.mSampleFrames.size()),
+        mSelector(aSampler.mSelector), mBackjumping(aSampler.mBackjumping), mQuiet(aSampler.mQuiet),
+        mNogoods(aSampler.mNogoods ? new NogoodStore(*aSampler.mNogoods) : 0),
+        mRestartSchedule(aSampler.mRestartSchedule), mSampleTimeLimit(aSampler.mSampleTimeLimit), mBacktrackLimit(0),
+        mNumBacktracks(0), mSampleDeadline(0), mRunAborted(false), mSampleAbandoned(false), mNumRestarts(0),
+        mBudgetStart(aSampler.mBudgetStart), mBudgetDeadline(aSampler.mBudgetDeadline), mIJGPEffort(1.0),
+        mWarmStart(aSampler.mWarmStart), mWarmStartCacheSize(aSampler.mWarmStartCacheSize),
+        mLazyDepth(aSampler.mLazyDepth),
+        mDepthMessages(aSampler.mDepthMessages.size(), (JoinGraphMessages *)0),
+        mDepthEvidence(aSampler.mDepthEvidence.size()),
+        mDistributionCache(aSampler.mDistributionCache ?
+                        new DistributionCache(aSampler.mDistributionCache->getMaxSize()) : 0),
+        mIJGPController(aSampler.mIJGPController ? new IJGPController(*aSampler.mIJGPController) : 0),
+        mFailedSinceIJGP(false),
+        mSampleLogProposal(0),
+        mSampleLogWeight(0), mShuttingDown(false), mSearchSeed(0), mNumSearches(0),
+        mOwner(0), mStolenFrame(0) {
+
+        pthread_mutex_init(&mSearchMutex, 0);
+        pthread_cond_init(&mSearchChanged, 0);
+}
+
 IJGPSampler::~IJGPSampler() {
+        _stopHelpers();
+
+        pthread_cond_destroy(&mSearchChanged);
+        pthread_mutex_destroy(&mSearchMutex);
+
         delete mJoinGraph;
         delete mOriginalJoinGraph;
+        delete mNogoods;
+        delete mDistributionCache;
+        delete mIJGPController;
+
+        setWarmStart(false, 0);
+}
+
+CSPSampler * IJGPSampler::createWorker() const {
+        IJGPSampler * worker = new IJGPSampler(*this);
+        if (!mHelpers.empty())
+                worker->setSearchThreads(mHelpers.size() + 1);
+
+        return worker;
+}
+
+void IJGPSampler::setQuiet(bool aQuiet) {
+        mQuiet = aQuiet;
+
+        // The join graph of every sample is copied from the original one
+        mOriginalJoinGraph->setQuiet(aQuiet);
+        if (mJoinGraph)
+                mJoinGraph->setQuiet(aQuiet);
+}
+
+void IJGPSampler::setVariableOrdering(VariableOrdering aOrdering) {
+        mSelector = VariableSelector(mProblem, aOrdering);
+
+        // The helpers wait for a frame to steal, they do not select any variable now
+        for (unsigned int i = 0; i < mHelpers.size(); ++i) {
+                mHelpers[i].sampler->mSelector = mSelector;
+        }
+}
+
+void IJGPSampler::setBackjumping(bool aBackjumping) {
+        mBackjumping = aBackjumping;
+        if (mBackjumping)
+                mProblem->trackConflicts();
+
+        for (unsigned int i = 0; i < mHelpers.size(); ++i) {
+                mHelpers[i].sampler->setBackjumping(aBackjumping);
+        }
+}
+
+void IJGPSampler::setNogoodLearning(size_t aMaxNogoods, unsigned int aMaxSize) {
+        delete mNogoods;
+        mNogoods = 0;
+
+        if (aMaxNogoods > 0) {
+                mNogoods = new NogoodStore(mProblem, aMaxNogoods, aMaxSize);
+                mProblem->trackConflicts();
+        }
+
+        for (unsigned int i = 0; i < mHelpers.size(); ++i) {
+                mHelpers[i].sampler->setNogoodLearning(aMaxNogoods, aMaxSize);
+        }
+}
+
+void IJGPSampler::setRestarts(const RestartSchedule & aSchedule, double aTimeLimit) {
+        // The helpers search the stolen values to the end, the owner cancels them when it restarts
+        mRestartSchedule = aSchedule;
+        mSampleTimeLimit = aTimeLimit;
+}
+
+void IJGPSampler::setTimeBudget(double aStart, double aDeadline) {
+        // The helpers lower their effort too, the owner cancels them when it abandons the sample
+        mBudgetStart = aStart;
+        mBudgetDeadline = aDeadline;
+
+        for (unsigned int i = 0; i < mHelpers.size(); ++i) {
+                mHelpers[i].sampler->setTimeBudget(aStart, aDeadline);
+        }
+}
+
+void IJGPSampler::setConvergenceTolerance(double aTolerance) {
+        // The join graphs of the samples are copied from the original one
+        mOriginalJoinGraph->setConvergenceTolerance(aTolerance);
+
+        for (unsigned int i = 0; i < mHelpers.size(); ++i) {
+                mHelpers[i].sampler->setConvergenceTolerance(aTolerance);
+        }
+}
+
+void IJGPSampler::setWarmStart(bool aWarmStart, size_t aCacheSize) {
+        mWarmStart = aWarmStart;
+        mWarmStartCacheSize = aWarmStart ? aCacheSize : 0;
+
+        for (std::vector<JoinGraphMessages *>::iterator msgIt = mDepthMessages.begin(); msgIt != mDepthMessages.end(); ++msgIt) {
+                delete *msgIt;
+                *msgIt = 0;
+        }
+
+        for (std::map<Assignment, JoinGraphMessages *>::iterator msgIt = mCachedMessages.begin();
+                        msgIt != mCachedMessages.end(); ++msgIt) {
+                delete msgIt->second;
+        }
+        mCachedMessages.clear();
+        mCachedEvidence.clear();
+
+        for (unsigned int i = 0; i < mHelpers.size(); ++i) {
+                mHelpers[i].sampler->setWarmStart(aWarmStart, aCacheSize);
+        }
+}
+
+void IJGPSampler::setDistributionCache(size_t aMaxSize) {
+        delete mDistributionCache;
+        mDistributionCache = aMaxSize > 0 ? new DistributionCache(aMaxSize) : 0;
+
+        for (unsigned int i = 0; i < mHelpers.size(); ++i) {
+                mHelpers[i].sampler->setDistributionCache(aMaxSize);
+        }
+}
+
+void IJGPSampler::setAdaptiveIJGP(bool aAdaptive, double aGainRate) {
+        delete mIJGPController;
+        mIJGPController = aAdaptive ? new IJGPController(aGainRate) : 0;
+
+        for (unsigned int i = 0; i < mHelpers.size(); ++i) {
+                mHelpers[i].sampler->setAdaptiveIJGP(aAdaptive, aGainRate);
+        }
+}
+
+void IJGPSampler::setLazyPropagation(unsigned int aMaxDepth) {
+        mLazyDepth = aMaxDepth;
+
+        for (unsigned int i = 0; i < mHelpers.size(); ++i) {
+                mHelpers[i].sampler->setLazyPropagation(aMaxDepth);
+        }
+}
+
+void IJGPSampler::setSearchThreads(unsigned int aNumThreads) {
+        _stopHelpers();
+
+        if (aNumThreads < 2)
+                return;
+
+        mHelpers.resize(aNumThreads - 1);
+        for (unsigned int i = 0; i < mHelpers.size(); ++i) {
+                mHelpers[i].owner = this;
+                mHelpers[i].sampler = new IJGPSampler(*this);
+                mHelpers[i].sampler->mOwner = this;
+                mHelpers[i].index = i;
+                mHelpers[i].numSearches = mNumSearches;
+
+                // The helpers run concurrently with the owner, only the owner reports
+                mHelpers[i].sampler->setQuiet(true);
+        }
+
+        for (unsigned int i = 0; i < mHelpers.size(); ++i) {
+                pthread_create(&mHelpers[i].thread, 0, _runHelper, &mHelpers[i]);
+        }
+}
+
+void IJGPSampler::_stopHelpers() {
+        if (mHelpers.empty())
+                return;
+
+        pthread_mutex_lock(&mSearchMutex);
+        mShuttingDown = true;
+        pthread_cond_broadcast(&mSearchChanged);
+        pthread_mutex_unlock(&mSearchMutex);
+
+        for (unsigned int i = 0; i < mHelpers.size(); ++i) {
+                pthread_join(mHelpers[i].thread, 0);
+                delete mHelpers[i].sampler;
+        }
+
+        mHelpers.clear();
+        mShuttingDown = false;
+}
+
+void * IJGPSampler::_runHelper(void * aHelper) {
+        SearchHelper * helper = static_cast<SearchHelper *>(aHelper);
+        IJGPSampler * owner = helper->owner;
+
+        pthread_mutex_lock(&owner->mSearchMutex);
+        while (true) {
+                SampleFrame * frame = owner->_frameToSteal();
+
+                if (owner->mShuttingDown) {
+                        break;
+                } else if (!frame) {
+                        pthread_cond_wait(&owner->mSearchChanged, &owner->mSearchMutex);
+                        continue;
+                }
+
+                // A new search of the owner reseeds the helper from the stream of the owner
+                if (helper->numSearches != owner->mNumSearches) {
+                        random_seed_thread(owner->mSearchSeed + helper->index + 1);
+                        helper->numSearches = owner->mNumSearches;
+                }
+
+                size_t slot = --frame->back;
+                frame->states[slot] = SLOT_STOLEN;
+                ++frame->numStolen;
+
+                Assignment evidence = frame->evidence;
+                evidence[frame->var->getId()] = frame->values[slot];
+                pthread_mutex_unlock(&owner->mSearchMutex);
+
+                helper->sampler->mStolenFrame = frame;
+                bool sampleFound = helper->sampler->_searchStolenValue(evidence, frame->var->getId());
+                helper->sampler->mStolenFrame = 0;
+
+                pthread_mutex_lock(&owner->mSearchMutex);
+                if (sampleFound) {
+                        frame->states[slot] = SLOT_FOUND;
+                        frame->found[slot].swap(evidence);
+                        frame->foundLogProposals[slot] = frame->logProposals[slot] + helper->sampler->mSampleLogProposal;
+                } else {
+                        frame->states[slot] = SLOT_FAILED;
+                }
+
+                --frame->numStolen;
+                pthread_cond_broadcast(&owner->mSearchChanged);
+        }
+        pthread_mutex_unlock(&owner->mSearchMutex);
+
+        return 0;
+}
+
+IJGPSampler::SampleFrame * IJGPSampler::_frameToSteal() {
+        for (std::vector<SampleFrame *>::iterator frameIt = mFrames.begin(); frameIt != mFrames.end(); ++frameIt) {
+                if (!(*frameIt)->cancelled && (*frameIt)->front < (*frameIt)->back)
+                        return *frameIt;
+        }
+
+        return 0;
+}
+
+bool IJGPSampler::_stolenSearchCancelled() {
+        if (!mStolenFrame)
+                return false;
+
+        pthread_mutex_lock(&mOwner->mSearchMutex);
+        bool cancelled = mStolenFrame->cancelled;
+        pthread_mutex_unlock(&mOwner->mSearchMutex);
+
+        return cancelled;
 }
 
 bool IJGPSampler::getSample(Assignment & aAssignment) {
+        mRestartSchedule.reset();
+        mSampleDeadline = (mSampleTimeLimit > 0) ? current_time() + mSampleTimeLimit : 0;
+        if (mBudgetDeadline > 0 && (mSampleDeadline == 0 || mBudgetDeadline < mSampleDeadline))
+                mSampleDeadline = mBudgetDeadline;
+        mSampleAbandoned = false;
+
+        if (!mHelpers.empty()) {
+                unsigned int seed = random_int();
+
+                pthread_mutex_lock(&mSearchMutex);
+                mSearchSeed = seed;
+                ++mNumSearches;
+                pthread_mutex_unlock(&mSearchMutex);
+        }
+
+        while (true) {
+                mBacktrackLimit = mRestartSchedule.nextLimit();
+                mNumBacktracks = 0;
+                mRunAborted = false;
+
+                if (_getSampleRun(aAssignment)) {
+                        mSampleLogWeight = mProblem->evalLogAssignment(aAssignment) - mSampleLogProposal;
+                        return true;
+                } else if (!mRunAborted) {
+                        return false; // No solution exists
+                } else if (mSampleDeadline > 0 && current_time() >= mSampleDeadline) {
+                        mSampleAbandoned = true;
+                        return false;
+                }
+
+                ++mNumRestarts;
+        }
+}
+
+bool IJGPSampler::_getSampleRun(Assignment & aAssignment) {
         if (mJoinGraph) {
                 delete mJoinGraph;
         }
         mJoinGraph = new JoinGraph(*mOriginalJoinGraph);
+        mJoinGraphEvidence.clear();
+        mFailedSinceIJGP = false;
 
         aAssignment = Assignment();
 
-        return _getSampleInternal(aAssignment, mProblem->getVariables()->begin());
+        if (!mNogoods)
+                return _getSampleInternal(aAssignment, 0);
+
+        std::map<VarIdType, Domain> removedValues;
+        bool sampleFound = _pruneUnaryNogoods(removedValues) && _getSampleInternal(aAssignment, 0);
+        mProblem->restoreDomains(removedValues);
+
+        return sampleFound;
 }
 
-bool IJGPSampler::_getSampleInternal(Assignment & aEvidence, VariableMap::const_iterator aVarIterator,
-                VarIdType aLastChangedVariable) {
+bool IJGPSampler::_pruneUnaryNogoods(std::map<VarIdType, Domain> & outRemovedValues) {
+        std::vector<Literal> literals;
+        mNogoods->getUnaryNogoods(literals);
 
-        if (aVarIterator == mProblem->getVariables()->end()) {
-                return true; // We have reached the last variable
-        } else {
-                std::map<VarIdType, Domain> removedValues;
-                bool domainsNotEmpty = !mNoSolutionExists;
+        Assignment evidence;
+        for (std::vector<Literal>::const_iterator litIt = literals.begin(); litIt != literals.end(); ++litIt) {
+                Variable * var = mProblem->getVariableById(litIt->first);
+                if (var->getDomain()->find(litIt->second) == var->getDomain()->end())
+                        continue;
+
+                var->eraseFromDomain(litIt->second);
+                outRemovedValues[litIt->first].insert(litIt->second);
+
+                if (var->getDomain()->empty() || !mProblem->propagateConstraints(evidence, outRemovedValues, litIt->first))
+                        return false;
+        }
 
-                if (!aEvidence.empty()) {
-                        domainsNotEmpty = mProblem->propagateConstraints(aEvidence, removedValues, aLastChangedVariable);
+        return true;
+}
+
+bool IJGPSampler::_searchStolenValue(Assignment & aEvidence, VarIdType aVarId) {
+        assert(aEvidence.find(aVarId) != aEvidence.end());
+
+        // The subproblem starts from the domains of the initial propagation. All the variables are
+        // assigned and all but aVarId propagated (the search propagates it), which gives the same
+        // domains as the search of the owner since the closure does not depend on the order.
+        std::vector<Variable *> restrictedVars;
+        std::vector<Domain> restrictedValues(aEvidence.size());
+        std::vector<std::map<VarIdType, Domain> > removedValues(aEvidence.size());
+        bool domainsNotEmpty = !mNoSolutionExists;
+
+        size_t conflictTrail = mProblem->getConflictTrailSize();
+        mRunAborted = false;
+
+        Assignment partialAssignment;
+        for (Assignment::const_iterator aIt = aEvidence.begin(); domainsNotEmpty && aIt != aEvidence.end(); ++aIt) {
+                size_t index = restrictedVars.size();
+                restrictedVars.push_back(mProblem->getVariableById(aIt->first));
+                restrictedVars.back()->restrictDomainToValue(aIt->second, restrictedValues[index]);
+                partialAssignment[aIt->first] = aIt->second;
+
+                if (mProblem->isTrackingConflicts())
+                        mProblem->setAssignmentDepth(aIt->first, index);
+
+                if (aIt->first != aVarId) {
+                        domainsNotEmpty = mProblem->propagateConstraints(partialAssignment, removedValues[index],
+                                        aIt->first);
                 }
+        }
 
-                if (domainsNotEmpty) {
-                        // Select variable, and its value
-                        Variable * targetVar = aVarIterator->second;
+        bool sampleFound = false;
+        if (domainsNotEmpty) {
+                // The join graph of the owner depends on its history, the helper conditions its own on the evidence
+                delete mJoinGraph;
+                mJoinGraph = new JoinGraph(*mOriginalJoinGraph);
+                mJoinGraphEvidence.clear();
+                _propagateJoinGraph(aEvidence, 0);
 
-                        // Run IJGP with probability mIJGPProbability
-                        if (!aEvidence.empty() && (rand() / (double)RAND_MAX) < mIJGPProbability) {
-                                mJoinGraph->iterativePropagation(mProblem, aEvidence, mMaxIJGPIterations);
-                        }
+                sampleFound = _getSampleInternal(aEvidence, aEvidence.size(), aVarId);
+        }
+
+        for (size_t i = restrictedVars.size(); i-- > 0; ) {
+                mProblem->restoreDomains(removedValues[i]);
+                restrictedVars[i]->restoreRestrictedDomain(restrictedValues[i]);
+
+                if (mProblem->isTrackingConflicts())
+                        mProblem->setAssignmentDepth(restrictedVars[i]->getId(), -1);
+        }
+        mProblem->restoreConflicts(conflictTrail);
+
+        return sampleFound;
+}
 
-                        ProbabilityDistribution dist = mJoinGraph->conditionalDistribution(mProblem,
-                                        targetVar, aEvidence);
+bool IJGPSampler::_getSampleInternal(Assignment & aEvidence, VarIdType aVarIndex,
+                VarIdType aLastChangedVariable) {
 
-                        //std::cout << probability_distribution_pprint(dist) << std::endl;
+        const VarIdType numVariables = mProblem->getVariables()->size();
+        const bool trackConflicts = mProblem->isTrackingConflicts();
+        VarIdType varIndex = aVarIndex;
+        VarIdType lastChangedVariable = aLastChangedVariable;
+        bool sampleFound = false;
 
-                        while (!dist.empty()) {
-                                VarType value = _sampleFromDistribution(targetVar, dist);
-                                aEvidence[targetVar->getId()] = value;
+        while (true) {
+                bool descend = false;
 
-                                Domain targetVarRemovedValues;
+                // With backjumping or nogoods the depths which caused the failure, 0 if they are not known
+                ConflictSet * conflict = 0;
 
-                                targetVar->restrictDomainToValue(value, targetVarRemovedValues);
-                                ++aVarIterator;
+                if (varIndex == numVariables) {
+                        sampleFound = true; // We have reached the last variable
+                        mSampleLogProposal = 0;
+                } else if (_runLimitReached()) {
+                        sampleFound = false;
+                } else {
+                        SampleFrame & frame = mSampleFrames[varIndex];
+                        bool domainsNotEmpty = !mNoSolutionExists;
+                        bool nogoodFailed = false;
+
+                        frame.removedValues.clear();
+                        frame.dist.clear();
+                        frame.published = false;
+                        frame.conflictTrail = mProblem->getConflictTrailSize();
+
+                        if (!aEvidence.empty()) {
+                                domainsNotEmpty = mProblem->propagateConstraints(aEvidence, frame.removedValues,
+                                                lastChangedVariable);
+
+                                if (domainsNotEmpty && mNogoods) {
+                                        domainsNotEmpty = _propagateNogoods(aEvidence, lastChangedVariable, frame);
+                                        nogoodFailed = !domainsNotEmpty;
+                                }
+                        }
 
-                                bool sampleFound = _getSampleInternal(aEvidence, aVarIterator, targetVar->getId());
+                        if (domainsNotEmpty) {
+                                // Select variable, and its value
+                                frame.var = mSelector.selectVariable(mProblem, aEvidence, varIndex);
 
-                                --aVarIterator;
-                                targetVar->restoreRestrictedDomain(targetVarRemovedValues);
+                                if (mBudgetDeadline > 0)
+                                        mIJGPEffort = _budgetEffort(current_time());
 
-                                if (!sampleFound) {
-                                        aEvidence.erase(targetVar->getId());
-                                        dist.erase(value);
+                                if (mIJGPController) {
+                                        _adaptiveDistribution(frame, aEvidence);
                                 } else {
-                                        mProblem->restoreDomains(removedValues);
-                                        return true; // Yep, we have a sample
+                                        // Run IJGP with probability mIJGPProbability (lowered near the deadline)
+                                        if (!aEvidence.empty() && (random_int() / (double)RAND_MAX) < mIJGPProbability * mIJGPEffort) {
+                                                _propagateJoinGraph(aEvidence, frame.var);
+                                        }
+
+                                        frame.dist = mJoinGraph->conditionalDistribution(mProblem, frame.var, aEvidence,
+                                                        mDistributionCache);
                                 }
+
+                                if (trackConflicts)
+                                        frame.conflict = mProblem->getConflict(frame.var->getId());
+
+                                if (!mHelpers.empty())
+                                        _publishFrame(frame, aEvidence);
+                        } else {
+                                if (!mQuiet)
+                                        std::cout << "No solution found, backtracking from evidence " << assignment_pprint(aEvidence) << std::endl;
+                                ++mNumBacktracks;
+                                mFailedSinceIJGP = true;
+
+                                if (trackConflicts && !nogoodFailed)
+                                        frame.conflict = mProblem->getFailureConflict();
                         }
-                } else {
-                        std::cout << "No solution found, backtracking from evidence " << assignment_pprint(aEvidence) << std::endl;
+
+                        descend = _assignNextValue(frame, varIndex, aEvidence);
+                        if (!descend) {
+                                sampleFound = _leaveFrame(frame, varIndex, aEvidence, false, false);
+                                if (mNogoods && !sampleFound)
+                                        _learnNogood(frame.conflict, aEvidence);
+
+                                conflict = &frame.conflict;
+                        }
+                }
+
+                // Return to the previous frames until one of them has a value left to try
+                while (!descend && varIndex > aVarIndex) {
+                        SampleFrame & frame = mSampleFrames[--varIndex];
+                        bool jumping = false;
+
+                        frame.var->restoreRestrictedDomain(frame.restrictedValues);
+                        if (trackConflicts)
+                                mProblem->setAssignmentDepth(frame.var->getId(), -1);
+
+                        if (!sampleFound) {
+                                aEvidence.erase(frame.var->getId());
+                                if (!frame.published)
+                                        frame.dist.erase(frame.value);
+
+                                if (mRunAborted) {
+                                        // The values left are not tried in this run
+                                        jumping = true;
+                                } else if (trackConflicts) {
+                                        if (!conflict) {
+                                                frame.conflict.insertBelow(varIndex);
+                                        } else if (conflict->contains(varIndex)) {
+                                                conflict->erase(varIndex);
+                                                frame.conflict.merge(*conflict);
+                                        } else if (mBackjumping) {
+                                                // The value did not cause the failure, neither would the others
+                                                jumping = true;
+                                        } else {
+                                                frame.conflict.merge(*conflict);
+                                        }
+                                }
+
+                                if (!jumping)
+                                        descend = _assignNextValue(frame, varIndex, aEvidence);
+                        }
+
+                        if (!descend) {
+                                if (sampleFound)
+                                        mSampleLogProposal += frame.logProposal;
+
+                                sampleFound = _leaveFrame(frame, varIndex, aEvidence, sampleFound, jumping);
+                                if (mNogoods && !sampleFound && !jumping)
+                                        _learnNogood(frame.conflict, aEvidence);
+
+                                if (!jumping)
+                                        conflict = &frame.conflict;
+                        }
+                }
+
+                if (!descend)
+                        return sampleFound;
+
+                lastChangedVariable = mSampleFrames[varIndex].var->getId();
+                ++varIndex;
+        }
+}
+
+bool IJGPSampler::_runLimitReached() {
+        if (!mRunAborted) {
+                mRunAborted = (mBacktrackLimit > 0 && mNumBacktracks >= mBacktrackLimit)
+                        || (mSampleDeadline > 0 && current_time() >= mSampleDeadline)
+                        || _stolenSearchCancelled();
+        }
+
+        return mRunAborted;
+}
+
+double IJGPSampler::_budgetEffort(double aNow) const {
+        if (mBudgetDeadline <= 0)
+                return 1.0;
+
+        // The full effort in the first half of the budget, then it falls linearly
+        double half = (mBudgetDeadline - mBudgetStart) / 2;
+        double remaining = mBudgetDeadline - aNow;
+        if (half <= 0 || remaining >= half)
+                return 1.0;
+
+        return remaining > 0 ? remaining / half : 0.0;
+}
+
+unsigned int IJGPSampler::_ijgpIterations() const {
+        if (mIJGPEffort >= 1.0)
+                return mMaxIJGPIterations;
+
+        unsigned int iterations = (unsigned int)ceil(mMaxIJGPIterations * mIJGPEffort);
+        return iterations > 0 ? iterations : 1;
+}
+
+void IJGPSampler::_propagateJoinGraph(Assignment & aEvidence, Variable * aTargetVariable) {
+        if (mLazyDepth > 0 && aTargetVariable) {
+                mJoinGraph->lazyPropagation(mProblem, aEvidence, aTargetVariable, mLazyDepth, _ijgpIterations());
+                mJoinGraphEvidence = aEvidence;
+                return;
+        }
+
+        if (!mWarmStart) {
+                mJoinGraph->iterativePropagation(mProblem, aEvidence, _ijgpIterations());
+                mJoinGraphEvidence = aEvidence;
+                return;
+        }
+
+        std::map<Assignment, JoinGraphMessages *>::const_iterator cachedIt = mCachedMessages.find(aEvidence);
+        if (cachedIt != mCachedMessages.end()) {
+                mJoinGraph->restoreMessages(*cachedIt->second);
+                mJoinGraphEvidence = aEvidence;
+                return;
+        }
+
+        // Start from the messages of the last run at this depth if its evidence is closer than
+        // that of the last run on the graph (usually the parent, after a backtrack a failed branch)
+        JoinGraphMessages *& depthMessages = mDepthMessages[aEvidence.size()];
+        Assignment & depthEvidence = mDepthEvidence[aEvidence.size()];
+        if (depthMessages && _commonAssignments(depthEvidence, aEvidence) > _commonAssignments(mJoinGraphEvidence, aEvidence))
+                mJoinGraph->restoreMessages(*depthMessages);
+
+        mJoinGraph->iterativePropagation(mProblem, aEvidence, _ijgpIterations());
+        mJoinGraphEvidence = aEvidence;
+
+        delete depthMessages;
+        depthMessages = mJoinGraph->saveMessages();
+        depthEvidence = aEvidence;
+
+        if (mWarmStartCacheSize > 0) {
+                if (mCachedEvidence.size() == mWarmStartCacheSize) {
+                        // Forget the oldest run
+                        delete mCachedMessages[mCachedEvidence.front()];
+                        mCachedMessages.erase(mCachedEvidence.front());
+                        mCachedEvidence.pop_front();
                 }
-                
-                // If no try has been succesful, restore the domains and return false
-                mProblem->restoreDomains(removedValues);
 
+                mCachedMessages[aEvidence] = mJoinGraph->saveMessages();
+                mCachedEvidence.push_back(aEvidence);
+        }
+}
+
+void IJGPSampler::_adaptiveDistribution(SampleFrame & aFrame, Assignment & aEvidence) {
+        const Scope * scope = mJoinGraph->getDistributionScope(aFrame.var->getId());
+        assert(scope);
+
+        ProbabilityDistribution before = mJoinGraph->conditionalDistribution(mProblem, aFrame.var, aEvidence,
+                        mDistributionCache);
+
+        unsigned int numChanged = _countChangedEvidence(*scope, aEvidence);
+        if (aEvidence.empty() || !mIJGPController->shouldRun(numChanged, mFailedSinceIJGP)) {
+                aFrame.dist = before;
+                return;
+        }
+
+        double startTime = current_time();
+        _propagateJoinGraph(aEvidence, aFrame.var);
+        mFailedSinceIJGP = false;
+
+        aFrame.dist = mJoinGraph->conditionalDistribution(mProblem, aFrame.var, aEvidence, mDistributionCache);
+        mIJGPController->recordRun(numChanged, current_time() - startTime, before, aFrame.dist);
+}
+
+unsigned int IJGPSampler::_countChangedEvidence(const Scope & aScope, const Assignment & aEvidence) const {
+        unsigned int numChanged = 0;
+        for (Scope::const_iterator scIt = aScope.begin(); scIt != aScope.end(); ++scIt) {
+                Assignment::const_iterator aIt = aEvidence.find(*scIt);
+                Assignment::const_iterator lastIt = mJoinGraphEvidence.find(*scIt);
+
+                if (aIt == aEvidence.end() ? lastIt != mJoinGraphEvidence.end()
+                                : (lastIt == mJoinGraphEvidence.end() || lastIt->second != aIt->second)) {
+                        ++numChanged;
+                }
+        }
+
+        return numChanged;
+}
+
+size_t IJGPSampler::_commonAssignments(const Assignment & aFirst, const Assignment & aSecond) {
+        size_t numCommon = 0;
+        for (Assignment::const_iterator aIt = aFirst.begin(); aIt != aFirst.end(); ++aIt) {
+                Assignment::const_iterator secondIt = aSecond.find(aIt->first);
+                if (secondIt != aSecond.end() && secondIt->second == aIt->second)
+                        ++numCommon;
+        }
+
+        return numCommon;
+}
+
+bool IJGPSampler::_propagateNogoods(Assignment & aEvidence, VarIdType aVarId, SampleFrame & aFrame) {
+        const Nogood * violated = 0;
+        mNogoodUnits.clear();
+
+        if (!mNogoods->propagate(aVarId, aEvidence[aVarId], aEvidence, mNogoodUnits, violated)) {
+                _nogoodReason(*violated, mProblem->getVariables()->size(), aFrame.conflict);
                 return false;
         }
+
+        for (std::vector<const Nogood *>::const_iterator unitIt = mNogoodUnits.begin(); unitIt != mNogoodUnits.end(); ++unitIt) {
+                // The only literal whose variable is not assigned must not hold
+                Nogood::const_iterator litIt = (*unitIt)->begin();
+                while (aEvidence.find(litIt->first) != aEvidence.end())
+                        ++litIt;
+
+                Variable * var = mProblem->getVariableById(litIt->first);
+                if (var->getDomain()->find(litIt->second) == var->getDomain()->end())
+                        continue;
+
+                var->eraseFromDomain(litIt->second);
+                aFrame.removedValues[litIt->first].insert(litIt->second);
+
+                ConflictSet reason;
+                _nogoodReason(**unitIt, litIt->first, reason);
+                mProblem->explainRemoval(litIt->first, reason);
+
+                if (var->getDomain()->empty()) {
+                        aFrame.conflict = mProblem->getConflict(litIt->first);
+                        return false;
+                } else if (!mProblem->propagateConstraints(aEvidence, aFrame.removedValues, litIt->first)) {
+                        aFrame.conflict = mProblem->getFailureConflict();
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+void IJGPSampler::_learnNogood(const ConflictSet & aConflict, const Assignment & aEvidence) {
+        // A cancelled search gives up without a proof
+        if (_stolenSearchCancelled())
+                return;
+
+        Nogood nogood;
+        std::vector<int> depths;
+        for (Assignment::const_iterator aIt = aEvidence.begin(); aIt != aEvidence.end(); ++aIt) {
+                int depth = mProblem->getAssignmentDepth(aIt->first);
+                if (depth >= 0 && aConflict.contains(depth)) {
+                        nogood.push_back(Literal(aIt->first, aIt->second));
+                        depths.push_back(depth);
+                }
+        }
+
+        mNogoods->add(nogood, depths);
+}
+
+void IJGPSampler::_nogoodReason(const Nogood & aNogood, VarIdType aVarId, ConflictSet & outReason) {
+        outReason = ConflictSet(mProblem->getVariables()->size());
+
+        for (Nogood::const_iterator litIt = aNogood.begin(); litIt != aNogood.end(); ++litIt) {
+                int depth = mProblem->getAssignmentDepth(litIt->first);
+                if (litIt->first != aVarId && depth >= 0)
+                        outReason.insert(depth);
+        }
+}
+
+void IJGPSampler::_publishFrame(SampleFrame & aFrame, const Assignment & aEvidence) {
+        aFrame.evidence = aEvidence;
+        aFrame.values.clear();
+        _drawValueOrder(aFrame.var, aFrame.dist, aFrame.values);
+
+        // The values before a value in the order have failed when it is tried
+        ProbabilityDistribution dist = aFrame.dist;
+        aFrame.logProposals.resize(aFrame.values.size());
+        for (size_t slot = 0; slot < aFrame.values.size(); ++slot) {
+                aFrame.logProposals[slot] = _logProposal(aFrame.var, dist, aFrame.values[slot]);
+                dist.erase(aFrame.values[slot]);
+        }
+        aFrame.states.assign(aFrame.values.size(), SLOT_OPEN);
+        aFrame.found.resize(aFrame.values.size());
+        aFrame.foundLogProposals.resize(aFrame.values.size());
+        aFrame.front = 0;
+        aFrame.back = aFrame.values.size();
+        aFrame.numStolen = 0;
+        aFrame.cancelled = false;
+        aFrame.published = true;
+
+        pthread_mutex_lock(&mSearchMutex);
+        mFrames.push_back(&aFrame);
+        pthread_cond_broadcast(&mSearchChanged);
+        pthread_mutex_unlock(&mSearchMutex);
+}
+
+bool IJGPSampler::_assignNextValue(SampleFrame & aFrame, VarIdType aDepth, Assignment & aEvidence) {
+        if (aFrame.published) {
+                pthread_mutex_lock(&mSearchMutex);
+                bool valueLeft = aFrame.front < aFrame.back;
+                if (valueLeft) {
+                        aFrame.value = aFrame.values[aFrame.front];
+                        aFrame.logProposal = aFrame.logProposals[aFrame.front++];
+                }
+                pthread_mutex_unlock(&mSearchMutex);
+
+                if (!valueLeft)
+                        return false;
+        } else if (!aFrame.dist.empty()) {
+                aFrame.value = _sampleFromDistribution(aFrame.var, aFrame.dist);
+                aFrame.logProposal = _logProposal(aFrame.var, aFrame.dist, aFrame.value);
+        } else {
+                return false;
+        }
+
+        aEvidence[aFrame.var->getId()] = aFrame.value;
+
+        aFrame.restrictedValues.clear();
+        aFrame.var->restrictDomainToValue(aFrame.value, aFrame.restrictedValues);
+
+        if (mProblem->isTrackingConflicts())
+                mProblem->setAssignmentDepth(aFrame.var->getId(), aDepth);
+
+        return true;
+}
+
+bool IJGPSampler::_leaveFrame(SampleFrame & aFrame, VarIdType aDepth, Assignment & aEvidence,
+                bool aSampleFound, bool aJumping) {
+
+        if (aFrame.published) {
+                pthread_mutex_lock(&mSearchMutex);
+
+                // The helpers do not explain their failures
+                if (mProblem->isTrackingConflicts() && !aSampleFound && !aJumping && aFrame.back < aFrame.values.size())
+                        aFrame.conflict.insertBelow(aDepth);
+
+                // The stolen values are the last ones in the order, the first one found is the sample
+                for (size_t slot = aFrame.back; !aSampleFound && !aJumping && slot < aFrame.values.size(); ++slot) {
+                        while (aFrame.states[slot] == SLOT_STOLEN)
+                                pthread_cond_wait(&mSearchChanged, &mSearchMutex);
+
+                        if (aFrame.states[slot] == SLOT_FOUND) {
+                                aEvidence.swap(aFrame.found[slot]);
+                                mSampleLogProposal = aFrame.foundLogProposals[slot];
+                                aSampleFound = true;
+                        }
+                }
+
+                // The remaining helpers are not needed any more
+                aFrame.cancelled = true;
+                while (aFrame.numStolen > 0)
+                        pthread_cond_wait(&mSearchChanged, &mSearchMutex);
+
+                assert(mFrames.back() == &aFrame);
+                mFrames.pop_back();
+                pthread_mutex_unlock(&mSearchMutex);
+
+                aFrame.found.clear();
+        }
+
+        mProblem->restoreDomains(aFrame.removedValues);
+        mProblem->restoreConflicts(aFrame.conflictTrail);
+
+        return aSampleFound;
+}
+
+double IJGPSampler::_logProposal(Variable * aVariable, const ProbabilityDistribution & aDistribution, VarType aValue) {
+        double totalProbability = 0.0;
+
+        for (ProbabilityDistribution::const_iterator pIt = aDistribution.begin();
+                        pIt != aDistribution.end(); ++pIt) {
+
+                totalProbability += pIt->second;
+        }
+
+        // _sampleFromDistribution selects uniformly from the domain
+        if (totalProbability == 0.0)
+                return -log((double)aVariable->getDomain()->size());
+
+        ProbabilityDistribution::const_iterator pIt = aDistribution.find(aValue);
+        assert(pIt != aDistribution.end());
+
+        return log(pIt->second / totalProbability);
+}
+
+void IJGPSampler::_drawValueOrder(Variable * aVariable, const ProbabilityDistribution & aDistribution,
+                std::vector<VarType> & outValues) {
+        ProbabilityDistribution dist = aDistribution;
+
+        while (!dist.empty()) {
+                VarType value = _sampleFromDistribution(aVariable, dist);
+
+                if (dist.erase(value) > 0)
+                        outValues.push_back(value);
+        }
 }
 
 VarType IJGPSampler::_sampleFromDistribution(Variable * aVariable, const ProbabilityDistribution & aDistribution) {
@@ -131,7 +929,7 @@ VarType IJGPSampler::_sampleFromDistribution(Variable * aVariable, const Probabi
                 return random_select(aVariable->getDomain());
         }
 
-        double selectedProbability = (rand()*1.0/RAND_MAX) * totalProbability;
+        double selectedProbability = (random_int()*1.0/RAND_MAX) * totalProbability;
         double accumulatedProbability = 0.0;
 
         for (ProbabilityDistribution::const_iterator pIt = aDistribution.begin();
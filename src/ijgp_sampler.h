@@ -22,8 +22,17 @@
 #ifndef IJGP_SAMPLER_H_
 #define IJGP_SAMPLER_H_
 
+#include <pthread.h>
+
+#include <deque>
+#include <vector>
+
 #include "csp.h"
 #include "ijgp.h"
+#include "ijgp_controller.h"
+#include "nogood_store.h"
+#include "restart_policy.h"
+#include "variable_ordering.h"
 
 class IJGPSampler: public CSPSampler {
 public:
@@ -32,21 +41,383 @@ public:
         ~IJGPSampler();
         
         virtual bool getSample(Assignment & aAssignment);
+
+        virtual bool sampleAbandoned() const {
+                return mSampleAbandoned;
+        };
+
+        virtual unsigned long getNumRestarts() const {
+                return mNumRestarts;
+        };
+
+        /**
+         * The weight of the sample is its value (CSPProblem::evalLogAssignment) divided by the
+         * probability of drawing it from the backtrack-free proposal, i.e. the distributions
+         * of the join graph restricted to the values which had not failed when the value of
+         * the variable was drawn (as in SampleSearch)
+         */
+        virtual double getSampleLogWeight() const {
+                return mSampleLogWeight;
+        };
+
+        /**
+         * In the second half of the budget, IJGP runs with fewer iterations and (without the
+         * adaptive controller) with a lower probability, down to one iteration and none at the
+         * deadline. The search of a sample is abandoned at the deadline.
+         */
+        virtual void setTimeBudget(double aStart, double aDeadline);
+
+        virtual void setQuiet(bool aQuiet);
+
+        /**
+         * The worker starts from a copy of the join graph after the initial propagation
+         */
+        virtual CSPSampler * createWorker() const;
+
+        /**
+         * Selects the order in which the variables are assigned (ORDERING_LEX by default)
+         */
+        void setVariableOrdering(VariableOrdering aOrdering);
+
+        /**
+         * Conflict-directed backjumping: the propagation explains the removed values by the
+         * depths of the assignments which caused them. When all the values of a variable
+         * fail, the search returns straight to the deepest assignment explaining the failures.
+         * The skipped variables would fail with all their values, so the values are chosen with
+         * the same probabilities as with chronological backtracking.
+         */
+        void setBackjumping(bool aBackjumping);
+
+        /**
+         * Nogood learning: when all the values of a variable fail, the assignments explaining
+         * the failures (as with backjumping) are stored as a nogood of at most aMaxSize
+         * literals. The nogoods prune the domains of the later searches and samples, a nogood
+         * of a single literal prunes the domain before the search. At most aMaxNogoods are
+         * kept, 0 turns the learning off.
+         */
+        void setNogoodLearning(size_t aMaxNogoods, unsigned int aMaxSize);
+
+        /**
+         * Restarts the search of a sample from the root when the number of backtracks
+         * reaches the next limit of aSchedule; the values are drawn again and the join
+         * graph starts from the initial propagation. aTimeLimit (in seconds, 0 for none)
+         * bounds the whole search of a sample, which is abandoned when it runs out.
+         */
+        void setRestarts(const RestartSchedule & aSchedule, double aTimeLimit);
+
+        /**
+         * IJGP stops when the KL divergence of the messages of two sweeps is less than aTolerance
+         */
+        void setConvergenceTolerance(double aTolerance);
+
+        /**
+         * Warm start of IJGP: a run starts from the messages of the last run with as many
+         * assigned variables, and the messages of the last aCacheSize runs are kept by their
+         * evidence and used instead of a run with the same evidence
+         */
+        void setWarmStart(bool aWarmStart, size_t aCacheSize);
+
+        /**
+         * Instead of running IJGP on the whole join graph, computes only the messages the
+         * distribution of the next variable depends on, to aMaxDepth edges from its node
+         * (JoinGraph::lazyPropagation), 0 for the whole graph. The messages stay in the join
+         * graph of the sample and are computed again only when they are dirty, so the warm
+         * start is not used. A search helper propagates its stolen evidence in the whole graph.
+         */
+        void setLazyPropagation(unsigned int aMaxDepth);
+
+        /**
+         * Keeps the last aMaxSize conditional distributions computed in the join graph
+         * (0 for none), so that they are not computed again for the same evidence in the
+         * cluster and the same messages. Every thread has a cache of its own.
+         */
+        void setDistributionCache(size_t aMaxSize);
+
+        /**
+         * The distribution cache, 0 without it
+         */
+        const DistributionCache * getDistributionCache() const {
+                return mDistributionCache;
+        };
+
+        /**
+         * Instead of running IJGP with the fixed probability, an IJGPController with
+         * aGainRate decides when to run it (the search threads decide on their own)
+         */
+        void setAdaptiveIJGP(bool aAdaptive, double aGainRate);
+
+        /**
+         * The controller of the IJGP runs, 0 if they are random
+         */
+        const IJGPController * getIJGPController() const {
+                return mIJGPController;
+        };
+
+        /**
+         * The learned nogoods, 0 without nogood learning
+         */
+        NogoodStore * getNogoodStore() {
+                return mNogoods;
+        };
+
+        /**
+         * Searches for every sample with aNumThreads threads. The values of a variable are
+         * tried in an order drawn from its distribution in advance; an idle helper thread
+         * steals the last untried value of the shallowest variable on the search stack
+         * and searches that subproblem with its own copy of the problem. A sample found
+         * by a helper is used only when all the values before it have failed (the
+         * portfolio rule), so every value is chosen as often as in a single thread.
+         */
+        void setSearchThreads(unsigned int aNumThreads);
 private:
+        IJGPSampler(const IJGPSampler & aSampler);
+
+        enum SlotState {
+                SLOT_OPEN,
+                SLOT_STOLEN,
+                SLOT_FAILED,
+                SLOT_FOUND
+        };
+
+        /**
+         * A variable on the search stack of the sample. The frames of all the variables are
+         * allocated with the sampler, so the search of a sample does not recurse and reuses them.
+         *
+         * With helpers the frame is published for them, with the partial assignment of the
+         * variables before it and the values in an order drawn in advance. The untried values
+         * are those in [front, back), the owner takes them from the front, the helpers from the back.
+         */
+        struct SampleFrame {
+                Variable * var;
+                VarType value;
+
+                // Log of the probability of drawing the value from the values which had not failed
+                double logProposal;
+
+                // Values removed by the propagation of the previous variable and by restricting var to value
+                std::map<VarIdType, Domain> removedValues;
+                Domain restrictedValues;
+                ProbabilityDistribution dist;
+
+                // With backjumping or nogoods: the depths explaining the failures of the variable so far
+                // and the conflict trail at the entry of the frame
+                ConflictSet conflict;
+                size_t conflictTrail;
+
+                bool published;
+                Assignment evidence;
+                std::vector<VarType> values;
+                std::vector<double> logProposals;
+                std::vector<SlotState> states;
+                std::vector<Assignment> found;
+                std::vector<double> foundLogProposals;
+                size_t front, back;
+                unsigned int numStolen;
+                bool cancelled;
+        };
+
+        struct SearchHelper {
+                IJGPSampler * owner;
+                IJGPSampler * sampler;
+                unsigned int index;
+                pthread_t thread;
+
+                // The search of the owner the helper has been seeded for
+                unsigned long numSearches;
+        };
+
+        static void * _runHelper(void * aHelper);
+
+        void _stopHelpers();
+
+        /**
+         * The shallowest frame with an untried value, 0 if there is none (called with mSearchMutex)
+         */
+        SampleFrame * _frameToSteal();
+
+        /**
+         * Draws the order in which the values of the variable are tried, i.e. samples
+         * from the distribution without replacement
+         */
+        void _drawValueOrder(Variable * aVariable, const ProbabilityDistribution & aDistribution,
+                        std::vector<VarType> & outValues);
+
+        /**
+         * Searches the subproblem given by aEvidence (aVarId is its last variable) in a helper
+         */
+        bool _searchStolenValue(Assignment & aEvidence, VarIdType aVarId);
+
+        /**
+         * True if the helper searches a value which is no longer needed
+         */
+        bool _stolenSearchCancelled();
+
         /**
          * Sample from given distribution for a given variable
          */
         VarType _sampleFromDistribution(Variable * aVariable, const ProbabilityDistribution & aDistribution);
 
-        bool _getSampleInternal(Assignment & aEvidence, VariableMap::const_iterator aVarIterator,
+        /**
+         * Log of the probability that _sampleFromDistribution selects aValue
+         */
+        double _logProposal(Variable * aVariable, const ProbabilityDistribution & aDistribution, VarType aValue);
+
+        /**
+         * One run of the search of a sample from the root
+         */
+        bool _getSampleRun(Assignment & aAssignment);
+
+        bool _getSampleInternal(Assignment & aEvidence, VarIdType aVarIndex,
                 VarIdType aLastChangedVariable = 0);
 
+        /**
+         * True if the run has reached its backtrack limit or the sample its time limit, or if
+         * the value searched by the helper is no longer needed
+         */
+        bool _runLimitReached();
+
+        /**
+         * The share of the full IJGP effort (from 0 to 1) left at aNow by the time budget
+         */
+        double _budgetEffort(double aNow) const;
+
+        /**
+         * The maximal number of IJGP iterations with the current effort
+         */
+        unsigned int _ijgpIterations() const;
+
+        /**
+         * Runs IJGP on the join graph of the sample (with the warm start if it is on), or
+         * only for the distribution of aTargetVariable with the lazy propagation
+         */
+        void _propagateJoinGraph(Assignment & aEvidence, Variable * aTargetVariable);
+
+        /**
+         * Computes the distribution of the variable of the frame, after a run of IJGP if the
+         * controller decides so
+         */
+        void _adaptiveDistribution(SampleFrame & aFrame, Assignment & aEvidence);
+
+        /**
+         * The number of the variables of aScope whose evidence differs from that of the last
+         * run of IJGP on the join graph
+         */
+        unsigned int _countChangedEvidence(const Scope & aScope, const Assignment & aEvidence) const;
+
+        /**
+         * The number of the variables assigned the same value in both assignments
+         */
+        static size_t _commonAssignments(const Assignment & aFirst, const Assignment & aSecond);
+
+        /**
+         * Removes the values of the unary nogoods from the domains before the search
+         */
+        bool _pruneUnaryNogoods(std::map<VarIdType, Domain> & outRemovedValues);
+
+        /**
+         * Propagates the nogoods watching aVarId, removes the last values of the unit nogoods
+         * into the frame and propagates the constraints. On failure the frame gets the conflict.
+         */
+        bool _propagateNogoods(Assignment & aEvidence, VarIdType aVarId, SampleFrame & aFrame);
+
+        /**
+         * Stores the assignments of aEvidence at the depths of aConflict as a nogood
+         */
+        void _learnNogood(const ConflictSet & aConflict, const Assignment & aEvidence);
+
+        /**
+         * The depths of the assigned literals of a nogood, except aVarId
+         */
+        void _nogoodReason(const Nogood & aNogood, VarIdType aVarId, ConflictSet & outReason);
+
+        void _publishFrame(SampleFrame & aFrame, const Assignment & aEvidence);
+
+        /**
+         * Assigns the next value to try to the variable of the frame, false if there is none
+         */
+        bool _assignNextValue(SampleFrame & aFrame, VarIdType aDepth, Assignment & aEvidence);
+
+        /**
+         * Restores the domains of the frame. Returns whether a sample has been found, which is also
+         * the case when the frame had its values stolen and a helper has found one (the results of
+         * the helpers are dropped when the search jumps over the frame).
+         */
+        bool _leaveFrame(SampleFrame & aFrame, VarIdType aDepth, Assignment & aEvidence,
+                        bool aSampleFound, bool aJumping);
+
         JoinGraph * mJoinGraph, *mOriginalJoinGraph;
         unsigned int mMaxBucketSize;
         double mIJGPProbability;
         unsigned int mMaxIJGPIterations;
 
         bool mNoSolutionExists;
+
+        // The search stack, one frame per variable
+        std::vector<SampleFrame> mSampleFrames;
+
+        VariableSelector mSelector;
+        bool mBackjumping;
+        bool mQuiet;
+
+        NogoodStore * mNogoods;
+        std::vector<const Nogood *> mNogoodUnits;
+
+        RestartSchedule mRestartSchedule;
+        double mSampleTimeLimit;
+
+        // The limits and the backtracks of the current run (0 for no limit)
+        unsigned long mBacktrackLimit, mNumBacktracks;
+        double mSampleDeadline;
+        bool mRunAborted;
+
+        bool mSampleAbandoned;
+        unsigned long mNumRestarts;
+
+        // The time budget of the sampling (0 for none) and the current IJGP effort
+        double mBudgetStart, mBudgetDeadline;
+        double mIJGPEffort;
+
+        bool mWarmStart;
+        size_t mWarmStartCacheSize;
+        unsigned int mLazyDepth;
+
+        // The messages of the last IJGP run by the number of the assigned variables, with its
+        // evidence, and the evidence of the last run on the join graph of the sample
+        std::vector<JoinGraphMessages *> mDepthMessages;
+        std::vector<Assignment> mDepthEvidence;
+        Assignment mJoinGraphEvidence;
+
+        // The messages of the last runs by their evidence, mCachedEvidence in the order of the runs
+        std::map<Assignment, JoinGraphMessages *> mCachedMessages;
+        std::deque<Assignment> mCachedEvidence;
+
+        DistributionCache * mDistributionCache;
+
+        // With the adaptive IJGP runs: the controller and whether the search failed since the last run
+        IJGPController * mIJGPController;
+        bool mFailedSinceIJGP;
+
+        // Log of the proposal probability of the sample found by the search (of the frames
+        // from the one it was started at) and the log weight of the last sample
+        double mSampleLogProposal;
+        double mSampleLogWeight;
+
+        std::vector<SearchHelper> mHelpers;
+
+        // The published frames and mShuttingDown are guarded by mSearchMutex
+        pthread_mutex_t mSearchMutex;
+        pthread_cond_t mSearchChanged;
+        std::vector<SampleFrame *> mFrames;
+        bool mShuttingDown;
+
+        // The seed of the helpers (drawn from the stream of the owner) for its current search,
+        // also guarded by mSearchMutex
+        unsigned int mSearchSeed;
+        unsigned long mNumSearches;
+
+        // In a helper: the sampler whose search it helps and the frame of the stolen value
+        IJGPSampler * mOwner;
+        SampleFrame * mStolenFrame;
 };
 
 #endif // IJGP_SAMPLER_H_
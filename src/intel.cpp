@@ -33,7 +33,8 @@
 const double EXP_ROOT = 2.0;
 
 double IntelEqualityConstraint::operator()(Assignment &a) const {
-        bool satisfied = (abs(a[mVar1] - a[mVar2]) == a[mIntervalVar]);
+        bool satisfied = (abs(originalValue(mVar1, a[mVar1]) - originalValue(mVar2, a[mVar2])) ==
+                        originalValue(mIntervalVar, a[mIntervalVar]));
 
         if (mWeight == 0) {
                 return satisfied ? 1.0 : EPSILON; // Let's give a smallish chance to unfeasible solutions
@@ -43,7 +44,7 @@ double IntelEqualityConstraint::operator()(Assignment &a) const {
 }
 
 double IntelInequalityConstraint::operator()(Assignment &a) const {
-        bool satisfied = (a[mVar1] != a[mVar2]);
+        bool satisfied = (originalValue(mVar1, a[mVar1]) != originalValue(mVar2, a[mVar2]));
 
         if (mWeight == 0) {
                 return satisfied ? 1.0 : EPSILON; // Let's give a smallish chance to unfeasible solutions
@@ -53,7 +54,8 @@ double IntelInequalityConstraint::operator()(Assignment &a) const {
 }
 
 double IntelIntervalsNotEqualConstraint::operator()(Assignment &a) const {
-        bool satisfied = (abs(a[mVar1] - a[mVar2]) != abs(a[mVar3] - a[mVar4]));
+        bool satisfied = (abs(originalValue(mVar1, a[mVar1]) - originalValue(mVar2, a[mVar2])) !=
+                        abs(originalValue(mVar3, a[mVar3]) - originalValue(mVar4, a[mVar4])));
 
         if (mWeight == 0) {
                 return satisfied ? 1.0 : EPSILON; // Let's give a smallish chance to unfeasible solutions
@@ -72,18 +74,176 @@ double IntelEqualToConstantConstraint::operator()(Assignment &a) const {
         }
 }
 
+void IntelEqualityConstraint::addToStore(ConstraintStore & aStore) const {
+        assert(mMapping);
+        aStore.getBlock<IntelEqualityBlock>()->addConstraint(mVar1, mVar2, mIntervalVar, mWeight, *mMapping);
+}
+
+void IntelInequalityConstraint::addToStore(ConstraintStore & aStore) const {
+        assert(mMapping);
+        aStore.getBlock<IntelInequalityBlock>()->addConstraint(mVar1, mVar2, mWeight, *mMapping);
+}
+
+void IntelIntervalsNotEqualConstraint::addToStore(ConstraintStore & aStore) const {
+        assert(mMapping);
+        aStore.getBlock<IntelIntervalsNotEqualBlock>()->addConstraint(mVar1, mVar2, mVar3, mVar4, mWeight, *mMapping);
+}
+
+void IntelEqualToConstantConstraint::addToStore(ConstraintStore & aStore) const {
+        aStore.getBlock<IntelEqualToConstantBlock>()->addConstraint(mVar, mTargetValue, mWeight);
+}
+
+void IntelConstraintBlock::addWeight(unsigned int aWeight) {
+        // The same values as computed by operator() of the constraints
+        if (aWeight == 0) {
+                mSatisfiedWeight.push_back(1.0);
+                mViolatedWeight.push_back(EPSILON);
+        } else {
+                mSatisfiedWeight.push_back(exp(log(EXP_ROOT) * 5));
+                mViolatedWeight.push_back(1.0);
+        }
+
+        mLogSatisfiedWeight.push_back(log(mSatisfiedWeight.back()));
+        mLogViolatedWeight.push_back(log(mViolatedWeight.back()));
+}
+
+void IntelEqualityBlock::addConstraint(VarIdType aVar1, VarIdType aVar2, VarIdType aIntervalVar, unsigned int aWeight,
+                const ProblemMapping & aMapping) {
+        mVar1.push_back(aVar1);
+        mVar2.push_back(aVar2);
+        mIntervalVar.push_back(aIntervalVar);
+        mValues1.push_back(&aMapping.getOriginalValues(aVar1)[0]);
+        mValues2.push_back(&aMapping.getOriginalValues(aVar2)[0]);
+        mIntervalValues.push_back(&aMapping.getOriginalValues(aIntervalVar)[0]);
+        addWeight(aWeight);
+}
+
+double IntelEqualityBlock::evalAssignment(const VarType * aValues) const {
+        double result = 1.0;
+        for (size_t i = 0; i < mVar1.size(); ++i) {
+                bool satisfied = (abs(mValues1[i][aValues[mVar1[i]]] - mValues2[i][aValues[mVar2[i]]]) ==
+                                mIntervalValues[i][aValues[mIntervalVar[i]]]);
+                result *= satisfied ? mSatisfiedWeight[i] : mViolatedWeight[i];
+        }
+
+        return result;
+}
+
+double IntelEqualityBlock::evalLogAssignment(const VarType * aValues) const {
+        double result = 0.0;
+        for (size_t i = 0; i < mVar1.size(); ++i) {
+                bool satisfied = (abs(mValues1[i][aValues[mVar1[i]]] - mValues2[i][aValues[mVar2[i]]]) ==
+                                mIntervalValues[i][aValues[mIntervalVar[i]]]);
+                result += satisfied ? mLogSatisfiedWeight[i] : mLogViolatedWeight[i];
+        }
+
+        return result;
+}
+
+void IntelInequalityBlock::addConstraint(VarIdType aVar1, VarIdType aVar2, unsigned int aWeight, const ProblemMapping & aMapping) {
+        mVar1.push_back(aVar1);
+        mVar2.push_back(aVar2);
+        mValues1.push_back(&aMapping.getOriginalValues(aVar1)[0]);
+        mValues2.push_back(&aMapping.getOriginalValues(aVar2)[0]);
+        addWeight(aWeight);
+}
+
+double IntelInequalityBlock::evalAssignment(const VarType * aValues) const {
+        double result = 1.0;
+        for (size_t i = 0; i < mVar1.size(); ++i) {
+                bool satisfied = (mValues1[i][aValues[mVar1[i]]] != mValues2[i][aValues[mVar2[i]]]);
+                result *= satisfied ? mSatisfiedWeight[i] : mViolatedWeight[i];
+        }
+
+        return result;
+}
+
+double IntelInequalityBlock::evalLogAssignment(const VarType * aValues) const {
+        double result = 0.0;
+        for (size_t i = 0; i < mVar1.size(); ++i) {
+                bool satisfied = (mValues1[i][aValues[mVar1[i]]] != mValues2[i][aValues[mVar2[i]]]);
+                result += satisfied ? mLogSatisfiedWeight[i] : mLogViolatedWeight[i];
+        }
+
+        return result;
+}
+
+void IntelIntervalsNotEqualBlock::addConstraint(VarIdType aVar1, VarIdType aVar2, VarIdType aVar3, VarIdType aVar4,
+                unsigned int aWeight, const ProblemMapping & aMapping) {
+        mVar1.push_back(aVar1);
+        mVar2.push_back(aVar2);
+        mVar3.push_back(aVar3);
+        mVar4.push_back(aVar4);
+        mValues1.push_back(&aMapping.getOriginalValues(aVar1)[0]);
+        mValues2.push_back(&aMapping.getOriginalValues(aVar2)[0]);
+        mValues3.push_back(&aMapping.getOriginalValues(aVar3)[0]);
+        mValues4.push_back(&aMapping.getOriginalValues(aVar4)[0]);
+        addWeight(aWeight);
+}
+
+double IntelIntervalsNotEqualBlock::evalAssignment(const VarType * aValues) const {
+        double result = 1.0;
+        for (size_t i = 0; i < mVar1.size(); ++i) {
+                bool satisfied = (abs(mValues1[i][aValues[mVar1[i]]] - mValues2[i][aValues[mVar2[i]]]) !=
+                                abs(mValues3[i][aValues[mVar3[i]]] - mValues4[i][aValues[mVar4[i]]]));
+                result *= satisfied ? mSatisfiedWeight[i] : mViolatedWeight[i];
+        }
+
+        return result;
+}
+
+double IntelIntervalsNotEqualBlock::evalLogAssignment(const VarType * aValues) const {
+        double result = 0.0;
+        for (size_t i = 0; i < mVar1.size(); ++i) {
+                bool satisfied = (abs(mValues1[i][aValues[mVar1[i]]] - mValues2[i][aValues[mVar2[i]]]) !=
+                                abs(mValues3[i][aValues[mVar3[i]]] - mValues4[i][aValues[mVar4[i]]]));
+                result += satisfied ? mLogSatisfiedWeight[i] : mLogViolatedWeight[i];
+        }
+
+        return result;
+}
+
+void IntelEqualToConstantBlock::addConstraint(VarIdType aVar, VarType aTargetValue, unsigned int aWeight) {
+        mVar.push_back(aVar);
+        mTargetValue.push_back(aTargetValue);
+        addWeight(aWeight);
+}
+
+double IntelEqualToConstantBlock::evalAssignment(const VarType * aValues) const {
+        double result = 1.0;
+        for (size_t i = 0; i < mVar.size(); ++i) {
+                result *= (aValues[mVar[i]] == mTargetValue[i]) ? mSatisfiedWeight[i] : mViolatedWeight[i];
+        }
+
+        return result;
+}
+
+double IntelEqualToConstantBlock::evalLogAssignment(const VarType * aValues) const {
+        double result = 0.0;
+        for (size_t i = 0; i < mVar.size(); ++i) {
+                result += (aValues[mVar[i]] == mTargetValue[i]) ? mLogSatisfiedWeight[i] : mLogViolatedWeight[i];
+        }
+
+        return result;
+}
+
 bool IntelEqualityConstraint::hasSupport(VarIdType aVarId, VarType aValue, const CSPProblem &aProblem, const Assignment &aEvidence) {
         if (isSoft())
                 return true;
 
         if (aVarId == mIntervalVar) {
                 // Check if any two other values can satisfy the constraint
-                const Domain * domain1 = aProblem.getVariableById(mVar1)->getDomain();
-                const Domain * domain2 = aProblem.getVariableById(mVar2)->getDomain();
+                const DomainView * domain1 = aProblem.getVariableById(mVar1)->getDomain();
+                const DomainView * domain2 = aProblem.getVariableById(mVar2)->getDomain();
+                VarType interval = originalValue(mIntervalVar, aValue);
 
-                for (Domain::const_iterator domIt1 = domain1->begin(); domIt1 != domain1->end(); ++domIt1) {
-                        if (domain2->find(*domIt1 + aValue) != domain2->end() ||
-                                        domain2->find(*domIt1 - aValue) != domain2->end()) {
+                for (DomainView::const_iterator domIt1 = domain1->begin(); domIt1 != domain1->end(); ++domIt1) {
+                        VarType value1 = originalValue(mVar1, *domIt1);
+                        VarType upperIndex = mMapping->findValueIndex(mVar2, value1 + interval);
+                        VarType lowerIndex = mMapping->findValueIndex(mVar2, value1 - interval);
+
+                        if ((upperIndex >= 0 && domain2->find(upperIndex) != domain2->end()) ||
+                                        (lowerIndex >= 0 && domain2->find(lowerIndex) != domain2->end())) {
 
                                 return true; // Support indeed exists
                         }
@@ -91,12 +251,16 @@ bool IntelEqualityConstraint::hasSupport(VarIdType aVarId, VarType aValue, const
                 return false;
         } else {
                 VarIdType otherVarId = (aVarId == mVar1 ? mVar2 : mVar1);
-                const Domain * otherVarDomain = aProblem.getVariableById(otherVarId)->getDomain();
+                const DomainView * otherVarDomain = aProblem.getVariableById(otherVarId)->getDomain();
+
+                const DomainView * intervalVarDomain = aProblem.getVariableById(mIntervalVar)->getDomain();
+                VarType value = originalValue(aVarId, aValue);
 
-                const Domain * intervalVarDomain = aProblem.getVariableById(mIntervalVar)->getDomain();
+                for (DomainView::const_iterator otherDomIt = otherVarDomain->begin(); otherDomIt != otherVarDomain->end(); ++otherDomIt) {
+                        VarType intervalIndex = mMapping->findValueIndex(mIntervalVar,
+                                        abs(value - originalValue(otherVarId, *otherDomIt)));
 
-                for (Domain::const_iterator otherDomIt = otherVarDomain->begin(); otherDomIt != otherVarDomain->end(); ++otherDomIt) {
-                        if (intervalVarDomain->find(abs(aValue - *otherDomIt)) != intervalVarDomain->end()) {
+                        if (intervalIndex >= 0 && intervalVarDomain->find(intervalIndex) != intervalVarDomain->end()) {
                                 return true;
                         }
                 }
@@ -104,27 +268,58 @@ bool IntelEqualityConstraint::hasSupport(VarIdType aVarId, VarType aValue, const
         }
 }
 
+void IntelEqualityConstraint::remap(const ProblemMapping & aMapping) {
+        mVar1 = aMapping.getIndex(mVar1);
+        mVar2 = aMapping.getIndex(mVar2);
+        mIntervalVar = aMapping.getIndex(mIntervalVar);
+
+        Constraint::remap(aMapping);
+}
+
 bool IntelInequalityConstraint::hasSupport(VarIdType aVarId, VarType aValue, const CSPProblem &aProblem, const Assignment &aEvidence) {
         if (isSoft())
                 return true;
 
         VarIdType otherVarId = (aVarId == mVar1 ? mVar2 : mVar1);
 
-        const Domain * otherVarDomain = aProblem.getVariableById(otherVarId)->getDomain();
+        const DomainView * otherVarDomain = aProblem.getVariableById(otherVarId)->getDomain();
         if (otherVarDomain->size() > 1) {
                 return true;
-        } else if (otherVarDomain->size() == 1 && otherVarDomain->find(aValue) == otherVarDomain->end()) {
+        } else if (otherVarDomain->size() == 1 &&
+                        originalValue(otherVarId, *otherVarDomain->begin()) != originalValue(aVarId, aValue)) {
                 return true;
         } else {
                 return false; // Domain empty or containing only aValue
         }
 }
 
+bool IntelInequalityConstraint::isCompatible(VarIdType aVarId, VarType aValue, VarType aOtherValue) const {
+        VarIdType otherVarId = (aVarId == mVar1 ? mVar2 : mVar1);
+
+        return originalValue(aVarId, aValue) != originalValue(otherVarId, aOtherValue);
+}
+
+void IntelInequalityConstraint::remap(const ProblemMapping & aMapping) {
+        mVar1 = aMapping.getIndex(mVar1);
+        mVar2 = aMapping.getIndex(mVar2);
+
+        Constraint::remap(aMapping);
+}
+
 bool IntelIntervalsNotEqualConstraint::hasSupport(VarIdType aVarId, VarType aValue, const CSPProblem &aProblem, const Assignment &aEvidence) {
         // These constraints are only soft
         return true;
 }
 
+void IntelIntervalsNotEqualConstraint::remap(const ProblemMapping & aMapping) {
+        mVar1 = aMapping.getIndex(mVar1);
+        mVar2 = aMapping.getIndex(mVar2);
+        mVar3 = aMapping.getIndex(mVar3);
+        mVar4 = aMapping.getIndex(mVar4);
+
+        Constraint::remap(aMapping);
+}
+
 bool IntelEqualToConstantConstraint::hasSupport(VarIdType aVarId, VarType aValue, const CSPProblem &aProblem, const Assignment &aEvidence) {
         if (isSoft())
                 return true;
@@ -132,6 +327,13 @@ bool IntelEqualToConstantConstraint::hasSupport(VarIdType aVarId, VarType aValue
         return (aValue == mTargetValue);
 }
 
+void IntelEqualToConstantConstraint::remap(const ProblemMapping & aMapping) {
+        mVar = aMapping.getIndex(mVar);
+        mTargetValue = aMapping.findValueIndex(mVar, mTargetValue);
+
+        Constraint::remap(aMapping);
+}
+
 Constraint * intel_load_equal_to_constant_constraint(const std::vector<std::string> & aWords) {
         return new IntelEqualToConstantConstraint(parseArg<VarIdType>(aWords[1]),
                         parseArg<VarType>(aWords[2]), parseArg<unsigned int>(aWords[3]));
@@ -194,14 +396,17 @@ ConstraintList * intel_load_interval_inequality_constraints(const char * fileNam
 
 
 void intel_load_variables(const char * fileName, const std::vector<Domain> * domains,
-                VariableMap * variables, ConstraintList * constraints) {
+                VariableArray * variables, ConstraintList * constraints, ProblemMapping * mapping) {
         assert(domains);
         assert(variables);
         assert(constraints);
+        assert(mapping);
 
         std::ifstream file(fileName);
         std::string line;
 
+        std::map<VarIdType, unsigned int> domainIds;
+
         while (std::getline(file, line)) {
                 std::vector<std::string> words;
                 tokenize(line, words);
@@ -215,9 +420,19 @@ void intel_load_variables(const char * fileName, const std::vector<Domain> * dom
                 if (domainId >= domains->size())
                         continue; // TODO: throw an exception
 
-                Domain *d = new Domain((*domains)[domainId]);
-                (*variables)[varId] = new Variable(varId, d);
+                domainIds[varId] = domainId;
         }
+
+        for (std::map<VarIdType, unsigned int>::const_iterator domIt = domainIds.begin();
+                        domIt != domainIds.end(); ++domIt) {
+                const Domain & d = (*domains)[domIt->second];
+                VarIdType index = mapping->addVariable(domIt->first, d);
+
+                VarIdType varId = variables->addVariable(d.size());
+                assert(varId == index);
+        }
+
+        remap_constraints(constraints, *mapping);
 }
 
 std::vector<Domain> * intel_load_domains(const char * fileName) {
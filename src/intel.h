@@ -44,6 +44,10 @@ public:
         };
 
         virtual bool hasSupport(VarIdType aVarId, VarType aValue, const CSPProblem &aProblem, const Assignment &aEvidence);
+
+        virtual void remap(const ProblemMapping & aMapping);
+
+        virtual void addToStore(ConstraintStore & aStore) const;
 private:
         VarIdType mVar1, mVar2, mIntervalVar;
         unsigned int mWeight;
@@ -68,6 +72,23 @@ public:
         };
 
         virtual bool hasSupport(VarIdType aVarId, VarType aValue, const CSPProblem &aProblem, const Assignment &aEvidence);
+
+        virtual bool isHardBinary() const {
+                return !isSoft();
+        };
+
+        virtual bool isCompatible(VarIdType aVarId, VarType aValue, VarType aOtherValue) const;
+
+        /**
+         * A value can only lose its support when the other variable is left with one value
+         */
+        virtual unsigned int getPropagationEvents() const {
+                return isSoft() ? 0 : DOMAIN_EVENT_ASSIGNED;
+        };
+
+        virtual void remap(const ProblemMapping & aMapping);
+
+        virtual void addToStore(ConstraintStore & aStore) const;
 private:
         VarIdType mVar1, mVar2;
         unsigned int mWeight;
@@ -94,6 +115,17 @@ public:
         };
 
         virtual bool hasSupport(VarIdType aVarId, VarType aValue, const CSPProblem &aProblem, const Assignment &aEvidence);
+
+        /**
+         * These constraints are only soft, they never remove any value
+         */
+        virtual unsigned int getPropagationEvents() const {
+                return 0;
+        };
+
+        virtual void remap(const ProblemMapping & aMapping);
+
+        virtual void addToStore(ConstraintStore & aStore) const;
 private:
         VarIdType mVar1, mVar2, mVar3, mVar4;
         unsigned int mWeight;
@@ -117,12 +149,108 @@ public:
         };
 
         virtual bool hasSupport(VarIdType aVarId, VarType aValue, const CSPProblem &aProblem, const Assignment &aEvidence);
+
+        /**
+         * The supports do not depend on the domains, one revision is enough
+         */
+        virtual unsigned int getPropagationEvents() const {
+                return 0;
+        };
+
+        virtual void remap(const ProblemMapping & aMapping);
+
+        virtual void addToStore(ConstraintStore & aStore) const;
 private:
         VarIdType mVar;
         VarType mTargetValue;
         unsigned int mWeight;
 };
 
+/**
+ * Common part of the blocks of Intel constraints: values of the rows when
+ * satisfied and when violated
+ */
+class IntelConstraintBlock: public ConstraintBlock {
+public:
+        virtual size_t size() const {
+                return mSatisfiedWeight.size();
+        };
+protected:
+        void addWeight(unsigned int aWeight);
+
+        std::vector<double> mSatisfiedWeight, mViolatedWeight;
+        std::vector<double> mLogSatisfiedWeight, mLogViolatedWeight;
+};
+
+/**
+ * All the IntelEqualityConstraints of a problem
+ */
+class IntelEqualityBlock: public IntelConstraintBlock {
+public:
+        enum { KIND = CONSTRAINT_KIND_INTEL_EQUALITY };
+
+        void addConstraint(VarIdType aVar1, VarIdType aVar2, VarIdType aIntervalVar, unsigned int aWeight,
+                        const ProblemMapping & aMapping);
+
+        virtual double evalAssignment(const VarType * aValues) const;
+
+        virtual double evalLogAssignment(const VarType * aValues) const;
+private:
+        std::vector<VarIdType> mVar1, mVar2, mIntervalVar;
+        std::vector<const VarType *> mValues1, mValues2, mIntervalValues;
+};
+
+/**
+ * All the IntelInequalityConstraints of a problem
+ */
+class IntelInequalityBlock: public IntelConstraintBlock {
+public:
+        enum { KIND = CONSTRAINT_KIND_INTEL_INEQUALITY };
+
+        void addConstraint(VarIdType aVar1, VarIdType aVar2, unsigned int aWeight, const ProblemMapping & aMapping);
+
+        virtual double evalAssignment(const VarType * aValues) const;
+
+        virtual double evalLogAssignment(const VarType * aValues) const;
+private:
+        std::vector<VarIdType> mVar1, mVar2;
+        std::vector<const VarType *> mValues1, mValues2;
+};
+
+/**
+ * All the IntelIntervalsNotEqualConstraints of a problem
+ */
+class IntelIntervalsNotEqualBlock: public IntelConstraintBlock {
+public:
+        enum { KIND = CONSTRAINT_KIND_INTEL_INTERVALS_NOT_EQUAL };
+
+        void addConstraint(VarIdType aVar1, VarIdType aVar2, VarIdType aVar3, VarIdType aVar4, unsigned int aWeight,
+                        const ProblemMapping & aMapping);
+
+        virtual double evalAssignment(const VarType * aValues) const;
+
+        virtual double evalLogAssignment(const VarType * aValues) const;
+private:
+        std::vector<VarIdType> mVar1, mVar2, mVar3, mVar4;
+        std::vector<const VarType *> mValues1, mValues2, mValues3, mValues4;
+};
+
+/**
+ * All the IntelEqualToConstantConstraints of a problem
+ */
+class IntelEqualToConstantBlock: public IntelConstraintBlock {
+public:
+        enum { KIND = CONSTRAINT_KIND_INTEL_EQUAL_TO_CONSTANT };
+
+        void addConstraint(VarIdType aVar, VarType aTargetValue, unsigned int aWeight);
+
+        virtual double evalAssignment(const VarType * aValues) const;
+
+        virtual double evalLogAssignment(const VarType * aValues) const;
+private:
+        std::vector<VarIdType> mVar;
+        std::vector<VarType> mTargetValue;
+};
 
 /**
  * Functions to load Intel data from files
@@ -133,10 +261,11 @@ ConstraintList * intel_load_constraints(const char * fileName);
 ConstraintList * intel_load_interval_inequality_constraints(const char * fileName);
 
 /**
- * Loads variables and adds possible additional modification constraints
+ * Loads variables, numbers them densely and remaps the constraints
+ * to the dense variable and value indices (see celar_load_variables)
  */
 void intel_load_variables(const char * fileName, const std::vector<Domain> * domains,
-                VariableMap * variables, ConstraintList * constraints);
+                VariableArray * variables, ConstraintList * constraints, ProblemMapping * mapping);
 
 /**
  * Loads domains from the specified file
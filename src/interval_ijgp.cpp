@@ -38,7 +38,8 @@
 
 IntervalJoinGraph::IntervalJoinGraph(const IntervalJoinGraph & aGraph):
         mOrdering(aGraph.mOrdering),
-        mMaxDomainIntervals(aGraph.mMaxDomainIntervals), mMaxValuesFromInterval(aGraph.mMaxValuesFromInterval) {
+        mMaxDomainIntervals(aGraph.mMaxDomainIntervals), mMaxValuesFromInterval(aGraph.mMaxValuesFromInterval),
+        mQuiet(aGraph.mQuiet) {
 
         // Create nodes
         for (std::map<Scope, IntervalJoinGraphNode *>::const_iterator nodesIt = aGraph.mNodes.begin();
@@ -148,16 +149,12 @@ IntervalJoinGraph * IntervalJoinGraph::createJoinGraph(CSPProblem * aProblem, un
 
                         // Append all constraints from the CSPProblem which match the current node's
                         // scope to that node
-                        for (ConstraintList::const_iterator ctrIt = aProblem->getConstraints()->begin();
-                                        ctrIt != aProblem->getConstraints()->end();
-                                        ++ctrIt) {
+                        std::vector<size_t> nodeConstraints;
+                        aProblem->getConstraintsWithinScope(*mbIt, nodeConstraints);
 
-                                Scope ctrScope = (*ctrIt)->getScope();
-                                Scope nodeScope = node->getScope();
-
-                                if (std::includes(nodeScope.begin(), nodeScope.end(), ctrScope.begin(), ctrScope.end())) {
-                                        node->addConstraint(*ctrIt);
-                                }
+                        for (std::vector<size_t>::const_iterator ctrIt = nodeConstraints.begin();
+                                        ctrIt != nodeConstraints.end(); ++ctrIt) {
+                                node->addConstraint(aProblem->getConstraint(*ctrIt));
                         }
 
                         node->initDomainIntervals(aProblem);
@@ -230,7 +227,7 @@ void IntervalJoinGraphNode::initDomainIntervals(CSPProblem * aProblem) {
         // according to a domain
         if (mConstraints.empty()) { 
                 for (Scope::iterator scopeIt = mScope.begin(); scopeIt != mScope.end(); ++scopeIt) {
-                        const Domain * domain = aProblem->getVariableById(*scopeIt)->getDomain();
+                        const DomainView * domain = aProblem->getVariableById(*scopeIt)->getDomain();
                         mConstraintDomainIntervals[*scopeIt] = uniform_intervals_for_domain(*domain, mMaxDomainIntervals);
                         // std::cout << "Uniform interval for " << *scopeIt << " " << interval_list_pprint(mConstraintDomainIntervals[*scopeIt]) << std::endl;
                 }
@@ -262,7 +259,7 @@ void IntervalJoinGraphNode::initDomainIntervals(CSPProblem * aProblem) {
         for (std::map<VarIdType, DomainIntervalMap>::iterator domIt = mConstraintDomainIntervals.begin();
                         domIt != mConstraintDomainIntervals.end(); ++domIt) {
 
-                const Domain * domain = aProblem->getVariableById(domIt->first)->getDomain();
+                const DomainView * domain = aProblem->getVariableById(domIt->first)->getDomain();
                 domIt->second = adjust_intervals_to_domain(
                                         join_intervals(normalize_intervals(domIt->second), mMaxDomainIntervals),
                                         *domain);
@@ -277,7 +274,7 @@ void IntervalJoinGraphNode::adjustIntervalsToDomains(const CSPProblem * aProblem
         for (std::map<VarIdType, DomainIntervalMap>::iterator domIt = mDomainIntervals.begin();
                         domIt != mDomainIntervals.end(); ++domIt) {
 
-                const Domain * domain = aProblem->getVariableById(domIt->first)->getDomain();
+                const DomainView * domain = aProblem->getVariableById(domIt->first)->getDomain();
                 domIt->second = join_intervals(normalize_intervals(adjust_intervals_to_domain(domIt->second, *domain)),
                                 mMaxDomainIntervals);
                         //std::cout << "Domain interval after " << domIt->first << ": " << interval_list_pprint(mDomainIntervals[domIt->first]) << std::endl;
@@ -366,7 +363,7 @@ IntervalJoinGraphMessage * IntervalJoinGraphNode::getMessage(const CSPProblem *
         for (std::map<VarIdType, DomainIntervalMap>::iterator domIt = mDomainIntervals.begin();
                         domIt != mDomainIntervals.end(); ++domIt) {
 
-                const Domain * domain = aProblem->getVariableById(domIt->first)->getDomain();
+                const DomainView * domain = aProblem->getVariableById(domIt->first)->getDomain();
                 domIt->second = join_intervals(normalize_intervals(adjust_intervals_to_domain(domIt->second, *domain)),
                                 mMaxDomainIntervals);
                         //std::cout << "Domain interval after " << domIt->first << ": " << interval_list_pprint(mDomainIntervals[domIt->first]);
@@ -454,7 +451,7 @@ IntervalProbabilityDistribution IntervalJoinGraphNode::conditionalDistribution(C
         std::set_difference(mScope.begin(), mScope.end(), evidenceScope.begin(), evidenceScope.end(),
                         std::inserter(marginalizedScope, marginalizedScope.begin()));
 
-        const Domain * domain = aTargetVariable->getDomain();
+        const DomainView * domain = aTargetVariable->getDomain();
         const DomainIntervalMap & intervalSet = mDomainIntervals[targetVarId];
 
         Assignment::iterator targetVarIt = partialEvidence.find(targetVarId);
@@ -507,7 +504,7 @@ void IntervalJoinGraphNode::_computeMessage(IntervalJoinGraphMessage * aMessage,
                 aMessageScope.erase(aMessageScope.begin());
 
                 const DomainIntervalMap & intervalSet = mDomainIntervals[assignedVariable];
-                const Domain * domain = aProblem->getVariableById(assignedVariable)->getDomain();
+                const DomainView * domain = aProblem->getVariableById(assignedVariable)->getDomain();
 
                 for (DomainIntervalMap::const_iterator intervalIt = intervalSet.begin(); intervalIt != intervalSet.end(); ++intervalIt) {
                         // Assign a given number of values from the selected intervals to the variable
@@ -546,7 +543,7 @@ double IntervalJoinGraphNode::_marginalizeOut(const CSPProblem * aProblem, Scope
                 aMarginalizedScope.erase(aMarginalizedScope.begin());
 
                 const DomainIntervalMap & intervalSet = mDomainIntervals[marginalizedVariable];
-                const Domain * domain = aProblem->getVariableById(marginalizedVariable)->getDomain();
+                const DomainView * domain = aProblem->getVariableById(marginalizedVariable)->getDomain();
 
                 for (DomainIntervalMap::const_iterator intervalIt = intervalSet.begin(); intervalIt != intervalSet.end(); ++intervalIt) {
                         // Assign a given number of values from the selected intervals to the variable
@@ -767,11 +764,13 @@ void IntervalJoinGraph::iterativePropagation(CSPProblem * aProblem, Assignment &
 
 
         unsigned int numIterations = 0;
-        std::cout << "IJGP " << std::endl;
+        if (!mQuiet)
+                std::cout << "IJGP " << std::endl;
 
         while (numIterations < aMaxIterations) {
 
-                std::cout << "IJGP iteration " << numIterations << std::endl;
+                if (!mQuiet)
+                        std::cout << "IJGP iteration " << numIterations << std::endl;
                 /*std::cout << ".";
                 std::cout.flush();*/
 
@@ -826,9 +825,11 @@ void IntervalJoinGraph::iterativePropagation(CSPProblem * aProblem, Assignment &
                 ++numIterations;
         }
 
-        std::cout << " ";
-        std::cout << assignment_pprint(aEvidence);
-        std::cout << std::endl;
+        if (!mQuiet) {
+                std::cout << " ";
+                std::cout << assignment_pprint(aEvidence);
+                std::cout << std::endl;
+        }
 }
 
 int IntervalJoinGraph::KLDivergence(double & outDivergence) {
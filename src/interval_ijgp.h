@@ -170,7 +170,7 @@ class IntervalJoinGraph {
 public:
         IntervalJoinGraph(unsigned int aMaxDomainIntervals = MAX_DOMAIN_INTERVALS,
                         unsigned int aMaxValuesFromInterval = MAX_VALUES_FROM_INTERVAL):
-                mMaxDomainIntervals(aMaxDomainIntervals), mMaxValuesFromInterval(aMaxValuesFromInterval) {};
+                mMaxDomainIntervals(aMaxDomainIntervals), mMaxValuesFromInterval(aMaxValuesFromInterval), mQuiet(false) {};
 
         // Copy-constructor
         IntervalJoinGraph(const IntervalJoinGraph & aGraph);
@@ -188,6 +188,13 @@ public:
          */
         void purgeMessages();
 
+        /**
+         * A quiet graph (and its copies) does not print the progress of the propagation
+         */
+        void setQuiet(bool aQuiet) {
+                mQuiet = aQuiet;
+        };
+
         /**
          * Initializes domain intervals for all graph nodes
          */
@@ -258,6 +265,8 @@ private:
         std::map<Scope, IntervalJoinGraphNode *> mNodes;
 
         unsigned int mMaxDomainIntervals, mMaxValuesFromInterval;
+
+        bool mQuiet;
 };
 
 class IntervalJoinGraphMessage {
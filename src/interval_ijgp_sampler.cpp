@@ -31,7 +31,8 @@ IntervalIJGPSampler::IntervalIJGPSampler(CSPProblem * aProblem, unsigned int aMa
                 unsigned int aMaxIJGPIterations, unsigned int aMaxDomainIntervals, unsigned int aMaxValuesFromInterval):
         CSPSampler(aProblem), mJoinGraph(0), mMaxBucketSize(aMaxBucketSize), mIJGPProbability(aIJGPProbability),
         mMaxIJGPIterations(aMaxIJGPIterations), mMaxDomainIntervals(aMaxDomainIntervals),
-        mMaxValuesFromInterval(aMaxValuesFromInterval)  {
+        mMaxValuesFromInterval(aMaxValuesFromInterval), mSampleFrames(aProblem->getVariables()->size()),
+        mSelector(aProblem, ORDERING_LEX), mBackjumping(false), mQuiet(false)  {
         
         mOriginalJoinGraph = IntervalJoinGraph::createJoinGraph(aProblem, aMaxBucketSize, aMaxDomainIntervals, aMaxValuesFromInterval);
 
@@ -44,8 +45,39 @@ IntervalIJGPSampler::IntervalIJGPSampler(CSPProblem * aProblem, unsigned int aMa
         mOriginalJoinGraph->iterativePropagation(mProblem, evidence, mMaxIJGPIterations);
 }
 
+IntervalIJGPSampler::IntervalIJGPSampler(const IntervalIJGPSampler & aSampler):
+        CSPSampler(aSampler.mProblem->createWorkingCopy()), mJoinGraph(0),
+        mOriginalJoinGraph(new IntervalJoinGraph(*aSampler.mOriginalJoinGraph)), mMaxBucketSize(aSampler.mMaxBucketSize),
+        mIJGPProbability(aSampler.mIJGPProbability), mMaxIJGPIterations(aSampler.mMaxIJGPIterations),
+        mMaxDomainIntervals(aSampler.mMaxDomainIntervals), mMaxValuesFromInterval(aSampler.mMaxValuesFromInterval),
+        mNoSolutionExists(aSampler.mNoSolutionExists), mSampleFrames(aSampler.mSampleFrames.size()),
+        mSelector(aSampler.mSelector), mBackjumping(aSampler.mBackjumping), mQuiet(aSampler.mQuiet) {
+}
+
 IntervalIJGPSampler::~IntervalIJGPSampler() {
         delete mJoinGraph;
+        delete mOriginalJoinGraph;
+}
+
+CSPSampler * IntervalIJGPSampler::createWorker() const {
+        return new IntervalIJGPSampler(*this);
+}
+
+void IntervalIJGPSampler::setQuiet(bool aQuiet) {
+        mQuiet = aQuiet;
+
+        // The join graphs of the frames are copied from the original one
+        mOriginalJoinGraph->setQuiet(aQuiet);
+}
+
+void IntervalIJGPSampler::setVariableOrdering(VariableOrdering aOrdering) {
+        mSelector = VariableSelector(mProblem, aOrdering);
+}
+
+void IntervalIJGPSampler::setBackjumping(bool aBackjumping) {
+        mBackjumping = aBackjumping;
+        if (mBackjumping)
+                mProblem->trackConflicts();
 }
 
 bool IntervalIJGPSampler::getSample(Assignment & aAssignment) {
@@ -59,83 +91,147 @@ bool IntervalIJGPSampler::getSample(Assignment & aAssignment) {
         //mJoinGraph->restoreDomainIntervals();
         aAssignment = Assignment();
 
-        return _getSampleInternal(mOriginalJoinGraph, aAssignment, mProblem->getVariables()->begin());
+        return _getSampleInternal(mOriginalJoinGraph, aAssignment, 0);
 }
 
-bool IntervalIJGPSampler::_getSampleInternal(const IntervalJoinGraph * aJG, Assignment & aEvidence, VariableMap::const_iterator aVarIterator,
+bool IntervalIJGPSampler::_getSampleInternal(const IntervalJoinGraph * aJG, Assignment & aEvidence, VarIdType aVarIndex,
                 VarIdType aLastChangedVariable) {
 
-        if (aVarIterator == mProblem->getVariables()->end()) {
-                return true; // We have reached the last variable
-        } else {
-                IntervalJoinGraph * jg = NULL;
-                std::map<VarIdType, Domain> removedValues;
-                bool domainsNotEmpty = !mNoSolutionExists;
+        const VarIdType numVariables = mProblem->getVariables()->size();
+        VarIdType varIndex = aVarIndex;
+        VarIdType lastChangedVariable = aLastChangedVariable;
+        bool sampleFound = false;
 
-                if (!aEvidence.empty()) {
-                        domainsNotEmpty = mProblem->propagateConstraints(aEvidence, removedValues, aLastChangedVariable);
-                }
+        while (true) {
+                bool descend = false;
 
-                if (domainsNotEmpty) {
-                        jg = new IntervalJoinGraph(*aJG);
-                        // Adjust domain intervals to new domains
-                        jg->adjustIntervalsToDomains(mProblem);
+                // With backjumping the depths which caused the failure
+                ConflictSet * conflict = 0;
 
-                        // Select variable, and its value
-                        Variable * targetVar = aVarIterator->second;
+                if (varIndex == numVariables) {
+                        sampleFound = true; // We have reached the last variable
+                } else {
+                        SampleFrame & frame = mSampleFrames[varIndex];
+                        bool domainsNotEmpty = !mNoSolutionExists;
 
-                        if (!aEvidence.empty() && (rand() / (double)RAND_MAX) < mIJGPProbability) {
-                                jg->iterativePropagation(mProblem, aEvidence, mMaxIJGPIterations);
+                        frame.jg = NULL;
+                        frame.removedValues.clear();
+                        frame.dist.clear();
+                        frame.conflictTrail = mProblem->getConflictTrailSize();
+
+                        if (!aEvidence.empty()) {
+                                domainsNotEmpty = mProblem->propagateConstraints(aEvidence, frame.removedValues,
+                                                lastChangedVariable);
                         }
 
-                        IntervalProbabilityDistribution dist = jg->conditionalDistribution(mProblem,
-                                        targetVar, aEvidence);
+                        if (domainsNotEmpty) {
+                                // Every frame changes its own copy of the join graph of the previous one
+                                frame.jg = new IntervalJoinGraph(varIndex == aVarIndex ? *aJG : *mSampleFrames[varIndex - 1].jg);
+                                // Adjust domain intervals to new domains
+                                frame.jg->adjustIntervalsToDomains(mProblem);
 
-                        std::cout << "Dist for " << targetVar->getId() << ": " << interval_probability_distribution_pprint(dist) << std::endl;
+                                // Select variable, and its value
+                                frame.var = mSelector.selectVariable(mProblem, aEvidence, varIndex);
 
-                        std::list<VarType> triedValues;
+                                if (!aEvidence.empty() && (random_int() / (double)RAND_MAX) < mIJGPProbability) {
+                                        frame.jg->iterativePropagation(mProblem, aEvidence, mMaxIJGPIterations);
+                                }
 
-                        while (!dist.empty()) {
-                                VarType value = _sampleFromDistribution(targetVar, dist);
-                                aEvidence[targetVar->getId()] = value;
+                                frame.dist = frame.jg->conditionalDistribution(mProblem, frame.var, aEvidence);
 
-                                Domain targetVarRemovedValues;
+                                if (!mQuiet)
+                                        std::cout << "Dist for " << frame.var->getId() << ": " << interval_probability_distribution_pprint(frame.dist) << std::endl;
 
-                                targetVar->restrictDomainToValue(value, targetVarRemovedValues);
-                                ++aVarIterator;
+                                if (mBackjumping)
+                                        frame.conflict = mProblem->getConflict(frame.var->getId());
+                        } else {
+                                if (!mQuiet)
+                                        std::cout << "No solution found, backtracking from evidence " << assignment_pprint(aEvidence) << std::endl;
 
-                                bool sampleFound = _getSampleInternal(jg, aEvidence, aVarIterator, targetVar->getId());
+                                if (mBackjumping)
+                                        frame.conflict = mProblem->getFailureConflict();
+                        }
 
-                                --aVarIterator;
-                                targetVar->restoreRestrictedDomain(targetVarRemovedValues);
+                        descend = _assignNextValue(frame, varIndex, aEvidence);
+                        if (!descend) {
+                                _leaveFrame(frame);
+                                conflict = &frame.conflict;
+                        }
+                }
 
-                                if (!sampleFound) {
-                                        aEvidence.erase(targetVar->getId());
+                // Return to the previous frames until one of them has a value left to try
+                while (!descend && varIndex > aVarIndex) {
+                        SampleFrame & frame = mSampleFrames[--varIndex];
+                        bool jumping = false;
+
+                        frame.var->restoreRestrictedDomain(frame.restrictedValues);
+                        if (mBackjumping)
+                                mProblem->setAssignmentDepth(frame.var->getId(), -1);
+
+                        if (!sampleFound) {
+                                aEvidence.erase(frame.var->getId());
+
+                                if (mBackjumping) {
+                                        if (conflict->contains(varIndex)) {
+                                                conflict->erase(varIndex);
+                                                frame.conflict.merge(*conflict);
+                                        } else {
+                                                // The value did not cause the failure, neither would the others
+                                                jumping = true;
+                                        }
+                                }
 
-                                        _eraseValueFromDist(targetVar, value, dist);
-                                        std::cout << "No sample found, erasing " << value << " from " << targetVar->getId() << std::endl;
+                                if (!jumping) {
+                                        _eraseValueFromDist(frame.var, frame.value, frame.dist);
+                                        if (!mQuiet)
+                                                std::cout << "No sample found, erasing " << frame.value << " from " << frame.var->getId() << std::endl;
 
-                                        targetVar->eraseFromDomain(value);
-                                        removedValues[targetVar->getId()].insert(value);
+                                        frame.var->eraseFromDomain(frame.value);
+                                        frame.removedValues[frame.var->getId()].insert(frame.value);
 
-                                } else {
-                                        mProblem->restoreDomains(removedValues);
-                                        delete jg;
-                                        return true; // Yep, we have a sample
+                                        descend = _assignNextValue(frame, varIndex, aEvidence);
                                 }
                         }
-                } else {
-                        std::cout << "No solution found, backtracking from evidence " << assignment_pprint(aEvidence) << std::endl;
+
+                        if (!descend) {
+                                _leaveFrame(frame);
+                                if (!jumping)
+                                        conflict = &frame.conflict;
+                        }
                 }
-                
-                // If no try has been succesful, restore the domains and return false
-                mProblem->restoreDomains(removedValues);
 
-                delete jg;
-                return false;
+                if (!descend)
+                        return sampleFound;
+
+                lastChangedVariable = mSampleFrames[varIndex].var->getId();
+                ++varIndex;
         }
 }
 
+bool IntervalIJGPSampler::_assignNextValue(SampleFrame & aFrame, VarIdType aDepth, Assignment & aEvidence) {
+        if (aFrame.dist.empty())
+                return false;
+
+        aFrame.value = _sampleFromDistribution(aFrame.var, aFrame.dist);
+        aEvidence[aFrame.var->getId()] = aFrame.value;
+
+        aFrame.restrictedValues.clear();
+        aFrame.var->restrictDomainToValue(aFrame.value, aFrame.restrictedValues);
+
+        if (mBackjumping)
+                mProblem->setAssignmentDepth(aFrame.var->getId(), aDepth);
+
+        return true;
+}
+
+void IntervalIJGPSampler::_leaveFrame(SampleFrame & aFrame) {
+        mProblem->restoreDomains(aFrame.removedValues);
+        mProblem->restoreConflicts(aFrame.conflictTrail);
+
+        delete aFrame.jg;
+        aFrame.jg = NULL;
+}
+
 VarType IntervalIJGPSampler::_sampleFromDistribution(Variable * aVariable, 
                 const IntervalProbabilityDistribution & aDistribution) {
 
@@ -151,7 +247,7 @@ VarType IntervalIJGPSampler::_sampleFromDistribution(Variable * aVariable,
                 return random_select(aVariable->getDomain());
         }
 
-        double selectedProbability = (rand()*1.0/RAND_MAX) * totalProbability;
+        double selectedProbability = (random_int()*1.0/RAND_MAX) * totalProbability;
         double accumulatedProbability = 0.0;
 
         for (IntervalProbabilityDistribution::const_iterator pIt = aDistribution.begin();
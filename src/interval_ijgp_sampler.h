@@ -22,8 +22,11 @@
 #ifndef INTERVAL_IJGP_SAMPLER_H_
 #define INTERVAL_IJGP_SAMPLER_H_
 
+#include <vector>
+
 #include "csp.h"
 #include "interval_ijgp.h"
+#include "variable_ordering.h"
 
 class IntervalIJGPSampler: public CSPSampler {
 public:
@@ -35,8 +38,60 @@ public:
         
         virtual bool getSample(Assignment & aAssignment);
 
+        /**
+         * The worker starts from a copy of the join graph after the initial propagation
+         */
+        virtual CSPSampler * createWorker() const;
+
+        virtual void setQuiet(bool aQuiet);
+
+        /**
+         * Selects the order in which the variables are assigned (ORDERING_LEX by default)
+         */
+        void setVariableOrdering(VariableOrdering aOrdering);
+
+        /**
+         * Conflict-directed backjumping, see IJGPSampler::setBackjumping
+         */
+        void setBackjumping(bool aBackjumping);
+
 private:
-        bool _getSampleInternal(const IntervalJoinGraph * aJG, Assignment & aEvidence, VariableMap::const_iterator aVarIterator,
+        IntervalIJGPSampler(const IntervalIJGPSampler & aSampler);
+
+        /**
+         * A variable on the search stack of the sample. The frames of all the variables are
+         * allocated with the sampler, so the search of a sample does not recurse and reuses them.
+         */
+        struct SampleFrame {
+                Variable * var;
+                VarType value;
+
+                // Copy of the join graph of the previous frame, adjusted to the domains of this one
+                IntervalJoinGraph * jg;
+
+                // Values removed by the propagation of the previous variable, the failed values
+                // of var, and the values removed by restricting var to value
+                std::map<VarIdType, Domain> removedValues;
+                Domain restrictedValues;
+                IntervalProbabilityDistribution dist;
+
+                // With backjumping: the depths explaining the failures of the variable so far
+                // and the conflict trail at the entry of the frame
+                ConflictSet conflict;
+                size_t conflictTrail;
+        };
+
+        /**
+         * Assigns the next value to try to the variable of the frame, false if there is none
+         */
+        bool _assignNextValue(SampleFrame & aFrame, VarIdType aDepth, Assignment & aEvidence);
+
+        /**
+         * Restores the domains and conflicts of the frame and deletes its join graph
+         */
+        void _leaveFrame(SampleFrame & aFrame);
+
+        bool _getSampleInternal(const IntervalJoinGraph * aJG, Assignment & aEvidence, VarIdType aVarIndex,
                 VarIdType aLastChangedVariable = 0);
         /**
          * Sample from given distribution for a given variable
@@ -61,6 +116,13 @@ private:
          */
         unsigned int mMaxValuesFromInterval;
         bool mNoSolutionExists;
+
+        // The search stack, one frame per variable
+        std::vector<SampleFrame> mSampleFrames;
+
+        VariableSelector mSelector;
+        bool mBackjumping;
+        bool mQuiet;
 };
 
 std::string interval_probability_distribution_pprint(const IntervalProbabilityDistribution & aDist);
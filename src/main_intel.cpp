@@ -21,6 +21,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <limits>
 
 #include "optparse/optparse.h"
 
@@ -30,10 +31,18 @@
 #include "gibbs_sampler.h"
 #include "ijgp_sampler.h"
 #include "interval_ijgp_sampler.h"
+#include "sac.h"
+#include "restart_policy.h"
+#include "variable_ordering.h"
+#include "sample_farm.h"
+#include "weighted_marginals.h"
 #include "utils.h"
 
 
 int main(int argc, char ** argv) {
+        // The time budget includes the loading of the problem
+        double startTime = current_time();
+
         OptionParser parser(argc, argv, "scspsampler [OPTIONS] ARGS");
 
         parser.addOption(/*aShortName*/ 's', /*aLongName*/ "sampler", /*aAlias*/ "sampler",
@@ -63,7 +72,7 @@ int main(int argc, char ** argv) {
 
         parser.addOption(/*aShortName*/ 'n', /*aLongName*/ "numSamples", /*aAlias*/ "numSamples",
                         /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
-                        /*aArg*/ "20", /*aHelpText*/ "Number of samples we should generate");
+                        /*aArg*/ "20", /*aHelpText*/ "Number of samples we should generate, 0 for as many as the deadline allows");
 
         parser.addOption(/*aShortName*/ 0, /*aLongName*/ "domainIntervals", /*aAlias*/ "domainIntervals",
                         /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
@@ -77,6 +86,106 @@ int main(int argc, char ** argv) {
                         /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
                         /*aArg*/ "extra-vars", /*aHelpText*/ "Intel model type -- naive (4-ary constraints) or extra-vars (extra variables, 3-ary constraints");
 
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "sac", /*aAlias*/ "sac",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "none", /*aHelpText*/ "Singleton arc consistency preprocessing; Either \"none\", \"full\" or \"bounds\"");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "sacThreads", /*aAlias*/ "sacThreads",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "1", /*aHelpText*/ "Number of threads for the SAC probes");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "sacCache", /*aAlias*/ "sacCache",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ false,
+                        /*aArg*/ "", /*aHelpText*/ "File with the domains pruned by SAC (read if it matches the dataset, written otherwise)");
+
+        parser.addOption(/*aShortName*/ 't', /*aLongName*/ "threads", /*aAlias*/ "threads",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "1", /*aHelpText*/ "Number of threads generating the samples (for \"ijgp\" and \"interval-ijgp\")");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "searchThreads", /*aAlias*/ "searchThreads",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "1", /*aHelpText*/ "Number of threads searching for each sample (for \"ijgp\")");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "ordering", /*aAlias*/ "ordering",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "lex", /*aHelpText*/ "Variable ordering of \"ijgp\" and \"interval-ijgp\": lex, mrv, domwdeg, elim");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "backjump", /*aAlias*/ "backjump",
+                        /*aHasArg*/ false, /*aSpecifiedByDefault*/ false,
+                        /*aArg*/ "", /*aHelpText*/ "Conflict-directed backjumping in \"ijgp\" and \"interval-ijgp\"");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "ijgpTolerance", /*aAlias*/ "ijgpTolerance",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "0.01", /*aHelpText*/ "KL divergence of the messages of two sweeps at which IJGP stops (for \"ijgp\")");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "ijgpWarmStart", /*aAlias*/ "ijgpWarmStart",
+                        /*aHasArg*/ false, /*aSpecifiedByDefault*/ false,
+                        /*aArg*/ "", /*aHelpText*/ "Start IJGP from the messages of the last run at the same depth (for \"ijgp\")");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "ijgpCache", /*aAlias*/ "ijgpCache",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "1000", /*aHelpText*/ "Number of IJGP runs whose messages are reused for the same evidence with --ijgpWarmStart");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "ijgpLazy", /*aAlias*/ "ijgpLazy",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "0", /*aHelpText*/ "Depth of the messages IJGP computes for the next variable in \"ijgp\", 0 for all of them");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "distCache", /*aAlias*/ "distCache",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "0", /*aHelpText*/ "Number of conditional distributions cached by \"ijgp\", 0 for no cache");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "ijgpAdaptive", /*aAlias*/ "ijgpAdaptive",
+                        /*aHasArg*/ false, /*aSpecifiedByDefault*/ false,
+                        /*aArg*/ "", /*aHelpText*/ "Run IJGP when its expected benefit exceeds its cost instead of with --ijgpProbability (for \"ijgp\")");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "ijgpGainRate", /*aAlias*/ "ijgpGainRate",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "1", /*aHelpText*/ "Change of the distributions per second of IJGP worth a run with --ijgpAdaptive");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "nogoods", /*aAlias*/ "nogoods",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "0", /*aHelpText*/ "Maximal number of nogoods learned by \"ijgp\", 0 for no learning");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "nogoodSize", /*aAlias*/ "nogoodSize",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "20", /*aHelpText*/ "Maximal number of assignments in a learned nogood");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "nogoodCache", /*aAlias*/ "nogoodCache",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ false,
+                        /*aArg*/ "", /*aHelpText*/ "File with the nogoods of the problem, loaded before sampling and saved after it");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "restarts", /*aAlias*/ "restarts",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "none", /*aHelpText*/ "Restarts of the search of a sample in \"ijgp\": none, luby, geometric");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "restartBase", /*aAlias*/ "restartBase",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "100", /*aHelpText*/ "Backtracks before the first restart");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "restartFactor", /*aAlias*/ "restartFactor",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "1.5", /*aHelpText*/ "Growth of the backtrack limit of the geometric restarts");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "sampleTimeout", /*aAlias*/ "sampleTimeout",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "0", /*aHelpText*/ "Seconds after which the search of a sample in \"ijgp\" is abandoned, 0 for no limit");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "timeBudget", /*aAlias*/ "timeBudget",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "0", /*aHelpText*/ "Seconds from the start after which the sampling stops, 0 for no limit");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "deadline", /*aAlias*/ "deadline",
+                        /*aHasArg*/ true, /*aSpecifiedByDefault*/ true,
+                        /*aArg*/ "0", /*aHelpText*/ "Time (in seconds since the epoch) at which the sampling stops, 0 for none");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "weighted", /*aAlias*/ "weighted",
+                        /*aHasArg*/ false, /*aSpecifiedByDefault*/ false,
+                        /*aArg*/ "", /*aHelpText*/ "Print the log importance weight of every sample and the weighted marginals (for \"ijgp\")");
+
+        parser.addOption(/*aShortName*/ 0, /*aLongName*/ "unordered", /*aAlias*/ "unordered",
+                        /*aHasArg*/ false, /*aSpecifiedByDefault*/ false,
+                        /*aArg*/ "", /*aHelpText*/ "Print the samples of several threads as they are finished, not in order");
+
         try {
                 parser.parseOptions();
         } catch (const OptionNotRecognized & e) {
@@ -90,6 +199,15 @@ int main(int argc, char ** argv) {
                 return EXIT_SUCCESS;
         }
 
+        // The sampling stops at the earlier of the deadlines, 0 for none
+        double deadline = 0;
+        double timeBudget = parseArg<double>(parser.getOptionArg("timeBudget"));
+        double absoluteDeadline = parseArg<double>(parser.getOptionArg("deadline"));
+        if (timeBudget > 0)
+                deadline = startTime + timeBudget;
+        if (absoluteDeadline > 0 && (deadline == 0 || absoluteDeadline < deadline))
+                deadline = absoluteDeadline;
+
         // Load info about CSP problem
         std::string dataDir = parser.getOptionArg("dataset");
         std::string modelType = parser.getOptionArg("intelModelType");
@@ -101,31 +219,118 @@ int main(int argc, char ** argv) {
         }
 
         std::vector<Domain> * d = intel_load_domains((dataDir + "/dom.txt").c_str());
-        VariableMap * v = new VariableMap();
-        intel_load_variables((dataDir + "/var.txt").c_str(), d, v, c);
+        VariableArray * v = new VariableArray();
+        ProblemMapping * m = new ProblemMapping();
+        intel_load_variables((dataDir + "/var.txt").c_str(), d, v, c, m);
 
-        CSPProblem * p = new CSPProblem(v, c);
+        CSPProblem * p = new CSPProblem(v, c, m);
+
+        VariableOrdering ordering;
+        if (!parse_variable_ordering(parser.getOptionArg("ordering"), ordering)) {
+                std::cerr << "Unknown variable ordering: " << parser.getOptionArg("ordering") << std::endl;
+                return EXIT_FAILURE;
+        }
+
+        RestartPolicy restartPolicy;
+        if (!parse_restart_policy(parser.getOptionArg("restarts"), restartPolicy)) {
+                std::cerr << "Unknown restart policy: " << parser.getOptionArg("restarts") << std::endl;
+                return EXIT_FAILURE;
+        }
+
+        SACMode sacMode;
+        if (!parse_sac_mode(parser.getOptionArg("sac"), sacMode)) {
+                std::cerr << "Unknown SAC mode: " << parser.getOptionArg("sac") << std::endl;
+                return EXIT_FAILURE;
+        }
+
+        // Only "ijgp" weights its samples (CSPSampler::getSampleLogWeight)
+        bool weighted = parser.isSpecified("weighted");
+        if (weighted && parser.getOptionArg("sampler") != "ijgp") {
+                std::cerr << "The samples of " << parser.getOptionArg("sampler") << " are not weighted, "
+                        << "--weighted needs the \"ijgp\" sampler" << std::endl;
+                return EXIT_FAILURE;
+        }
+
+        std::string sacCache = parser.isSpecified("sacCache") ? parser.getOptionArg("sacCache") : "";
+        if (!sac_preprocess(p, sacMode, parseArg<unsigned int>(parser.getOptionArg("sacThreads")), sacCache)) {
+                std::cout << "No solution exists." << std::endl;
+                return EXIT_SUCCESS;
+        }
 
         std::string samplerId = parser.getOptionArg("sampler");
         CSPSampler * sampler;
 
         unsigned int numSamples = parseArg<unsigned int>(parser.getOptionArg("numSamples"));
+        unsigned int numThreads = parseArg<unsigned int>(parser.getOptionArg("threads"));
         std::cout << "PARAMS:" << std::endl;
         std::cout << "sampler:\t" << samplerId << std::endl;
         std::cout << "dataset:\t" << dataDir << std::endl;
         std::cout << "numSamples:\t" << numSamples << std::endl;
+        std::cout << "threads:\t" << numThreads << std::endl;
+        std::cout << "time budget:\t" << (deadline > 0 ? deadline - startTime : 0) << std::endl;
+
+        if (numSamples == 0 && deadline > 0)
+                numSamples = std::numeric_limits<unsigned int>::max();
+        std::cout << "SAC:\t" << parser.getOptionArg("sac") << std::endl;
+        std::cout << "ordering:\t" << parser.getOptionArg("ordering") << std::endl;
+        std::cout << "backjumping:\t" << (parser.isSpecified("backjump") ? "yes" : "no") << std::endl;
         std::cout << "intelModelType:\t" << modelType << std::endl;
 
+        // The nogoods of "ijgp"; with --threads the workers learn into their own copies, which are not saved
+        NogoodStore * nogoods = 0;
+        bool limitedSearch = false;
+        const DistributionCache * distributionCache = 0;
+        const IJGPController * ijgpController = 0;
+        std::string nogoodCache = parser.isSpecified("nogoodCache") ? parser.getOptionArg("nogoodCache") : "";
+
         if (samplerId == "ijgp") {
                 int miniBucketSize = parseArg<int>(parser.getOptionArg("bucketSize"));
                 unsigned int ijgpIter = parseArg<unsigned int>(parser.getOptionArg("ijgpIter"));
                 double ijgpProbability = parseArg<double>(parser.getOptionArg("ijgpProbability"));
+                unsigned int searchThreads = parseArg<unsigned int>(parser.getOptionArg("searchThreads"));
+                size_t maxNogoods = parseArg<size_t>(parser.getOptionArg("nogoods"));
+                double sampleTimeout = parseArg<double>(parser.getOptionArg("sampleTimeout"));
+                double ijgpTolerance = parseArg<double>(parser.getOptionArg("ijgpTolerance"));
+                size_t ijgpCache = parseArg<size_t>(parser.getOptionArg("ijgpCache"));
+                size_t distCache = parseArg<size_t>(parser.getOptionArg("distCache"));
+                unsigned int ijgpLazy = parseArg<unsigned int>(parser.getOptionArg("ijgpLazy"));
+                double ijgpGainRate = parseArg<double>(parser.getOptionArg("ijgpGainRate"));
+                unsigned int maxNogoodSize = parseArg<unsigned int>(parser.getOptionArg("nogoodSize"));
 
                 std::cout << "mini-bucket size:\t" << miniBucketSize << std::endl;
                 std::cout << "IJGP probability:\t" << ijgpProbability << std::endl;
                 std::cout << "IJGP iterations:\t" << ijgpIter << std::endl;
-
-                sampler = new IJGPSampler(p, miniBucketSize, ijgpProbability, ijgpIter);
+                std::cout << "search threads:\t" << searchThreads << std::endl;
+                std::cout << "nogoods:\t" << maxNogoods << std::endl;
+                std::cout << "nogood size:\t" << maxNogoodSize << std::endl;
+                std::cout << "IJGP tolerance:\t" << ijgpTolerance << std::endl;
+                std::cout << "IJGP warm start:\t" << (parser.isSpecified("ijgpWarmStart") ? "yes" : "no") << std::endl;
+                std::cout << "distribution cache:\t" << distCache << std::endl;
+                std::cout << "IJGP lazy depth:\t" << ijgpLazy << std::endl;
+                std::cout << "adaptive IJGP:\t" << (parser.isSpecified("ijgpAdaptive") ? "yes" : "no") << std::endl;
+                std::cout << "IJGP gain rate:\t" << ijgpGainRate << std::endl;
+                std::cout << "restarts:\t" << parser.getOptionArg("restarts") << std::endl;
+                std::cout << "sample timeout:\t" << sampleTimeout << std::endl;
+
+                IJGPSampler * ijgpSampler = new IJGPSampler(p, miniBucketSize, ijgpProbability, ijgpIter);
+                ijgpSampler->setVariableOrdering(ordering);
+                ijgpSampler->setBackjumping(parser.isSpecified("backjump"));
+                ijgpSampler->setConvergenceTolerance(ijgpTolerance);
+                ijgpSampler->setWarmStart(parser.isSpecified("ijgpWarmStart"), ijgpCache);
+                ijgpSampler->setDistributionCache(distCache);
+                ijgpSampler->setLazyPropagation(ijgpLazy);
+                distributionCache = ijgpSampler->getDistributionCache();
+                ijgpSampler->setAdaptiveIJGP(parser.isSpecified("ijgpAdaptive"), ijgpGainRate);
+                ijgpController = ijgpSampler->getIJGPController();
+                ijgpSampler->setNogoodLearning(maxNogoods, maxNogoodSize);
+                nogoods = ijgpSampler->getNogoodStore();
+                if (nogoods && !nogoodCache.empty() && nogoods->load(nogoodCache.c_str()))
+                        std::cout << "Nogoods loaded from " << nogoodCache << ": " << nogoods->size() << std::endl;
+                ijgpSampler->setRestarts(RestartSchedule(restartPolicy, parseArg<unsigned long>(parser.getOptionArg("restartBase")),
+                                        parseArg<double>(parser.getOptionArg("restartFactor"))), sampleTimeout);
+                limitedSearch = restartPolicy != RESTART_NONE || sampleTimeout > 0 || deadline > 0;
+                ijgpSampler->setSearchThreads(searchThreads);
+                sampler = ijgpSampler;
         } else if (samplerId == "gibbs") {
                 int burnIn = parseArg<int>(parser.getOptionArg("burnIn"));
 
@@ -145,25 +350,102 @@ int main(int argc, char ** argv) {
                 std::cout << "Max domain intervals:\t" << maxDomainIntervals << std::endl;
                 std::cout << "Max values from interval:\t" << maxValuesFromInterval << std::endl;
 
-                sampler = new IntervalIJGPSampler(p, miniBucketSize, ijgpProbability, ijgpIter, maxDomainIntervals,
-                                maxValuesFromInterval);
+                IntervalIJGPSampler * intervalSampler = new IntervalIJGPSampler(p, miniBucketSize, ijgpProbability, ijgpIter,
+                                maxDomainIntervals, maxValuesFromInterval);
+                intervalSampler->setVariableOrdering(ordering);
+                intervalSampler->setBackjumping(parser.isSpecified("backjump"));
+                sampler = intervalSampler;
         }
         std::cout << std::endl;
 
 
+        double samplingStart = current_time();
+        sampler->setTimeBudget(samplingStart, deadline);
+
+        // A single thread samples directly, which keeps the sequence of rand()
+        SampleFarm * farm = 0;
+        if (numThreads > 1)
+                farm = new SampleFarm(sampler, numThreads, numSamples, !parser.isSpecified("unordered"), deadline);
+
         Assignment a;
+        unsigned int numAbandoned = 0;
+        WeightedMarginals marginals;
+        unsigned int numFound = 0;
         for (unsigned int i = 0; i < numSamples; ++i) {
-                bool solutionExists = sampler->getSample(a);
+                bool solutionExists;
+                double logWeight;
+
+                if (deadline > 0 && current_time() >= deadline)
+                        break;
+
+                if (!farm) {
+                        solutionExists = sampler->getSample(a);
+                        if (!solutionExists && sampler->sampleAbandoned()) {
+                                ++numAbandoned;
+                                continue;
+                        }
+                        logWeight = sampler->getSampleLogWeight();
+                } else if (!farm->getSample(a, solutionExists, logWeight)) {
+                        break;
+                }
+
                 if (solutionExists) {
-                        std::cout << "SAMPLE " << p->evalAssignment(a) << " | ";
-                        std::cout << assignment_pprint(a);
-                        std::cout << std::endl;
+                        // The workers of a farm are quiet (CSPSampler::setQuiet), the samples are the only output then
+                        Assignment decoded = p->decodeAssignment(a);
+                        std::ostringstream line;
+                        line << "SAMPLE " << p->evalAssignment(a) << " | ";
+                        if (weighted) {
+                                line << logWeight << " | ";
+                                marginals.addSample(decoded, logWeight);
+                        }
+                        line << assignment_pprint(decoded) << std::endl;
+                        std::cout << line.str();
+                        std::cout.flush();
+                        ++numFound;
                 } else {
                         std::cout << "No solution exists." << std::endl;
                         break;
                 }
         }
 
+        if (weighted) {
+                std::map<VarIdType, ProbabilityDistribution> estimates;
+                marginals.getMarginals(estimates);
+
+                std::cout << "effective sample size:\t" << marginals.getEffectiveSampleSize() << std::endl;
+                for (std::map<VarIdType, ProbabilityDistribution>::const_iterator varIt = estimates.begin();
+                                varIt != estimates.end(); ++varIt) {
+                        std::cout << "MARGINAL " << varIt->first << " " << probability_distribution_pprint(varIt->second) << std::endl;
+                }
+        }
+
+        if (deadline > 0) {
+                double now = current_time();
+                std::cout << "samples:\t" << numFound << std::endl;
+                std::cout << "sampling time:\t" << now - samplingStart << std::endl;
+                std::cout << "deadline reached:\t" << (now >= deadline ? "yes" : "no") << std::endl;
+        }
+
+        if (limitedSearch) {
+                std::cout << "number of restarts:\t" << (farm ? farm->getNumRestarts() : sampler->getNumRestarts()) << std::endl;
+                std::cout << "abandoned samples:\t" << (farm ? farm->getNumAbandoned() : numAbandoned) << std::endl;
+        }
+
+        // The workers of the farm have caches and controllers of their own
+        if (ijgpController && !farm) {
+                std::cout << "IJGP runs:\t" << ijgpController->getNumRuns() << " / "
+                        << ijgpController->getNumRuns() + ijgpController->getNumSkipped() << std::endl;
+        }
+        if (distributionCache && !farm) {
+                std::cout << "distribution cache hits:\t" << distributionCache->getNumHits() << " / "
+                        << distributionCache->getNumLookups() << std::endl;
+        }
+
+        delete farm;
+
+        if (nogoods && !nogoodCache.empty())
+                nogoods->save(nogoodCache.c_str());
+
         return EXIT_SUCCESS;
 }
 
@@ -0,0 +1,253 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "nogood_store.h"
+#include "utils.h"
+
+NogoodStore::NogoodStore(const CSPProblem * aProblem, size_t aMaxNogoods, unsigned int aMaxSize):
+        mMapping(aProblem->getMapping()), mProblemHash(aProblem->getContentHash()),
+        mMaxNogoods(aMaxNogoods), mMaxSize(aMaxSize), mNextEntry(0) {
+
+        assert(aMaxNogoods > 0);
+
+        size_t numLiterals = 0;
+        for (VarIdType varId = 0; varId < mMapping->getNumVariables(); ++varId) {
+                mLiteralOffsets.push_back(numLiterals);
+                numLiterals += mMapping->getDomainSize(varId);
+        }
+
+        mWatches.resize(numLiterals);
+}
+
+bool NogoodStore::add(const Nogood & aNogood, const std::vector<int> & aDepths) {
+        assert(aDepths.empty() || aDepths.size() == aNogood.size());
+
+        if (aNogood.empty() || aNogood.size() > mMaxSize)
+                return false;
+
+        unsigned long hash = _hash(aNogood);
+        std::map<unsigned long, size_t>::const_iterator indexIt = mIndex.find(hash);
+        if (indexIt != mIndex.end()) {
+                // Another nogood with the same hash is not stored either
+                return false;
+        }
+
+        if (mEntries.size() < mMaxNogoods) {
+                mEntries.push_back(Entry());
+                mEntries.back().generation = 0;
+                mEntries.back().used = false;
+        }
+
+        // Replace the oldest nogood, its watches become stale
+        size_t entryIndex = mNextEntry;
+        mNextEntry = (mNextEntry + 1) % mMaxNogoods;
+
+        Entry & entry = mEntries[entryIndex];
+        if (entry.used) {
+                mIndex.erase(entry.hash);
+                ++entry.generation;
+        }
+
+        entry.literals = aNogood;
+        entry.hash = hash;
+        entry.used = true;
+        mIndex[hash] = entryIndex;
+
+        if (aNogood.size() >= 2) {
+                Watch watch = { entryIndex, entry.generation };
+
+                // The unassigned literals first, then the deepest ones
+                entry.watches[0] = 0;
+                entry.watches[1] = 1;
+                if (!aDepths.empty()) {
+                        if (_watchBefore(aDepths[1], aDepths[0]))
+                                std::swap(entry.watches[0], entry.watches[1]);
+
+                        for (unsigned int l = 2; l < aNogood.size(); ++l) {
+                                if (_watchBefore(aDepths[l], aDepths[entry.watches[0]])) {
+                                        entry.watches[1] = entry.watches[0];
+                                        entry.watches[0] = l;
+                                } else if (_watchBefore(aDepths[l], aDepths[entry.watches[1]])) {
+                                        entry.watches[1] = l;
+                                }
+                        }
+                }
+
+                for (unsigned int i = 0; i < 2; ++i) {
+                        mWatches[_literalIndex(aNogood[entry.watches[i]])].push_back(watch);
+                }
+        }
+
+        return true;
+}
+
+bool NogoodStore::propagate(VarIdType aVarId, VarType aValue, const Assignment & aEvidence,
+                std::vector<const Nogood *> & outUnits, const Nogood * & outViolated) {
+
+        std::vector<Watch> & watches = mWatches[_literalIndex(Literal(aVarId, aValue))];
+
+        size_t i = 0;
+        while (i < watches.size()) {
+                Entry & entry = mEntries[watches[i].entry];
+
+                if (!entry.used || entry.generation != watches[i].generation) {
+                        // The nogood has been replaced
+                        watches[i] = watches.back();
+                        watches.pop_back();
+                        continue;
+                }
+
+                unsigned int watched = (entry.literals[entry.watches[0]] == Literal(aVarId, aValue)) ? 0 : 1;
+                assert(entry.literals[entry.watches[watched]] == Literal(aVarId, aValue));
+                const Literal & other = entry.literals[entry.watches[1 - watched]];
+
+                // Watch another literal which does not hold
+                bool moved = false;
+                for (unsigned int l = 0; l < entry.literals.size(); ++l) {
+                        if (l == entry.watches[0] || l == entry.watches[1] || _holds(entry.literals[l], aEvidence))
+                                continue;
+
+                        entry.watches[watched] = l;
+                        mWatches[_literalIndex(entry.literals[l])].push_back(watches[i]);
+                        watches[i] = watches.back();
+                        watches.pop_back();
+                        moved = true;
+                        break;
+                }
+
+                if (moved)
+                        continue;
+
+                Assignment::const_iterator otherIt = aEvidence.find(other.first);
+                if (otherIt == aEvidence.end()) {
+                        outUnits.push_back(&entry.literals);
+                } else if (otherIt->second == other.second) {
+                        outViolated = &entry.literals;
+                        return false;
+                }
+
+                ++i;
+        }
+
+        return true;
+}
+
+void NogoodStore::getUnaryNogoods(std::vector<Literal> & outLiterals) const {
+        for (std::vector<Entry>::const_iterator entryIt = mEntries.begin(); entryIt != mEntries.end(); ++entryIt) {
+                if (entryIt->used && entryIt->literals.size() == 1)
+                        outLiterals.push_back(entryIt->literals[0]);
+        }
+}
+
+bool NogoodStore::save(const char * aFileName) const {
+        std::ofstream file(aFileName);
+        if (!file)
+                return false;
+
+        file << _header() << std::endl;
+        for (std::vector<Entry>::const_iterator entryIt = mEntries.begin(); entryIt != mEntries.end(); ++entryIt) {
+                if (!entryIt->used)
+                        continue;
+
+                for (Nogood::const_iterator litIt = entryIt->literals.begin(); litIt != entryIt->literals.end(); ++litIt) {
+                        file << (litIt == entryIt->literals.begin() ? "" : " ") << mMapping->getOriginalId(litIt->first)
+                                << " " << mMapping->getOriginalValue(litIt->first, litIt->second);
+                }
+                file << std::endl;
+        }
+
+        return file.good();
+}
+
+bool NogoodStore::load(const char * aFileName) {
+        std::ifstream file(aFileName);
+        std::string line;
+
+        if (!std::getline(file, line) || line != _header())
+                return false;
+
+        // Read everything first, so that a broken file does not add anything
+        std::vector<Nogood> nogoods;
+        while (std::getline(file, line)) {
+                std::vector<std::string> words;
+                tokenize(line, words);
+                if (words.empty() || words.size() % 2 != 0)
+                        return false;
+
+                Nogood nogood;
+                for (size_t i = 0; i < words.size(); i += 2) {
+                        VarIdType originalId = parseArg<VarIdType>(words[i]);
+                        if (!mMapping->hasVariable(originalId))
+                                return false;
+
+                        VarIdType varId = mMapping->getIndex(originalId);
+                        VarType valueIndex = mMapping->findValueIndex(varId, parseArg<VarType>(words[i + 1]));
+                        if (valueIndex < 0)
+                                return false;
+
+                        nogood.push_back(Literal(varId, valueIndex));
+                }
+
+                std::sort(nogood.begin(), nogood.end());
+                nogoods.push_back(nogood);
+        }
+
+        for (std::vector<Nogood>::const_iterator nogoodIt = nogoods.begin(); nogoodIt != nogoods.end(); ++nogoodIt) {
+                add(*nogoodIt);
+        }
+
+        return true;
+}
+
+unsigned long NogoodStore::_hash(const Nogood & aNogood) {
+        // FNV-1a over the literals
+        unsigned long hash = 2166136261UL;
+        for (Nogood::const_iterator litIt = aNogood.begin(); litIt != aNogood.end(); ++litIt) {
+                hash = (hash ^ litIt->first) * 16777619UL;
+                hash = (hash ^ (unsigned long)litIt->second) * 16777619UL;
+        }
+
+        return hash;
+}
+
+bool NogoodStore::_watchBefore(int aDepth, int aOtherDepth) {
+        if (aOtherDepth < 0)
+                return false;
+
+        return aDepth < 0 || aDepth > aOtherDepth;
+}
+
+bool NogoodStore::_holds(const Literal & aLiteral, const Assignment & aEvidence) {
+        Assignment::const_iterator aIt = aEvidence.find(aLiteral.first);
+        return aIt != aEvidence.end() && aIt->second == aLiteral.second;
+}
+
+std::string NogoodStore::_header() const {
+        std::ostringstream out;
+        out << "NOGOODS " << mMapping->getNumVariables() << " " << std::hex << mProblemHash;
+        return out.str();
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef NOGOOD_STORE_H_
+#define NOGOOD_STORE_H_
+
+#include <map>
+#include <vector>
+
+#include "csp.h"
+
+/**
+ * Literal var = value of a nogood (a dense variable id and a value index)
+ */
+typedef std::pair<VarIdType, VarType> Literal;
+
+/**
+ * The literals of a nogood can not hold together in any solution, they are sorted by the variables
+ */
+typedef std::vector<Literal> Nogood;
+
+/**
+ * Bounded store of nogoods learned by the search. The nogoods are indexed by their hash, so
+ * that a nogood is stored only once; when the store is full, a new nogood replaces the oldest.
+ *
+ * A nogood is propagated by watching two of its literals which do not hold (the variable is
+ * not assigned the value): when a watched literal holds, another one is watched, and if
+ * there is none, the nogood is violated or its last literal must be false. The watches stay
+ * valid when the search backtracks, so nothing is undone. A nogood learned by the search
+ * holds entirely, its two deepest literals are watched as the backtrack undoes them first.
+ */
+class NogoodStore {
+public:
+        /**
+         * At most aMaxNogoods nogoods of at most aMaxSize literals over the variables of aProblem
+         */
+        NogoodStore(const CSPProblem * aProblem, size_t aMaxNogoods, unsigned int aMaxSize);
+
+        /**
+         * Adds a nogood (sorted) unless it is empty, longer than the maximal size or already
+         * stored, returns true if it has been added. aDepths are the depths at which the
+         * literals have been assigned (-1 if not), empty when none of them is assigned.
+         */
+        bool add(const Nogood & aNogood, const std::vector<int> & aDepths = std::vector<int>());
+
+        /**
+         * Propagates the assignment aVarId = aValue, which is already in aEvidence. Returns false
+         * if a nogood holds entirely (outViolated), otherwise outUnits gets the nogoods whose
+         * only literal not in aEvidence has an unassigned variable.
+         */
+        bool propagate(VarIdType aVarId, VarType aValue, const Assignment & aEvidence,
+                        std::vector<const Nogood *> & outUnits, const Nogood * & outViolated);
+
+        /**
+         * The nogoods of a single literal (they hold for the initial domains)
+         */
+        void getUnaryNogoods(std::vector<Literal> & outLiterals) const;
+
+        size_t size() const {
+                return mIndex.size();
+        };
+
+        /**
+         * Saves the nogoods (in the original variables and values) with a header identifying the problem
+         */
+        bool save(const char * aFileName) const;
+
+        /**
+         * Adds the nogoods saved for the same problem. Returns false (and adds nothing) if the
+         * file does not exist or was saved for another problem.
+         */
+        bool load(const char * aFileName);
+private:
+        struct Entry {
+                Nogood literals;
+                unsigned int watches[2];
+                unsigned long hash;
+                unsigned int generation;
+                bool used;
+        };
+
+        // A watch of the entry with the given index, stale if the entry has been replaced since
+        struct Watch {
+                size_t entry;
+                unsigned int generation;
+        };
+
+        size_t _literalIndex(const Literal & aLiteral) const {
+                return mLiteralOffsets[aLiteral.first] + aLiteral.second;
+        };
+
+        static unsigned long _hash(const Nogood & aNogood);
+
+        /**
+         * True if a literal assigned at aDepth should rather be watched than one assigned at
+         * aOtherDepth (-1 for a literal not assigned)
+         */
+        static bool _watchBefore(int aDepth, int aOtherDepth);
+
+        static bool _holds(const Literal & aLiteral, const Assignment & aEvidence);
+
+        std::string _header() const;
+
+        const ProblemMapping * mMapping;
+        unsigned long mProblemHash;
+
+        size_t mMaxNogoods;
+        unsigned int mMaxSize;
+
+        std::vector<Entry> mEntries;
+        size_t mNextEntry;
+
+        // Entry by the hash of the nogood
+        std::map<unsigned long, size_t> mIndex;
+
+        std::vector<size_t> mLiteralOffsets;
+        std::vector<std::vector<Watch> > mWatches;
+};
+
+#endif // NOGOOD_STORE_H_
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+#include <algorithm>
+
+#include "problem_mapping.h"
+
+VarIdType ProblemMapping::addVariable(VarIdType aOriginalId, const Domain & aDomain) {
+        assert(mIndices.empty() || mIndices.rbegin()->first < aOriginalId);
+
+        VarIdType index = mOriginalIds.size();
+        mIndices[aOriginalId] = index;
+        mOriginalIds.push_back(aOriginalId);
+        mValues.push_back(std::vector<VarType>(aDomain.begin(), aDomain.end()));
+
+        return index;
+}
+
+VarIdType ProblemMapping::getIndex(VarIdType aOriginalId) const {
+        std::map<VarIdType, VarIdType>::const_iterator indexIt = mIndices.find(aOriginalId);
+        assert(indexIt != mIndices.end());
+
+        return indexIt->second;
+}
+
+VarType ProblemMapping::findValueIndex(VarIdType aIndex, VarType aOriginalValue) const {
+        const std::vector<VarType> & values = mValues[aIndex];
+        std::vector<VarType>::const_iterator valIt = std::lower_bound(values.begin(), values.end(), aOriginalValue);
+
+        if (valIt == values.end() || *valIt != aOriginalValue)
+                return -1;
+
+        return valIt - values.begin();
+}
+
+VarType ProblemMapping::lowerBoundIndex(VarIdType aIndex, VarType aOriginalValue) const {
+        const std::vector<VarType> & values = mValues[aIndex];
+        return std::lower_bound(values.begin(), values.end(), aOriginalValue) - values.begin();
+}
+
+VarType ProblemMapping::upperBoundIndex(VarIdType aIndex, VarType aOriginalValue) const {
+        const std::vector<VarType> & values = mValues[aIndex];
+        return std::upper_bound(values.begin(), values.end(), aOriginalValue) - values.begin();
+}
+
+Assignment ProblemMapping::decodeAssignment(const Assignment & aAssignment) const {
+        Assignment result;
+        for (Assignment::const_iterator aIt = aAssignment.begin(); aIt != aAssignment.end(); ++aIt) {
+                result[mOriginalIds[aIt->first]] = getOriginalValue(aIt->first, aIt->second);
+        }
+        return result;
+}
+
+Assignment ProblemMapping::encodeAssignment(const Assignment & aAssignment) const {
+        Assignment result;
+        for (Assignment::const_iterator aIt = aAssignment.begin(); aIt != aAssignment.end(); ++aIt) {
+                if (!hasVariable(aIt->first))
+                        continue;
+
+                VarIdType index = getIndex(aIt->first);
+                VarType valueIndex = findValueIndex(index, aIt->second);
+                if (valueIndex >= 0)
+                        result[index] = valueIndex;
+        }
+        return result;
+}
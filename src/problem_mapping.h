@@ -0,0 +1,118 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PROBLEM_MAPPING_H_
+#define PROBLEM_MAPPING_H_
+
+#include <map>
+#include <vector>
+
+#include "types.h"
+
+/**
+ * Translation between the identifiers used in the data files and the dense
+ * identifiers used inside the solver.
+ *
+ * Every variable gets an index 0..n-1 (in the order of its original id) and every
+ * value in its domain gets an index 0..d-1 (in the order of the original values).
+ * All the assignments, domains and tables in the solver work with these indices,
+ * the original ids and values are only needed when printing the results.
+ */
+class ProblemMapping {
+public:
+        ProblemMapping() {};
+
+        /**
+         * Registers a variable with its original domain. Variables have to be added
+         * in the order of their original ids. Returns the dense index of the variable.
+         */
+        VarIdType addVariable(VarIdType aOriginalId, const Domain & aDomain);
+
+        size_t getNumVariables() const {
+                return mOriginalIds.size();
+        };
+
+        bool hasVariable(VarIdType aOriginalId) const {
+                return mIndices.find(aOriginalId) != mIndices.end();
+        };
+
+        /**
+         * Dense index of the variable with a given original id
+         */
+        VarIdType getIndex(VarIdType aOriginalId) const;
+
+        VarIdType getOriginalId(VarIdType aIndex) const {
+                return mOriginalIds[aIndex];
+        };
+
+        size_t getDomainSize(VarIdType aIndex) const {
+                return mValues[aIndex].size();
+        };
+
+        /**
+         * Original value of the aValueIndex-th value of a given variable
+         */
+        VarType getOriginalValue(VarIdType aIndex, VarType aValueIndex) const {
+                return mValues[aIndex][aValueIndex];
+        };
+
+        /**
+         * Sorted original values of the variable domain (indexed by value indices)
+         */
+        const std::vector<VarType> & getOriginalValues(VarIdType aIndex) const {
+                return mValues[aIndex];
+        };
+
+        /**
+         * Index of an original value in the domain of a variable, or -1 if the value
+         * is not in the domain
+         */
+        VarType findValueIndex(VarIdType aIndex, VarType aOriginalValue) const;
+
+        /**
+         * Index of the first value in the domain which is not less than aOriginalValue
+         * (which is the domain size if there is no such value)
+         */
+        VarType lowerBoundIndex(VarIdType aIndex, VarType aOriginalValue) const;
+
+        /**
+         * Index of the first value in the domain which is greater than aOriginalValue
+         */
+        VarType upperBoundIndex(VarIdType aIndex, VarType aOriginalValue) const;
+
+        /**
+         * Converts an assignment of indices to an assignment of the original
+         * variables and values
+         */
+        Assignment decodeAssignment(const Assignment & aAssignment) const;
+
+        /**
+         * Converts an assignment of original variables and values to indices. Values which
+         * are not in the domains are left out.
+         */
+        Assignment encodeAssignment(const Assignment & aAssignment) const;
+private:
+        std::map<VarIdType, VarIdType> mIndices;
+        std::vector<VarIdType> mOriginalIds;
+        std::vector<std::vector<VarType> > mValues;
+};
+
+#endif // PROBLEM_MAPPING_H_
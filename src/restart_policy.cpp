@@ -0,0 +1,76 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+
+#include "restart_policy.h"
+
+bool parse_restart_policy(const std::string & aArg, RestartPolicy & outPolicy) {
+        if (aArg == "none") {
+                outPolicy = RESTART_NONE;
+        } else if (aArg == "luby") {
+                outPolicy = RESTART_LUBY;
+        } else if (aArg == "geometric") {
+                outPolicy = RESTART_GEOMETRIC;
+        } else {
+                return false;
+        }
+
+        return true;
+}
+
+RestartSchedule::RestartSchedule(RestartPolicy aPolicy, unsigned long aBase, double aFactor):
+        mPolicy(aPolicy), mBase(aBase > 0 ? aBase : 1), mFactor(aFactor > 1.0 ? aFactor : 1.0), mRun(0) {
+}
+
+unsigned long RestartSchedule::nextLimit() {
+        unsigned long run = mRun++;
+
+        if (mPolicy == RESTART_LUBY) {
+                return mBase * _luby(run);
+        } else if (mPolicy == RESTART_GEOMETRIC) {
+                double limit = mBase;
+                for (unsigned long i = 0; i < run && limit < 1e15; ++i) {
+                        limit *= mFactor;
+                }
+                return (unsigned long)limit;
+        }
+
+        return 0;
+}
+
+unsigned long RestartSchedule::_luby(unsigned long aIndex) {
+        // Find the complete subsequence of length 2^k - 1 containing the element
+        unsigned long size = 1, power = 1;
+        while (size < aIndex + 1) {
+                size = 2 * size + 1;
+                power *= 2;
+        }
+
+        // The element is the last one of its subsequence, or it is in its first half
+        while (size - 1 != aIndex) {
+                size /= 2;
+                power /= 2;
+                aIndex %= size;
+        }
+
+        return power;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef RESTART_POLICY_H_
+#define RESTART_POLICY_H_
+
+#include <string>
+
+enum RestartPolicy {
+        RESTART_NONE, // The search of a sample is not limited
+        RESTART_LUBY, // The limits are the base times the Luby sequence 1, 1, 2, 1, 1, 2, 4, ...
+        RESTART_GEOMETRIC // The limits grow by the factor from the base
+};
+
+/**
+ * Parses the policy from the command line ("none", "luby" or "geometric"), returns
+ * false for an unknown policy
+ */
+bool parse_restart_policy(const std::string & aArg, RestartPolicy & outPolicy);
+
+/**
+ * The backtrack limits of the successive runs of the search of one sample
+ */
+class RestartSchedule {
+public:
+        RestartSchedule(RestartPolicy aPolicy, unsigned long aBase, double aFactor);
+
+        /**
+         * Starts the schedule again with the first run
+         */
+        void reset() {
+                mRun = 0;
+        };
+
+        /**
+         * The backtrack limit of the next run, 0 if it is not limited
+         */
+        unsigned long nextLimit();
+
+        RestartPolicy getPolicy() const {
+                return mPolicy;
+        };
+private:
+        /**
+         * The i-th element of the Luby sequence (from 0)
+         */
+        static unsigned long _luby(unsigned long aIndex);
+
+        RestartPolicy mPolicy;
+        unsigned long mBase;
+        double mFactor;
+        unsigned long mRun;
+};
+
+#endif // RESTART_POLICY_H_
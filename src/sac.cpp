@@ -0,0 +1,297 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+#include <pthread.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "sac.h"
+#include "utils.h"
+
+bool parse_sac_mode(const std::string & aArg, SACMode & outMode) {
+        if (aArg == "none") {
+                outMode = SAC_NONE;
+        } else if (aArg == "full") {
+                outMode = SAC_FULL;
+        } else if (aArg == "bounds") {
+                outMode = SAC_BOUNDS;
+        } else {
+                return false;
+        }
+
+        return true;
+}
+
+/**
+ * Assigns aValue to aVarId and propagates, returns false if some domain becomes empty.
+ * The domains are the same on return.
+ */
+static bool sac_probe(CSPProblem * aProblem, VarIdType aVarId, VarType aValue) {
+        Variable * var = aProblem->getVariableById(aVarId);
+
+        Assignment evidence;
+        evidence[aVarId] = aValue;
+
+        Domain restrictedValues;
+        var->restrictDomainToValue(aValue, restrictedValues);
+
+        std::map<VarIdType, Domain> removedValues;
+        bool consistent = aProblem->propagateConstraints(evidence, removedValues, aVarId);
+
+        aProblem->restoreDomains(removedValues);
+        var->restoreRestrictedDomain(restrictedValues);
+
+        return consistent;
+}
+
+/**
+ * Probes of one round in one thread: the variables are taken from a shared counter
+ */
+struct SACWorker {
+        CSPProblem * problem; // Working copy of the problem
+        SACMode mode;
+        VarIdType * nextVariable;
+        pthread_mutex_t * mutex;
+
+        // Values whose probes failed
+        std::vector<std::pair<VarIdType, VarType> > failedValues;
+};
+
+/**
+ * Probes the values of a variable, the failed ones are also removed from the working copy
+ * (they have no support in any solution, so the later probes may use that)
+ */
+static void sac_probe_variable(SACWorker * aWorker, VarIdType aVarId) {
+        Variable * var = aWorker->problem->getVariableById(aVarId);
+        const DomainView * domain = var->getDomain();
+
+        if (domain->size() <= 1)
+                return; // A single value has already passed the arc consistency
+
+        if (aWorker->mode == SAC_FULL) {
+                std::vector<VarType> values(domain->begin(), domain->end());
+                for (std::vector<VarType>::const_iterator valIt = values.begin(); valIt != values.end(); ++valIt) {
+                        if (!sac_probe(aWorker->problem, aVarId, *valIt)) {
+                                aWorker->failedValues.push_back(std::make_pair(aVarId, *valIt));
+                                var->eraseFromDomain(*valIt);
+                        }
+                }
+        } else {
+                // Shrink the domain from below and from above until the bounds pass the probes
+                while (!domain->empty() && !sac_probe(aWorker->problem, aVarId, *domain->begin())) {
+                        aWorker->failedValues.push_back(std::make_pair(aVarId, *domain->begin()));
+                        var->eraseFromDomain(*domain->begin());
+                }
+                while (!domain->empty() && !sac_probe(aWorker->problem, aVarId, *domain->rbegin())) {
+                        aWorker->failedValues.push_back(std::make_pair(aVarId, *domain->rbegin()));
+                        var->eraseFromDomain(*domain->rbegin());
+                }
+        }
+}
+
+static void * sac_worker_run(void * aWorker) {
+        SACWorker * worker = static_cast<SACWorker *>(aWorker);
+        size_t numVariables = worker->problem->getVariables()->size();
+
+        while (true) {
+                pthread_mutex_lock(worker->mutex);
+                VarIdType varId = (*worker->nextVariable)++;
+                pthread_mutex_unlock(worker->mutex);
+
+                if (varId >= numVariables)
+                        break;
+
+                sac_probe_variable(worker, varId);
+        }
+
+        return 0;
+}
+
+bool singleton_arc_consistency(CSPProblem * aProblem, SACMode aMode, unsigned int aNumThreads) {
+        assert(aProblem);
+
+        if (aMode == SAC_NONE)
+                return true;
+
+        if (aNumThreads == 0)
+                aNumThreads = 1;
+
+        // Start from arc consistent domains, the removed values are never restored
+        Assignment evidence;
+        std::map<VarIdType, Domain> removedValues;
+        if (!aProblem->propagateConstraints(evidence, removedValues))
+                return false;
+
+        bool domainsChanged = true;
+        while (domainsChanged) {
+                domainsChanged = false;
+
+                VarIdType nextVariable = 0;
+                pthread_mutex_t mutex;
+                pthread_mutex_init(&mutex, 0);
+
+                std::vector<SACWorker> workers(aNumThreads);
+                for (unsigned int i = 0; i < aNumThreads; ++i) {
+                        workers[i].problem = aProblem->createWorkingCopy();
+                        workers[i].mode = aMode;
+                        workers[i].nextVariable = &nextVariable;
+                        workers[i].mutex = &mutex;
+                }
+
+                if (aNumThreads == 1) {
+                        sac_worker_run(&workers[0]);
+                } else {
+                        std::vector<pthread_t> threads(aNumThreads);
+                        for (unsigned int i = 0; i < aNumThreads; ++i) {
+                                pthread_create(&threads[i], 0, sac_worker_run, &workers[i]);
+                        }
+                        for (unsigned int i = 0; i < aNumThreads; ++i) {
+                                pthread_join(threads[i], 0);
+                        }
+                }
+
+                pthread_mutex_destroy(&mutex);
+
+                // Remove the failed values from the problem itself and propagate the removals
+                for (unsigned int i = 0; i < aNumThreads; ++i) {
+                        const std::vector<std::pair<VarIdType, VarType> > & failed = workers[i].failedValues;
+                        for (std::vector<std::pair<VarIdType, VarType> >::const_iterator failIt = failed.begin();
+                                        failIt != failed.end(); ++failIt) {
+                                aProblem->getVariableById(failIt->first)->eraseFromDomain(failIt->second);
+                                domainsChanged = true;
+                        }
+
+                        delete workers[i].problem;
+                }
+
+                if (domainsChanged) {
+                        for (VarIdType varId = 0; varId < aProblem->getVariables()->size(); ++varId) {
+                                if (aProblem->getVariableById(varId)->getDomain()->empty())
+                                        return false;
+                        }
+
+                        removedValues.clear();
+                        if (!aProblem->propagateConstraints(evidence, removedValues))
+                                return false;
+                }
+        }
+
+        return true;
+}
+
+/**
+ * Header line identifying the problem in the cache files
+ */
+static std::string sac_cache_header(const CSPProblem & aProblem, SACMode aMode) {
+        std::ostringstream out;
+        out << "SAC " << aMode << " " << aProblem.getMapping()->getNumVariables() << " "
+                << std::hex << aProblem.getContentHash();
+        return out.str();
+}
+
+bool sac_save_domains(const CSPProblem & aProblem, SACMode aMode, const char * aFileName) {
+        std::ofstream file(aFileName);
+        if (!file)
+                return false;
+
+        const ProblemMapping * mapping = aProblem.getMapping();
+
+        file << sac_cache_header(aProblem, aMode) << std::endl;
+        for (VarIdType varId = 0; varId < mapping->getNumVariables(); ++varId) {
+                const DomainView * domain = aProblem.getVariableById(varId)->getDomain();
+
+                file << mapping->getOriginalId(varId);
+                for (DomainView::const_iterator domIt = domain->begin(); domIt != domain->end(); ++domIt) {
+                        file << " " << mapping->getOriginalValue(varId, *domIt);
+                }
+                file << std::endl;
+        }
+
+        return file.good();
+}
+
+bool sac_load_domains(CSPProblem * aProblem, SACMode aMode, const char * aFileName) {
+        std::ifstream file(aFileName);
+        std::string line;
+
+        if (!std::getline(file, line) || line != sac_cache_header(*aProblem, aMode))
+                return false;
+
+        const ProblemMapping * mapping = aProblem->getMapping();
+
+        // Read everything first, so that a broken file does not change the domains
+        std::vector<Domain> domains(mapping->getNumVariables());
+        for (VarIdType varId = 0; varId < mapping->getNumVariables(); ++varId) {
+                if (!std::getline(file, line))
+                        return false;
+
+                std::vector<std::string> words;
+                tokenize(line, words);
+                if (words.empty() || parseArg<VarIdType>(words[0]) != mapping->getOriginalId(varId))
+                        return false;
+
+                for (size_t i = 1; i < words.size(); ++i) {
+                        // The domains in the file can only be smaller than the current ones
+                        VarType valueIndex = mapping->findValueIndex(varId, parseArg<VarType>(words[i]));
+                        if (valueIndex < 0 || !aProblem->getVariableById(varId)->getDomain()->count(valueIndex))
+                                return false;
+
+                        domains[varId].insert(valueIndex);
+                }
+        }
+
+        for (VarIdType varId = 0; varId < mapping->getNumVariables(); ++varId) {
+                Variable * var = aProblem->getVariableById(varId);
+                std::vector<VarType> values(var->getDomain()->begin(), var->getDomain()->end());
+
+                for (std::vector<VarType>::const_iterator valIt = values.begin(); valIt != values.end(); ++valIt) {
+                        if (domains[varId].find(*valIt) == domains[varId].end())
+                                var->eraseFromDomain(*valIt);
+                }
+        }
+
+        return true;
+}
+
+bool sac_preprocess(CSPProblem * aProblem, SACMode aMode, unsigned int aNumThreads, const std::string & aCacheFile) {
+        if (aMode == SAC_NONE)
+                return true;
+
+        if (!aCacheFile.empty() && sac_load_domains(aProblem, aMode, aCacheFile.c_str())) {
+                std::cout << "SAC domains loaded from " << aCacheFile << std::endl;
+        } else {
+                if (!singleton_arc_consistency(aProblem, aMode, aNumThreads))
+                        return false;
+
+                if (!aCacheFile.empty() && !sac_save_domains(*aProblem, aMode, aCacheFile.c_str()))
+                        std::cerr << "Could not save SAC domains to " << aCacheFile << std::endl;
+        }
+
+        for (VarIdType varId = 0; varId < aProblem->getVariables()->size(); ++varId) {
+                if (aProblem->getVariableById(varId)->getDomain()->empty())
+                        return false;
+        }
+
+        return true;
+}
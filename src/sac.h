@@ -0,0 +1,73 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SAC_H_
+#define SAC_H_
+
+#include <string>
+
+#include "csp.h"
+
+enum SACMode {
+        SAC_NONE,
+        SAC_FULL, // Every value of every domain is probed
+        SAC_BOUNDS // Only the minimum and the maximum of every domain are probed
+};
+
+/**
+ * Parses the mode from the command line ("none", "full" or "bounds"), returns false
+ * for an unknown mode
+ */
+bool parse_sac_mode(const std::string & aArg, SACMode & outMode);
+
+/**
+ * Singleton arc consistency preprocessing: every value of every variable (only the bounds
+ * for SAC_BOUNDS) is assigned and propagated, the values for which the propagation fails are
+ * removed from the domains of aProblem. The probes of one round run in aNumThreads threads,
+ * each on its own working copy of the problem; the rounds are repeated until nothing changes.
+ *
+ * Returns false if some domain became empty (the problem has no solution)
+ */
+bool singleton_arc_consistency(CSPProblem * aProblem, SACMode aMode, unsigned int aNumThreads);
+
+/**
+ * Saves the current domains of aProblem (in the original values) to a file, together with
+ * a header identifying the problem (by CSPProblem::getContentHash()) and the mode
+ */
+bool sac_save_domains(const CSPProblem & aProblem, SACMode aMode, const char * aFileName);
+
+/**
+ * Restricts the domains of aProblem to those saved by sac_save_domains. Returns false (and
+ * does not change anything) if the file does not exist or was saved for another problem or mode,
+ * or if it has a value which is not in the current domain.
+ */
+bool sac_load_domains(CSPProblem * aProblem, SACMode aMode, const char * aFileName);
+
+/**
+ * Runs the preprocessing selected on the command line. The pruned domains are read from
+ * aCacheFile if it matches the problem, otherwise they are computed and saved there
+ * (no caching if aCacheFile is empty).
+ *
+ * Returns false if the problem has no solution
+ */
+bool sac_preprocess(CSPProblem * aProblem, SACMode aMode, unsigned int aNumThreads, const std::string & aCacheFile);
+
+#endif // SAC_H_
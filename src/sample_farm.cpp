@@ -0,0 +1,181 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+
+#include "csp.h"
+#include "utils.h"
+#include "sample_farm.h"
+
+SampleFarm::SampleFarm(CSPSampler * aSampler, unsigned int aNumThreads, unsigned int aNumSamples, bool aOrdered,
+                double aDeadline):
+        mOwnsWorkers(true), mNumSamples(aNumSamples), mOrdered(aOrdered), mDeadline(aDeadline), mNextJob(0), mNumReturned(0),
+        mNumAbandoned(0), mNumRestarts(0), mStopped(false), mFailed(false) {
+        assert(aSampler);
+
+        pthread_mutex_init(&mMutex, 0);
+        pthread_cond_init(&mResultReady, 0);
+
+        if (aNumThreads == 0)
+                aNumThreads = 1;
+
+        // The workers are copied before any of them starts, the copies only read aSampler
+        for (unsigned int i = 0; i < aNumThreads; ++i) {
+                Worker worker;
+                worker.farm = this;
+                worker.sampler = aSampler->createWorker();
+
+                if (!worker.sampler) {
+                        assert(mWorkers.empty());
+                        worker.sampler = aSampler;
+                        mOwnsWorkers = false;
+                        mWorkers.push_back(worker);
+                        break;
+                }
+
+                mWorkers.push_back(worker);
+        }
+
+        // Only the thread reading the samples prints, the progress of the workers would split its lines
+        for (std::vector<Worker>::iterator workerIt = mWorkers.begin(); workerIt != mWorkers.end(); ++workerIt) {
+                workerIt->sampler->setQuiet(true);
+        }
+
+        for (std::vector<Worker>::iterator workerIt = mWorkers.begin(); workerIt != mWorkers.end(); ++workerIt) {
+                pthread_create(&workerIt->thread, 0, _runWorker, &*workerIt);
+        }
+}
+
+SampleFarm::~SampleFarm() {
+        pthread_mutex_lock(&mMutex);
+        mStopped = true;
+        pthread_mutex_unlock(&mMutex);
+
+        for (std::vector<Worker>::iterator workerIt = mWorkers.begin(); workerIt != mWorkers.end(); ++workerIt) {
+                pthread_join(workerIt->thread, 0);
+
+                if (mOwnsWorkers)
+                        delete workerIt->sampler;
+        }
+
+        pthread_cond_destroy(&mResultReady);
+        pthread_mutex_destroy(&mMutex);
+}
+
+void * SampleFarm::_runWorker(void * aWorker) {
+        Worker * worker = static_cast<Worker *>(aWorker);
+        SampleFarm * farm = worker->farm;
+
+        while (true) {
+                pthread_mutex_lock(&farm->mMutex);
+                if (farm->mDeadline > 0 && current_time() >= farm->mDeadline) {
+                        // Wake up the reader if it waits for a job which will not be started
+                        farm->mStopped = true;
+                        pthread_cond_broadcast(&farm->mResultReady);
+                }
+
+                if (farm->mStopped || farm->mNextJob >= farm->mNumSamples) {
+                        pthread_mutex_unlock(&farm->mMutex);
+                        break;
+                }
+                unsigned int job = farm->mNextJob++;
+                pthread_mutex_unlock(&farm->mMutex);
+
+                random_seed_thread(job);
+
+                Result result;
+                unsigned long numRestarts = worker->sampler->getNumRestarts();
+                result.found = worker->sampler->getSample(result.assignment);
+                result.abandoned = !result.found && worker->sampler->sampleAbandoned();
+                result.logWeight = result.found ? worker->sampler->getSampleLogWeight() : 0;
+                numRestarts = worker->sampler->getNumRestarts() - numRestarts;
+
+                pthread_mutex_lock(&farm->mMutex);
+                Result & stored = farm->mResults[job];
+                stored.found = result.found;
+                stored.abandoned = result.abandoned;
+                stored.logWeight = result.logWeight;
+                stored.assignment.swap(result.assignment);
+                farm->mNumRestarts += numRestarts;
+
+                if (!result.found && !result.abandoned)
+                        farm->mStopped = true;
+
+                pthread_cond_broadcast(&farm->mResultReady);
+                pthread_mutex_unlock(&farm->mMutex);
+        }
+
+        return 0;
+}
+
+bool SampleFarm::getSample(Assignment & outAssignment, bool & outFound, double & outLogWeight) {
+        pthread_mutex_lock(&mMutex);
+
+        std::map<unsigned int, Result>::iterator resultIt;
+        while (true) {
+                // All the started jobs have been returned when the farm stops
+                if (mFailed || mNumReturned == mNumSamples || (mStopped && mNumReturned == mNextJob)) {
+                        pthread_mutex_unlock(&mMutex);
+                        return false;
+                }
+
+                // The jobs are started in order, so the awaited one is always running or done
+                resultIt = mOrdered ? mResults.find(mNumReturned) : mResults.begin();
+                if (resultIt != mResults.end() && resultIt->second.abandoned) {
+                        mResults.erase(resultIt);
+                        ++mNumReturned;
+                        ++mNumAbandoned;
+                        continue;
+                } else if (resultIt != mResults.end()) {
+                        break;
+                }
+
+                pthread_cond_wait(&mResultReady, &mMutex);
+        }
+
+        outFound = resultIt->second.found;
+        outLogWeight = resultIt->second.logWeight;
+        outAssignment.swap(resultIt->second.assignment);
+        mResults.erase(resultIt);
+
+        ++mNumReturned;
+        if (!outFound)
+                mFailed = true;
+
+        pthread_mutex_unlock(&mMutex);
+        return true;
+}
+
+unsigned int SampleFarm::getNumAbandoned() {
+        pthread_mutex_lock(&mMutex);
+        unsigned int numAbandoned = mNumAbandoned;
+        pthread_mutex_unlock(&mMutex);
+
+        return numAbandoned;
+}
+
+unsigned long SampleFarm::getNumRestarts() {
+        pthread_mutex_lock(&mMutex);
+        unsigned long numRestarts = mNumRestarts;
+        pthread_mutex_unlock(&mMutex);
+
+        return numRestarts;
+}
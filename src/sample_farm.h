@@ -0,0 +1,119 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SAMPLE_FARM_H_
+#define SAMPLE_FARM_H_
+
+#include <pthread.h>
+
+#include <map>
+#include <vector>
+
+#include "csp.h"
+
+/**
+ * Generates independent samples in several threads. Every worker is a copy of the
+ * sampler (CSPSampler::createWorker) with its own search state and join graph; the
+ * workers take the jobs from a shared counter. Every job seeds the random stream of
+ * its thread by its index, so a job gives the same sample whichever worker runs it.
+ */
+class SampleFarm {
+public:
+        /**
+         * Starts aNumThreads workers generating aNumSamples samples of aSampler. With aOrdered
+         * the samples are returned in the order of the jobs, otherwise as they are finished.
+         * No job is started after aDeadline (as current_time(), 0 for no deadline). A sampler
+         * which can not be copied samples alone in one thread.
+         */
+        SampleFarm(CSPSampler * aSampler, unsigned int aNumThreads, unsigned int aNumSamples, bool aOrdered,
+                        double aDeadline);
+
+        /**
+         * Stops the workers (the jobs which have not been started are dropped)
+         */
+        ~SampleFarm();
+
+        /**
+         * Waits for the next sample, returns false when there are no more samples.
+         * outFound is false if no solution was found (the farm stops then). The
+         * abandoned samples (CSPSampler::sampleAbandoned) are skipped. outLogWeight is
+         * the log of the importance weight of the sample (CSPSampler::getSampleLogWeight).
+         */
+        bool getSample(Assignment & outAssignment, bool & outFound, double & outLogWeight);
+
+        unsigned int getNumThreads() const {
+                return mWorkers.size();
+        };
+
+        unsigned int getNumAbandoned();
+
+        /**
+         * The restarts of the samples the workers have finished
+         */
+        unsigned long getNumRestarts();
+private:
+        SampleFarm(const SampleFarm &);
+        SampleFarm & operator=(const SampleFarm &);
+
+        struct Worker {
+                SampleFarm * farm;
+                CSPSampler * sampler;
+                pthread_t thread;
+        };
+
+        struct Result {
+                bool found;
+                bool abandoned;
+                double logWeight;
+                Assignment assignment;
+        };
+
+        static void * _runWorker(void * aWorker);
+
+        std::vector<Worker> mWorkers;
+
+        // False if the workers only borrow the original sampler
+        bool mOwnsWorkers;
+
+        unsigned int mNumSamples;
+        bool mOrdered;
+        double mDeadline;
+
+        // All the following members are guarded by mMutex
+        pthread_mutex_t mMutex;
+        pthread_cond_t mResultReady;
+
+        unsigned int mNextJob;
+        unsigned int mNumReturned;
+        unsigned int mNumAbandoned;
+        unsigned long mNumRestarts;
+
+        // No more jobs are started (a sample was not found, the deadline has passed or the farm is being destroyed)
+        bool mStopped;
+
+        // The missing sample has been returned
+        bool mFailed;
+
+        // Finished samples which have not been returned yet, by job
+        std::map<unsigned int, Result> mResults;
+};
+
+#endif // SAMPLE_FARM_H_
@@ -13,6 +13,11 @@ typedef std::set<VarType> Domain;
 
 typedef std::map<VarIdType, VarType> Assignment;
 
+/**
+ * Complete assignment stored as a vector indexed by variable id
+ */
+typedef std::vector<VarType> FlatAssignment;
+
 typedef std::set<VarIdType> Scope;
 
 typedef std::vector<Scope> Bucket;
@@ -20,6 +20,8 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
+#include <sys/time.h>
 #include <iostream>
 
 #include "csp.h"
@@ -27,12 +29,56 @@
 
 const double EPSILON = 1.0e-25;
 
-VarType random_select(const Domain *d) {
+// State of rand_r for the threads with their own stream
+static pthread_key_t g_randomKey;
+static pthread_once_t g_randomKeyOnce = PTHREAD_ONCE_INIT;
+
+static void random_free_state(void * aState) {
+        delete static_cast<unsigned int *>(aState);
+}
+
+static void random_create_key() {
+        pthread_key_create(&g_randomKey, random_free_state);
+}
+
+int random_int() {
+        pthread_once(&g_randomKeyOnce, random_create_key);
+
+        unsigned int * state = static_cast<unsigned int *>(pthread_getspecific(g_randomKey));
+        return state ? rand_r(state) : rand();
+}
+
+void random_seed_thread(unsigned int aSeed) {
+        pthread_once(&g_randomKeyOnce, random_create_key);
+
+        // Finaliser of MurmurHash3, rand_r would start nearby seeds almost in step
+        aSeed ^= aSeed >> 16;
+        aSeed *= 0x85ebca6bU;
+        aSeed ^= aSeed >> 13;
+        aSeed *= 0xc2b2ae35U;
+        aSeed ^= aSeed >> 16;
+
+        unsigned int * state = static_cast<unsigned int *>(pthread_getspecific(g_randomKey));
+        if (!state) {
+                state = new unsigned int;
+                pthread_setspecific(g_randomKey, state);
+        }
+        *state = aSeed;
+}
+
+double current_time() {
+        struct timeval now;
+        gettimeofday(&now, 0);
+
+        return now.tv_sec + now.tv_usec / 1e6;
+}
+
+VarType random_select(const DomainView *d) {
         assert(d);
 
-        unsigned int selectedIndex = (unsigned int)(d->size() * (rand() / (RAND_MAX + 1.0)));
+        unsigned int selectedIndex = (unsigned int)(d->size() * (random_int() / (RAND_MAX + 1.0)));
         unsigned int domainCounter = 0;
-        for (Domain::const_iterator domIt = d->begin(); domIt != d->end(); ++domIt, ++domainCounter) {
+        for (DomainView::const_iterator domIt = d->begin(); domIt != d->end(); ++domIt, ++domainCounter) {
                 if (selectedIndex == domainCounter)
                         return (*domIt);
         }
@@ -40,13 +86,13 @@ VarType random_select(const Domain *d) {
         assert(false);
 }
 
-VarType random_select(const Domain *aDomain, VarType aLowerBound, VarType aUpperBound) {
+VarType random_select(const DomainView *aDomain, VarType aLowerBound, VarType aUpperBound) {
         assert(aDomain);
-        Domain::const_iterator aBegin = aDomain->lower_bound(aLowerBound);
-        Domain::const_iterator aEnd = aDomain->lower_bound(aUpperBound);
+        DomainView::const_iterator aBegin = aDomain->lower_bound(aLowerBound);
+        DomainView::const_iterator aEnd = aDomain->lower_bound(aUpperBound);
 
         unsigned int domainSize = 0;
-        for (Domain::const_iterator domIt = aBegin; domIt != aEnd; ++domIt) {
+        for (DomainView::const_iterator domIt = aBegin; domIt != aEnd; ++domIt) {
                 ++domainSize;
         }
         
@@ -57,9 +103,9 @@ VarType random_select(const Domain *aDomain, VarType aLowerBound, VarType aUpper
         std::cout << "\tUpper bound " << aUpperBound << ", " << ((aEnd != aDomain->end()) ? *aEnd : -1) << std::endl;
         */
 
-        unsigned int selectedIndex = (unsigned int)(domainSize * (rand() / (RAND_MAX + 1.0)));
+        unsigned int selectedIndex = (unsigned int)(domainSize * (random_int() / (RAND_MAX + 1.0)));
         unsigned int domainCounter = 0;
-        for (Domain::const_iterator domIt = aBegin; domIt != aEnd; ++domIt, ++domainCounter) {
+        for (DomainView::const_iterator domIt = aBegin; domIt != aEnd; ++domIt, ++domainCounter) {
                 if (selectedIndex == domainCounter)
                         return (*domIt);
         }
@@ -22,9 +22,27 @@
 #ifndef UTILS_H_
 #define UTILS_H_
 
-VarType random_select(const Domain *d);
+/**
+ * Random integer in 0 .. RAND_MAX. It comes from rand() unless the calling thread
+ * has its own stream (see random_seed_thread), so that parallel samplers neither
+ * share nor serialise a single sequence.
+ */
+int random_int();
+
+/**
+ * Gives the calling thread its own random stream starting from aSeed (the seed is
+ * scrambled, so consecutive seeds give unrelated streams)
+ */
+void random_seed_thread(unsigned int aSeed);
 
-VarType random_select(const Domain *aDomain, VarType aLowerBound, VarType aUpperBound);
+VarType random_select(const DomainView *d);
+
+VarType random_select(const DomainView *aDomain, VarType aLowerBound, VarType aUpperBound);
+
+/**
+ * Wall-clock time in seconds (from an arbitrary origin)
+ */
+double current_time();
 
 void tokenize(const std::string& str, std::vector<std::string>& tokens, const std::string& delimiters = " ");
 
@@ -36,6 +54,22 @@ template<class T> T parseArg(const std::string & aArg) {
         return result;
 }
 
+/**
+ * Reorders the vector so that its i-th element is the aOrder[i]-th element of
+ * the original vector
+ */
+template<class T> void permute_vector(std::vector<T> & aVector, const std::vector<size_t> & aOrder) {
+        assert(aVector.size() == aOrder.size());
+
+        std::vector<T> result;
+        result.reserve(aVector.size());
+        for (std::vector<size_t>::const_iterator orderIt = aOrder.begin(); orderIt != aOrder.end(); ++orderIt) {
+                result.push_back(aVector[*orderIt]);
+        }
+
+        aVector.swap(result);
+}
+
 extern const double EPSILON;
 
 int min(int x, int y);
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+
+#include "graph.h"
+#include "variable_ordering.h"
+
+bool parse_variable_ordering(const std::string & aArg, VariableOrdering & outOrdering) {
+        if (aArg == "lex") {
+                outOrdering = ORDERING_LEX;
+        } else if (aArg == "mrv") {
+                outOrdering = ORDERING_MRV;
+        } else if (aArg == "domwdeg") {
+                outOrdering = ORDERING_DOM_WDEG;
+        } else if (aArg == "elim") {
+                outOrdering = ORDERING_ELIMINATION;
+        } else {
+                return false;
+        }
+
+        return true;
+}
+
+VariableSelector::VariableSelector(CSPProblem * aProblem, VariableOrdering aOrdering):
+        mOrdering(aOrdering) {
+
+        VarIdType numVariables = aProblem->getVariables()->size();
+
+        if (mOrdering == ORDERING_ELIMINATION) {
+                // The join graph eliminates the variables from the end of the ordering
+                Graph * g = Graph::createCSPPrimalGraph(aProblem);
+                mOrder = g->minInducedWidthOrdering();
+                delete g;
+        } else {
+                for (VarIdType varId = 0; varId < numVariables; ++varId) {
+                        mOrder.push_back(varId);
+                }
+        }
+}
+
+Variable * VariableSelector::selectVariable(CSPProblem * aProblem, const Assignment & aEvidence, VarIdType aDepth) const {
+        if (mOrdering == ORDERING_LEX || mOrdering == ORDERING_ELIMINATION) {
+                assert(aEvidence.find(mOrder[aDepth]) == aEvidence.end());
+                return aProblem->getVariableById(mOrder[aDepth]);
+        }
+
+        Variable * selected = 0;
+        size_t selectedSize = 0;
+        unsigned int selectedDegree = 0;
+
+        for (VarIdType varId = 0; varId < aProblem->getVariables()->size(); ++varId) {
+                if (aEvidence.find(varId) != aEvidence.end())
+                        continue;
+
+                Variable * var = aProblem->getVariableById(varId);
+                size_t size = var->getDomain()->size();
+
+                if (mOrdering == ORDERING_MRV) {
+                        if (!selected || size < selectedSize) {
+                                selected = var;
+                                selectedSize = size;
+                        }
+                } else {
+                        // size / degree < selectedSize / selectedDegree, a variable without
+                        // unassigned neighbours comes last
+                        unsigned int degree = _weightedDegree(aProblem, aEvidence, varId);
+                        if (!selected || (degree > 0 && (selectedDegree == 0 || size * selectedDegree < selectedSize * degree))) {
+                                selected = var;
+                                selectedSize = size;
+                                selectedDegree = degree;
+                        }
+                }
+        }
+
+        assert(selected);
+        return selected;
+}
+
+unsigned int VariableSelector::_weightedDegree(const CSPProblem * aProblem, const Assignment & aEvidence,
+                VarIdType aVarId) const {
+
+        unsigned int degree = 0;
+
+        for (size_t arc = aProblem->getArcsBegin(aVarId); arc != aProblem->getArcsEnd(aVarId); ++arc) {
+                size_t c = aProblem->getArcConstraint(arc);
+
+                for (const VarIdType * scIt = aProblem->getScopeBegin(c); scIt != aProblem->getScopeEnd(c); ++scIt) {
+                        if (*scIt != aVarId && aEvidence.find(*scIt) == aEvidence.end()) {
+                                degree += aProblem->getConstraintWeight(c);
+                                break;
+                        }
+                }
+        }
+
+        return degree;
+}
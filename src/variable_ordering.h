@@ -0,0 +1,69 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef VARIABLE_ORDERING_H_
+#define VARIABLE_ORDERING_H_
+
+#include <string>
+#include <vector>
+
+#include "csp.h"
+
+enum VariableOrdering {
+        ORDERING_LEX, // By the variable ids
+        ORDERING_MRV, // The smallest domain after the propagation first
+        ORDERING_DOM_WDEG, // The smallest ratio of the domain size and the weighted degree first
+        ORDERING_ELIMINATION // Reverse of the min-induced-width elimination order of the join graph
+};
+
+/**
+ * Parses the ordering from the command line ("lex", "mrv", "domwdeg" or "elim"), returns
+ * false for an unknown ordering
+ */
+bool parse_variable_ordering(const std::string & aArg, VariableOrdering & outOrdering);
+
+/**
+ * Selects the variable which the samplers assign next. The weighted degree of a variable
+ * is the sum of the weights (CSPProblem::getConstraintWeight) of its constraints with
+ * another unassigned variable; the ties are broken by the variable ids.
+ */
+class VariableSelector {
+public:
+        VariableSelector(CSPProblem * aProblem, VariableOrdering aOrdering);
+
+        /**
+         * The next variable to assign after the aDepth variables in aEvidence
+         */
+        Variable * selectVariable(CSPProblem * aProblem, const Assignment & aEvidence, VarIdType aDepth) const;
+
+        VariableOrdering getOrdering() const {
+                return mOrdering;
+        };
+private:
+        unsigned int _weightedDegree(const CSPProblem * aProblem, const Assignment & aEvidence, VarIdType aVarId) const;
+
+        VariableOrdering mOrdering;
+
+        // The static order of ORDERING_LEX and ORDERING_ELIMINATION
+        std::vector<VarIdType> mOrder;
+};
+
+#endif // VARIABLE_ORDERING_H_
@@ -19,17 +19,18 @@
  *
  */
 
+#include <algorithm>
 #include <deque>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <limits>
 #include "math.h"
 
 #include "csp.h"
 #include "wcsp.h"
 
 const double EXP_ROOT = 2.0;
-double EXP_K = 0.001;
 
 double WCSPConstraint::operator()(Assignment &a) const {
         std::vector<VarType> scopeAssignment;
@@ -49,7 +50,7 @@ double WCSPConstraint::operator()(Assignment &a) const {
         if (weight >= mHardConstraintWeight) {
                 return 0;
         } else {
-                return exp(log(EXP_ROOT) * EXP_K * (-(double)weight));
+                return exp(log(EXP_ROOT) * mKoef * (-(double)weight));
         }
 }
 
@@ -85,6 +86,288 @@ bool WCSPConstraint::hasSupport(VarIdType aVarId, VarType aValue, const CSPProbl
 }
 
 
+void WCSPConstraint::remap(const ProblemMapping & aMapping) {
+        Scope scope;
+        for (Scope::iterator scIt = mScope.begin(); scIt != mScope.end(); ++scIt) {
+                scope.insert(aMapping.getIndex(*scIt));
+        }
+        mScope = scope;
+
+        _buildTable(aMapping);
+
+        Constraint::remap(aMapping);
+}
+
+void WCSPConstraint::_buildTable(const ProblemMapping & aMapping) {
+        const unsigned int wordBits = DomainArena::WORD_BITS;
+
+        mNegativeTable = (mDefaultWeight < mHardConstraintWeight);
+
+        std::vector<const std::vector<VarType> *> tuples;
+        if (mNegativeTable) {
+                for (std::set<std::vector<VarType> >::const_iterator tupleIt = mDisallowedTuples.begin();
+                                tupleIt != mDisallowedTuples.end(); ++tupleIt) {
+                        tuples.push_back(&*tupleIt);
+                }
+        } else {
+                for (std::map<std::vector<VarType>, unsigned long>::const_iterator tupleIt = mDifferentWeightTuples.begin();
+                                tupleIt != mDifferentWeightTuples.end(); ++tupleIt) {
+                        if (tupleIt->second < mHardConstraintWeight)
+                                tuples.push_back(&tupleIt->first);
+                }
+        }
+
+        mTableOffsets.clear();
+        size_t numValues = 0;
+        for (Scope::const_iterator scIt = mScope.begin(); scIt != mScope.end(); ++scIt) {
+                mTableOffsets.push_back(numValues);
+                numValues += aMapping.getDomainSize(*scIt);
+        }
+        mTableOffsets.push_back(numValues);
+
+        mTableWords = tuples.size() / wordBits + 1;
+        mTableSupports.assign(numValues * mTableWords, 0UL);
+
+        for (size_t t = 0; t < tuples.size(); ++t) {
+                const std::vector<VarType> & tuple = *tuples[t];
+                assert(tuple.size() == mScope.size());
+
+                for (size_t i = 0; i < tuple.size(); ++i) {
+                        // Tuples with values outside of the domains never become valid
+                        if (tuple[i] < 0 || (size_t)tuple[i] >= mTableOffsets[i + 1] - mTableOffsets[i])
+                                continue;
+
+                        mTableSupports[(mTableOffsets[i] + tuple[i]) * mTableWords + t / wordBits] |= 1UL << (t % wordBits);
+                }
+        }
+}
+
+void WCSPConstraint::filterDomain(VarIdType aVarId, const CSPProblem & aProblem, const Assignment & aEvidence,
+                std::vector<VarType> & outUnsupported) const {
+
+        const DomainView * domain = aProblem.getVariableById(aVarId)->getDomain();
+
+        Assignment::const_iterator evidenceIt = aEvidence.find(aVarId);
+        if (evidenceIt != aEvidence.end()) {
+                for (DomainView::const_iterator domIt = domain->begin(); domIt != domain->end(); ++domIt) {
+                        if (*domIt != evidenceIt->second)
+                                outUnsupported.push_back(*domIt);
+                }
+                return;
+        }
+
+        // Tuples valid in the domains of the other variables, only the words which are not
+        // zero yet are kept in nonZero (sparse bit set)
+        std::vector<unsigned long> valid(mTableWords, ~0UL);
+        std::vector<size_t> nonZero(mTableWords);
+        for (size_t w = 0; w < mTableWords; ++w)
+                nonZero[w] = w;
+
+        std::vector<unsigned long> varTuples(mTableWords);
+        size_t varPosition = 0;
+        double otherCombinations = 1.0;
+
+        size_t i = 0;
+        for (Scope::const_iterator scIt = mScope.begin(); scIt != mScope.end(); ++scIt, ++i) {
+                if (*scIt == aVarId) {
+                        varPosition = i;
+                        continue;
+                }
+
+                // Tuples of all the values of the variable (only the evidence if it is assigned)
+                for (std::vector<size_t>::const_iterator wIt = nonZero.begin(); wIt != nonZero.end(); ++wIt)
+                        varTuples[*wIt] = 0UL;
+
+                const DomainView * otherDomain = aProblem.getVariableById(*scIt)->getDomain();
+                Assignment::const_iterator otherEvidenceIt = aEvidence.find(*scIt);
+
+                if (otherEvidenceIt != aEvidence.end()) {
+                        const unsigned long * supports = &mTableSupports[(mTableOffsets[i] + otherEvidenceIt->second) * mTableWords];
+                        for (std::vector<size_t>::const_iterator wIt = nonZero.begin(); wIt != nonZero.end(); ++wIt)
+                                varTuples[*wIt] = supports[*wIt];
+                } else {
+                        otherCombinations *= otherDomain->size();
+                        for (DomainView::const_iterator domIt = otherDomain->begin(); domIt != otherDomain->end(); ++domIt) {
+                                const unsigned long * supports = &mTableSupports[(mTableOffsets[i] + *domIt) * mTableWords];
+                                for (std::vector<size_t>::const_iterator wIt = nonZero.begin(); wIt != nonZero.end(); ++wIt)
+                                        varTuples[*wIt] |= supports[*wIt];
+                        }
+                }
+
+                size_t numNonZero = 0;
+                for (size_t k = 0; k < nonZero.size(); ++k) {
+                        size_t w = nonZero[k];
+                        valid[w] &= varTuples[w];
+                        if (valid[w])
+                                nonZero[numNonZero++] = w;
+                }
+                nonZero.resize(numNonZero);
+        }
+
+        for (DomainView::const_iterator domIt = domain->begin(); domIt != domain->end(); ++domIt) {
+                const unsigned long * supports = &mTableSupports[(mTableOffsets[varPosition] + *domIt) * mTableWords];
+
+                if (mNegativeTable) {
+                        // The value is supported unless all the combinations of the other values are disallowed
+                        double disallowed = 0.0;
+                        for (std::vector<size_t>::const_iterator wIt = nonZero.begin(); wIt != nonZero.end(); ++wIt)
+                                disallowed += __builtin_popcountl(valid[*wIt] & supports[*wIt]);
+
+                        if (disallowed >= otherCombinations)
+                                outUnsupported.push_back(*domIt);
+                } else {
+                        bool supported = false;
+                        for (std::vector<size_t>::const_iterator wIt = nonZero.begin(); !supported && wIt != nonZero.end(); ++wIt)
+                                supported = (valid[*wIt] & supports[*wIt]) != 0;
+
+                        if (!supported)
+                                outUnsupported.push_back(*domIt);
+                }
+        }
+}
+
+void WCSPConstraint::addToStore(ConstraintStore & aStore) const {
+        assert(mMapping);
+
+        if (!aStore.getBlock<WCSPBlock>()->addConstraint(mScope, mDifferentWeightTuples, mDefaultWeight,
+                                mHardConstraintWeight, mKoef, *mMapping)) {
+                Constraint::addToStore(aStore);
+        }
+}
+
+bool WCSPBlock::addConstraint(const Scope & aScope, const std::map<std::vector<VarType>, unsigned long> & aTupleWeights,
+                unsigned long aDefaultWeight, unsigned long aHardConstraintWeight, double aKoef,
+                const ProblemMapping & aMapping) {
+
+        if (size() > 0 && aKoef != mKoef)
+                return false;
+
+        // Check that all the tuples of the constraint fit into a code
+        unsigned long tupleCount = 1;
+        for (Scope::const_iterator scIt = aScope.begin(); scIt != aScope.end(); ++scIt) {
+                unsigned long radix = aMapping.getDomainSize(*scIt);
+                if (radix > 0 && tupleCount > std::numeric_limits<unsigned long>::max() / radix)
+                        return false;
+                tupleCount *= radix;
+        }
+
+        if (mScopeOffsets.empty()) {
+                mScopeOffsets.push_back(0);
+                mTupleOffsets.push_back(0);
+        }
+
+        for (Scope::const_iterator scIt = aScope.begin(); scIt != aScope.end(); ++scIt) {
+                mScopeVars.push_back(*scIt);
+                mRadices.push_back(aMapping.getDomainSize(*scIt));
+        }
+        mScopeOffsets.push_back(mScopeVars.size());
+
+        std::vector<std::pair<unsigned long, unsigned long> > tuples;
+        for (std::map<std::vector<VarType>, unsigned long>::const_iterator tupleIt = aTupleWeights.begin();
+                        tupleIt != aTupleWeights.end(); ++tupleIt) {
+                assert(tupleIt->first.size() == aScope.size());
+
+                unsigned long code = 0;
+                bool valid = true;
+                for (size_t i = 0; i < tupleIt->first.size(); ++i) {
+                        unsigned long radix = mRadices[mScopeOffsets[size()] + i];
+                        VarType value = tupleIt->first[i];
+                        if (value < 0 || (unsigned long)value >= radix) {
+                                valid = false; // The tuple can never be assigned
+                                break;
+                        }
+                        code = code * radix + value;
+                }
+
+                if (valid)
+                        tuples.push_back(std::make_pair(code, tupleIt->second));
+        }
+        std::sort(tuples.begin(), tuples.end());
+
+        for (size_t i = 0; i < tuples.size(); ++i) {
+                mTupleCodes.push_back(tuples[i].first);
+                mTupleWeights.push_back(tuples[i].second);
+        }
+        mTupleOffsets.push_back(mTupleCodes.size());
+
+        mDefaultWeight.push_back(aDefaultWeight);
+        mHardConstraintWeight.push_back(aHardConstraintWeight);
+        mKoef = aKoef;
+
+        return true;
+}
+
+double WCSPBlock::evalAssignment(const VarType * aValues) const {
+        // The product of exp(-c * w_i) is computed as exp(-c * sum w_i)
+        double totalWeight;
+        if (!_totalWeight(aValues, totalWeight))
+                return 0;
+
+        return exp(log(EXP_ROOT) * mKoef * (-totalWeight));
+}
+
+double WCSPBlock::evalLogAssignment(const VarType * aValues) const {
+        double totalWeight;
+        if (!_totalWeight(aValues, totalWeight))
+                return -HUGE_VAL;
+
+        return log(EXP_ROOT) * mKoef * (-totalWeight);
+}
+
+bool WCSPBlock::_totalWeight(const VarType * aValues, double & outTotalWeight) const {
+        outTotalWeight = 0.0;
+
+        for (size_t i = 0; i < mDefaultWeight.size(); ++i) {
+                unsigned long code = 0;
+                for (size_t j = mScopeOffsets[i]; j < mScopeOffsets[i + 1]; ++j) {
+                        code = code * mRadices[j] + aValues[mScopeVars[j]];
+                }
+
+                std::vector<unsigned long>::const_iterator codesBegin = mTupleCodes.begin() + mTupleOffsets[i];
+                std::vector<unsigned long>::const_iterator codesEnd = mTupleCodes.begin() + mTupleOffsets[i + 1];
+                std::vector<unsigned long>::const_iterator codeIt = std::lower_bound(codesBegin, codesEnd, code);
+
+                unsigned long weight = mDefaultWeight[i];
+                if (codeIt != codesEnd && *codeIt == code)
+                        weight = mTupleWeights[codeIt - mTupleCodes.begin()];
+
+                if (weight >= mHardConstraintWeight[i])
+                        return false;
+
+                outTotalWeight += weight;
+        }
+
+        return true;
+}
+
+bool WCSPConstraint::isCompatible(VarIdType aVarId, VarType aValue, VarType aOtherValue) const {
+        assert(mScope.size() == 2 && mScope.count(aVarId));
+
+        std::vector<VarType> tuple(2);
+        if (aVarId == *mScope.begin()) {
+                tuple[0] = aValue;
+                tuple[1] = aOtherValue;
+        } else {
+                tuple[0] = aOtherValue;
+                tuple[1] = aValue;
+        }
+
+        return _isAllowed(tuple);
+}
+
+bool WCSPConstraint::_isAllowed(const std::vector<VarType> & aTuple) const {
+        // An assignment is allowed if it is not in mDisallowedTuples and the default value is not hard-constraint
+        if (mDisallowedTuples.find(aTuple) == mDisallowedTuples.end()) {
+                if (mDifferentWeightTuples.find(aTuple) == mDifferentWeightTuples.end()) {
+                        return (mDefaultWeight < mHardConstraintWeight);
+                } else {
+                        return true;
+                }
+        } else {
+                return false;
+        }
+}
+
 bool WCSPConstraint::_hasSupportInternal(Assignment &aEvidence, const CSPProblem &aProblem, std::deque<VarIdType> & aVarsToAssign) {
         if (aVarsToAssign.empty()) {
                 std::vector<VarType> varAssignment;
@@ -93,22 +376,13 @@ bool WCSPConstraint::_hasSupportInternal(Assignment &aEvidence, const CSPProblem
                         varAssignment.push_back(aEvidence[*scIt]);
                 }
 
-                // Now an assignment is allowed if it is not in mDisallowedTuples and the default value is not hard-constraint
-                if (mDisallowedTuples.find(varAssignment) == mDisallowedTuples.end()) {
-                        if (mDifferentWeightTuples.find(varAssignment) == mDifferentWeightTuples.end()) {
-                                return (mDefaultWeight < mHardConstraintWeight);
-                        } else {
-                                return true;
-                        }
-                } else {
-                        return false;
-                }
+                return _isAllowed(varAssignment);
         } else {
                 VarIdType varId = aVarsToAssign.front();
                 aVarsToAssign.pop_front();
-                const Domain * d = aProblem.getVariableById(varId)->getDomain();
+                const DomainView * d = aProblem.getVariableById(varId)->getDomain();
 
-                for (Domain::const_iterator domIt = d->begin(); domIt != d->end(); ++domIt) {
+                for (DomainView::const_iterator domIt = d->begin(); domIt != d->end(); ++domIt) {
                         aEvidence[varId] = *domIt;
 
                         if (_hasSupportInternal(aEvidence, aProblem, aVarsToAssign))
@@ -123,7 +397,7 @@ bool WCSPConstraint::_hasSupportInternal(Assignment &aEvidence, const CSPProblem
         }
 }
 
-CSPProblem * load_wcsp_problem(const char * fileName) {
+CSPProblem * load_wcsp_problem(const char * fileName, double aKoef) {
         std::ifstream file(fileName);
         std::string line;
 
@@ -142,7 +416,8 @@ CSPProblem * load_wcsp_problem(const char * fileName) {
                 return NULL;
         }
 
-        VariableMap * variables = new VariableMap();
+        VariableArray * variables = new VariableArray();
+        ProblemMapping * mapping = new ProblemMapping();
 
         if (std::getline(file, line)) {
                 std::istringstream lineStream(line);
@@ -151,7 +426,13 @@ CSPProblem * load_wcsp_problem(const char * fileName) {
 
                 while (lineStream >> domainSize) {
                         // Create a new variable with domain of <0, domainSize - 1>
-                        (*variables)[varId] = new Variable(varId, 0, domainSize - 1);
+                        Domain domain;
+                        for (VarType value = 0; value < (VarType)domainSize; ++value) {
+                                domain.insert(value);
+                        }
+
+                        variables->addVariable(domainSize);
+                        mapping->addVariable(varId, domain);
                         ++varId;
                 }
         } else {
@@ -174,7 +455,7 @@ CSPProblem * load_wcsp_problem(const char * fileName) {
                 unsigned int defaultWeight = parseArg<unsigned int>(words[words.size() - 2]);
                 unsigned int numDifferentTuples = parseArg<unsigned int>(words[words.size() - 1]);
 
-                WCSPConstraint * ctr = new WCSPConstraint(scope, defaultWeight, hardConstraintWeight);
+                WCSPConstraint * ctr = new WCSPConstraint(scope, defaultWeight, hardConstraintWeight, aKoef);
 
                 for (unsigned int i = 0; i < numDifferentTuples; ++i) {
                         if (std::getline(file, line)) {
@@ -196,6 +477,8 @@ CSPProblem * load_wcsp_problem(const char * fileName) {
                 constraints->push_back(ctr);
         }
 
-        return new CSPProblem(variables, constraints);
+        remap_constraints(constraints, *mapping);
+
+        return new CSPProblem(variables, constraints, mapping);
 }
 
@@ -29,9 +29,13 @@
 
 class WCSPConstraint: public Constraint {
 public:
-        WCSPConstraint(const Scope & aScope, unsigned long aDefaultWeight, unsigned long aHardConstraintWeight):
-                mScope(aScope), mDefaultWeight(aDefaultWeight), mMaxTupleWeight(aDefaultWeight),
-                mHardConstraintWeight(aHardConstraintWeight) {};
+        /**
+         * The value of a tuple with the weight w is 2^(-aKoef * w)
+         */
+        WCSPConstraint(const Scope & aScope, unsigned long aDefaultWeight, unsigned long aHardConstraintWeight,
+                        double aKoef):
+                mTableWords(0), mNegativeTable(false), mScope(aScope), mDefaultWeight(aDefaultWeight),
+                mMaxTupleWeight(aDefaultWeight), mHardConstraintWeight(aHardConstraintWeight), mKoef(aKoef) {};
 
         virtual double operator()(Assignment &a) const;
 
@@ -39,8 +43,47 @@ public:
 
         virtual bool isSoft() const;
 
+        /**
+         * The tuples with a hard weight evaluate to 0
+         */
+        virtual bool canBeZero() const {
+                return !isSoft();
+        };
+
         virtual bool hasSupport(VarIdType aVarId, VarType aValue, const CSPProblem &aProblem, const Assignment &aEvidence);
 
+        virtual bool isHardBinary() const {
+                return !isSoft() && mScope.size() == 2;
+        };
+
+        virtual bool isCompatible(VarIdType aVarId, VarType aValue, VarType aOtherValue) const;
+
+        /**
+         * Hard constraints of other arities than two are filtered with the tuple table
+         */
+        virtual bool revisesDomains() const {
+                return !isSoft() && mScope.size() != 2;
+        };
+
+        /**
+         * Compact-Table filtering: the tuples still valid in the other domains are
+         * intersected with the tuples of each value of aVarId
+         */
+        virtual void filterDomain(VarIdType aVarId, const CSPProblem & aProblem, const Assignment & aEvidence,
+                        std::vector<VarType> & outUnsupported) const;
+
+        virtual unsigned int getPropagationPriority() const {
+                return revisesDomains() ? PROPAGATION_PRIORITY_TABLE : PROPAGATION_PRIORITY_CHEAP;
+        };
+
+        /**
+         * WCSP values are already numbered 0..d-1, so only the scope is translated
+         * (and the tuple table for the filtering is built)
+         */
+        virtual void remap(const ProblemMapping & aMapping);
+
+        virtual void addToStore(ConstraintStore & aStore) const;
+
         void addDifferentWeightTuple(std::vector<VarType> aTuple, unsigned long aWeight) {
                 mDifferentWeightTuples[aTuple] = aWeight;
                 mMaxTupleWeight = max(mMaxTupleWeight, aWeight);
@@ -50,19 +93,94 @@ public:
                 }
         };
 private:
+        /**
+         * Checks whether a tuple (in the order of the scope) is allowed by the hard constraint
+         */
+        bool _isAllowed(const std::vector<VarType> & aTuple) const;
+
         bool _hasSupportInternal(Assignment &aEvidence, const CSPProblem &aProblem,
                         std::deque<VarIdType> & aVarsToAssign);
 
+        /**
+         * Builds the bit sets of the tuple table from the tuples and the domain sizes
+         */
+        void _buildTable(const ProblemMapping & aMapping);
+
+        /**
+         * Bit sets of the tuples containing a value: the tuples of the value v of the i-th
+         * variable of the scope are the words mTableSupports[(mTableOffsets[i] + v) * mTableWords ..].
+         * The table holds the allowed tuples if the default weight is hard, the disallowed
+         * tuples otherwise (mNegativeTable).
+         */
+        std::vector<size_t> mTableOffsets;
+        std::vector<unsigned long> mTableSupports;
+        size_t mTableWords;
+        bool mNegativeTable;
+
        Scope mScope; 
        std::map<std::vector<VarType>, unsigned long> mDifferentWeightTuples;
        std::set<std::vector<VarType> > mDisallowedTuples;
        unsigned long mDefaultWeight;
        unsigned long mMaxTupleWeight;
        unsigned long mHardConstraintWeight;
+       double mKoef;
 };
 
-CSPProblem * load_wcsp_problem(const char * filename);
+/**
+ * All the WCSP constraints of a problem. Tuples of each constraint are encoded as
+ * mixed radix numbers (the scope variables being the digits) and the tuples with
+ * non-default weights are kept in a sorted array.
+ */
+class WCSPBlock: public ConstraintBlock {
+public:
+        enum { KIND = CONSTRAINT_KIND_WCSP };
+
+        WCSPBlock(): mKoef(0.0) {};
+
+        /**
+         * Adds a constraint to the block. Returns false if the tuples of the constraint
+         * cannot be encoded or its koeficient differs from the one of the block (the
+         * constraint then has to be evaluated elsewhere).
+         */
+        bool addConstraint(const Scope & aScope, const std::map<std::vector<VarType>, unsigned long> & aTupleWeights,
+                        unsigned long aDefaultWeight, unsigned long aHardConstraintWeight, double aKoef,
+                        const ProblemMapping & aMapping);
 
-extern double EXP_K;
+        virtual size_t size() const {
+                return mDefaultWeight.size();
+        };
+
+        virtual double evalAssignment(const VarType * aValues) const;
+
+        virtual double evalLogAssignment(const VarType * aValues) const;
+private:
+        /**
+         * Sum of the weights of the rows given a complete assignment, false if a row is hard
+         */
+        bool _totalWeight(const VarType * aValues, double & outTotalWeight) const;
+
+        // Scope variables and their radices of row i are at mScopeOffsets[i] .. mScopeOffsets[i + 1] - 1
+        std::vector<size_t> mScopeOffsets;
+        std::vector<VarIdType> mScopeVars;
+        std::vector<unsigned long> mRadices;
+
+        // Sorted tuple codes and weights of row i are at mTupleOffsets[i] .. mTupleOffsets[i + 1] - 1
+        std::vector<size_t> mTupleOffsets;
+        std::vector<unsigned long> mTupleCodes;
+        std::vector<unsigned long> mTupleWeights;
+
+        std::vector<unsigned long> mDefaultWeight;
+        std::vector<unsigned long> mHardConstraintWeight;
+
+        // Koeficient of the weights of all the constraints
+        double mKoef;
+};
+
+/**
+ * Loads a problem in the WCSP format. Variables and values are numbered from zero
+ * in the format, so the mapping of the problem is an identity. The weights of the
+ * constraints are scaled by aKoef.
+ */
+CSPProblem * load_wcsp_problem(const char * filename, double aKoef);
 
 #endif // WCSP_H_
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+
+#include "weighted_marginals.h"
+
+WeightedMarginals::WeightedMarginals():
+        mTotalWeight(0), mTotalSquaredWeight(0), mMaxLogWeight(0), mNumSamples(0) {
+}
+
+void WeightedMarginals::addSample(const Assignment & aAssignment, double aLogWeight) {
+        // A sample of weight 0 does not change the estimate
+        if (aLogWeight <= -HUGE_VAL) {
+                ++mNumSamples;
+                return;
+        }
+
+        if (mTotalWeight == 0 || aLogWeight > mMaxLogWeight) {
+                double scale = (mTotalWeight == 0) ? 0 : exp(mMaxLogWeight - aLogWeight);
+
+                for (std::map<VarIdType, ProbabilityDistribution>::iterator varIt = mValueWeights.begin();
+                                varIt != mValueWeights.end(); ++varIt) {
+                        for (ProbabilityDistribution::iterator pIt = varIt->second.begin(); pIt != varIt->second.end(); ++pIt) {
+                                pIt->second *= scale;
+                        }
+                }
+                mTotalWeight *= scale;
+                mTotalSquaredWeight *= scale * scale;
+                mMaxLogWeight = aLogWeight;
+        }
+
+        double weight = exp(aLogWeight - mMaxLogWeight);
+        for (Assignment::const_iterator aIt = aAssignment.begin(); aIt != aAssignment.end(); ++aIt) {
+                mValueWeights[aIt->first][aIt->second] += weight;
+        }
+        mTotalWeight += weight;
+        mTotalSquaredWeight += weight * weight;
+        ++mNumSamples;
+}
+
+void WeightedMarginals::getMarginals(std::map<VarIdType, ProbabilityDistribution> & outMarginals) const {
+        outMarginals.clear();
+        if (mTotalWeight == 0)
+                return;
+
+        for (std::map<VarIdType, ProbabilityDistribution>::const_iterator varIt = mValueWeights.begin();
+                        varIt != mValueWeights.end(); ++varIt) {
+                ProbabilityDistribution & marginal = outMarginals[varIt->first];
+                for (ProbabilityDistribution::const_iterator pIt = varIt->second.begin(); pIt != varIt->second.end(); ++pIt) {
+                        marginal[pIt->first] = pIt->second / mTotalWeight;
+                }
+        }
+}
+
+double WeightedMarginals::getEffectiveSampleSize() const {
+        if (mTotalSquaredWeight == 0)
+                return 0;
+
+        return mTotalWeight * mTotalWeight / mTotalSquaredWeight;
+}
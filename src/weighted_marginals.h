@@ -0,0 +1,65 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef WEIGHTED_MARGINALS_H_
+#define WEIGHTED_MARGINALS_H_
+
+#include <map>
+#include <string>
+
+#include "csp.h"
+
+/**
+ * Estimates the marginal distributions of the variables from importance-weighted samples,
+ * dividing the sums of the weights of the values by the sum of all the weights. The weights
+ * are given by their logarithms and kept relative to the largest one, so that they do not
+ * underflow.
+ */
+class WeightedMarginals {
+public:
+        WeightedMarginals();
+
+        void addSample(const Assignment & aAssignment, double aLogWeight);
+
+        /**
+         * The estimated marginal distributions of the variables
+         */
+        void getMarginals(std::map<VarIdType, ProbabilityDistribution> & outMarginals) const;
+
+        /**
+         * The number of unweighted samples which would give an estimate of the same variance,
+         * (sum of the weights)^2 / sum of the squared weights
+         */
+        double getEffectiveSampleSize() const;
+
+        unsigned int getNumSamples() const {
+                return mNumSamples;
+        };
+private:
+        // The sums of the weights divided by exp(mMaxLogWeight)
+        std::map<VarIdType, ProbabilityDistribution> mValueWeights;
+        double mTotalWeight, mTotalSquaredWeight;
+
+        double mMaxLogWeight;
+        unsigned int mNumSamples;
+};
+
+#endif // WEIGHTED_MARGINALS_H_
@@ -155,7 +155,8 @@ public:
                 for (int i = 0; i < mIntVars.size(); ++i) {
                         a[mVariableIds[i]] = mIntVars[i].val();
                 }
-                std::cout << "SAMPLE " << g_problem->evalAssignment(a) << " | ";
+                Assignment encoded = g_problem->getMapping()->encodeAssignment(a);
+                std::cout << "SAMPLE " << g_problem->evalAssignment(encoded) << " | ";
 
                 for (int i = 0; i < mIntVars.size(); ++i) {
                         std::cout << mVariableIds[i] << ": " << mIntVars[i];
@@ -206,13 +207,15 @@ int main(int argc, char** argv) {
         g_datadir = parser.getOptionArg("dataset");
 
         // Create CELAR constraint problem from the dataset
-        celar_load_costs((g_datadir + "/costs.txt").c_str());
-        ConstraintList * c = celar_load_constraints((g_datadir + "/ctr.txt").c_str());
+        CelarCosts * costs = celar_load_costs((g_datadir + "/costs.txt").c_str());
+        ConstraintList * c = celar_load_constraints((g_datadir + "/ctr.txt").c_str(), costs);
         std::vector<Domain> * d = celar_load_domains((g_datadir + "/dom.txt").c_str());
-        VariableMap * v = new VariableMap();
-        celar_load_variables((g_datadir + "/var.txt").c_str(), d, v, c);
+        VariableArray * v = new VariableArray();
+        ProblemMapping * m = new ProblemMapping();
+        celar_load_variables((g_datadir + "/var.txt").c_str(), d, v, c, m, costs);
+        delete costs;
 
-        g_problem = new CSPProblem(v, c);
+        g_problem = new CSPProblem(v, c, m);
 
         Options opt("Celar");
         opt.solutions = -1;
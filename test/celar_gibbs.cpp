@@ -35,12 +35,13 @@ unsigned int CELAR_INTERFERENCE_COSTS_SIZE = 4;
 const unsigned int GIBBS_SAMPLER_BURN_IN = 1000;
 
 int main(int argc, char ** argv) {
-        ConstraintList * c = celar_load_constraints("data/ludek/01/ctr.txt");
+        ConstraintList * c = celar_load_constraints("data/ludek/01/ctr.txt", 0);
         std::vector<Domain> * d = celar_load_domains("data/ludek/01/dom.txt");
-        VariableMap * v = new VariableMap();
-        celar_load_variables("data/ludek/01/var.txt", d, v, c);
+        VariableArray * v = new VariableArray();
+        ProblemMapping * m = new ProblemMapping();
+        celar_load_variables("data/ludek/01/var.txt", d, v, c, m, 0);
 
-        CSPProblem * p = new CSPProblem(v, c);
+        CSPProblem * p = new CSPProblem(v, c, m);
         Assignment evidence;
         //evidence[0] = 9;
         std::map<VarIdType, Domain> removedValues;
@@ -60,11 +61,11 @@ int main(int argc, char ** argv) {
                 }
 
                 std::cout << "Domains:" << std::endl;
-                for (VariableMap::iterator varIt = v->begin(); varIt != v->end(); ++varIt) {
-                        const Domain *d = varIt->second->getDomain();
+                for (VarIdType varId = 0; varId < v->size(); ++varId) {
+                        const DomainView *d = (*v)[varId]->getDomain();
 
-                        std::cout << varIt->first << ": ";
-                        for (Domain::const_iterator domIt = d->begin(); domIt != d->end(); ++domIt) {
+                        std::cout << varId << ": ";
+                        for (DomainView::const_iterator domIt = d->begin(); domIt != d->end(); ++domIt) {
                                 std::cout << *domIt << ", ";
                         }
                         std::cout << std::endl;
@@ -73,11 +74,11 @@ int main(int argc, char ** argv) {
 
         p->restoreDomains(removedValues);
         std::cout << "Restored domains:" << std::endl;
-        for (VariableMap::iterator varIt = v->begin(); varIt != v->end(); ++varIt) {
-                const Domain *d = varIt->second->getDomain();
+        for (VarIdType varId = 0; varId < v->size(); ++varId) {
+                const DomainView *d = (*v)[varId]->getDomain();
 
-                std::cout << varIt->first << ": ";
-                for (Domain::const_iterator domIt = d->begin(); domIt != d->end(); ++domIt) {
+                std::cout << varId << ": ";
+                for (DomainView::const_iterator domIt = d->begin(); domIt != d->end(); ++domIt) {
                         std::cout << *domIt << ", ";
                 }
                 std::cout << std::endl;
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <vector>
+#include <math.h>
+
+#include "../src/csp.h"
+#include "../src/celar.h"
+#include "../src/celar_kernel.h"
+
+/**
+ * Checks the vectorised interference kernel against the scalar one and the
+ * conditional log-weights of a CELAR scenario against the full evaluation
+ */
+int main(int argc, char ** argv) {
+        std::string dataDir = (argc > 1) ? argv[1] : "data/celar/scen01";
+
+        std::cout << "Kernel: " << celar_interference_kernel_name() << std::endl;
+
+        srand(1);
+        for (size_t n = 0; n < 40; ++n) {
+                std::vector<VarType> values(n);
+                for (size_t k = 0; k < n; ++k) {
+                        values[k] = rand() % 800;
+                }
+
+                for (int op = CELAR_OPERATOR_EQ; op <= CELAR_OPERATOR_GT; ++op) {
+                        VarType other = rand() % 800;
+                        VarType target = rand() % 400;
+                        std::vector<double> expected(n + 1, 1.0), computed(n + 1, 1.0);
+
+                        celar_interference_log_weights_scalar(n ? &values[0] : 0, n, other, (CelarOperator)op, target,
+                                        0.5, -57.0, &expected[0]);
+                        celar_interference_log_weights(n ? &values[0] : 0, n, other, (CelarOperator)op, target,
+                                        0.5, -57.0, &computed[0]);
+
+                        if (expected != computed) {
+                                std::cout << "Kernel differs from the scalar version for " << n << " values" << std::endl;
+                                return EXIT_FAILURE;
+                        }
+                }
+        }
+
+        CelarCosts * costs = celar_load_costs((dataDir + "/costs.txt").c_str());
+        ConstraintList * c = celar_load_constraints((dataDir + "/ctr.txt").c_str(), costs);
+        std::vector<Domain> * d = celar_load_domains((dataDir + "/dom.txt").c_str());
+        VariableArray * v = new VariableArray();
+        ProblemMapping * m = new ProblemMapping();
+        celar_load_variables((dataDir + "/var.txt").c_str(), d, v, c, m, costs);
+        delete costs;
+
+        CSPProblem * p = new CSPProblem(v, c, m);
+
+        FlatAssignment sample(v->size());
+        for (VarIdType i = 0; i < sample.size(); ++i) {
+                sample[i] = rand() % p->getVariableById(i)->getDomain()->size();
+        }
+
+        for (VarIdType i = 0; i < sample.size(); i += 7) {
+                const DomainView * domain = p->getVariableById(i)->getDomain();
+                std::vector<VarType> candidates(domain->begin(), domain->end());
+                std::vector<double> logWeights;
+
+                p->conditionalLogWeights(i, candidates, sample, logWeights);
+
+                for (size_t k = 0; k < candidates.size(); ++k) {
+                        FlatAssignment a = sample;
+                        a[i] = candidates[k];
+
+                        // Compare the logarithms, the products tend to underflow
+                        double expected = 0.0;
+                        for (ConstraintList::const_iterator ctrIt = c->begin(); ctrIt != c->end(); ++ctrIt) {
+                                Assignment scopeAssignment;
+                                Scope s = (*ctrIt)->getScope();
+                                for (Scope::const_iterator scIt = s.begin(); scIt != s.end(); ++scIt) {
+                                        scopeAssignment[*scIt] = a[*scIt];
+                                }
+                                expected += log((**ctrIt)(scopeAssignment));
+                        }
+
+                        if (fabs(expected - logWeights[k]) > 1e-6 * (1.0 + fabs(expected))) {
+                                std::cout << "Conditional of x_" << i << " = " << candidates[k] << " is " << logWeights[k]
+                                        << ", expected " << expected << std::endl;
+                                return EXIT_FAILURE;
+                        }
+                }
+        }
+
+        std::cout << "OK" << std::endl;
+
+        delete p;
+        return EXIT_SUCCESS;
+}
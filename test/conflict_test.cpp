@@ -0,0 +1,206 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "../src/conflict_set.h"
+#include "../src/csp.h"
+#include "../src/ijgp_sampler.h"
+#include "test_problem.h"
+
+/**
+ * Forbids the tuple (aValue1, aValue2) of a binary constraint
+ */
+static void forbid(WCSPConstraint * aConstraint, VarType aValue1, VarType aValue2) {
+        std::vector<VarType> tuple(2, aValue1);
+        tuple[1] = aValue2;
+        aConstraint->addDifferentWeightTuple(tuple, TEST_HARD_WEIGHT);
+}
+
+/**
+ * a, b, c with the values 0, 1 and d, e with 0, 1, 2: b != a, d != e, a = 0 excludes d = 0
+ * and e = 0, c = 0 excludes d = 1 and e = 1, c = 1 excludes d = 2 and e = 2. After a = 0 the
+ * problem is arc consistent, but both values of c fail because of a and c only, so the search
+ * jumps back from c over b to a.
+ */
+static CSPProblem * backjump_test_problem() {
+        ConstraintList * c = new ConstraintList();
+
+        c->push_back(test_not_equal(0, 1, 2));
+        c->push_back(test_not_equal(3, 4, 3));
+
+        for (VarIdType varId = 3; varId <= 4; ++varId) {
+                WCSPConstraint * fromA = test_constraint(0, varId, 0);
+                forbid(fromA, 0, 0);
+                c->push_back(fromA);
+
+                WCSPConstraint * fromC = test_constraint(2, varId, 0);
+                forbid(fromC, 0, 1);
+                forbid(fromC, 1, 2);
+                c->push_back(fromC);
+        }
+
+        std::vector<unsigned int> domainSizes(5, 2);
+        domainSizes[3] = domainSizes[4] = 3;
+
+        return test_problem(domainSizes, c);
+}
+
+/**
+ * Prints the depths of the conflict set, as "{0 2}"
+ */
+static std::string conflict_pprint(const ConflictSet & aConflict, unsigned int aNumDepths) {
+        std::string result = "{";
+        for (unsigned int depth = 0; depth < aNumDepths; ++depth) {
+                if (aConflict.contains(depth)) {
+                        result += (result.size() > 1 ? " " : "");
+                        result += (char)('0' + depth);
+                }
+        }
+
+        return result + "}";
+}
+
+static bool check_conflict(const char * aName, const ConflictSet & aConflict, const std::string & aExpected) {
+        std::string conflict = conflict_pprint(aConflict, 5);
+        if (conflict != aExpected) {
+                std::cout << aName << ": " << conflict << ", expected " << aExpected << std::endl;
+                return false;
+        }
+
+        return true;
+}
+
+/**
+ * Assigns the value at the given depth and propagates it, as the search does
+ */
+static bool assign(CSPProblem * aProblem, Assignment & aEvidence, VarIdType aVarId, VarType aValue, int aDepth,
+                Domain & outRestricted, std::map<VarIdType, Domain> & outRemoved) {
+        aEvidence[aVarId] = aValue;
+        aProblem->getVariableById(aVarId)->restrictDomainToValue(aValue, outRestricted);
+        aProblem->setAssignmentDepth(aVarId, aDepth);
+
+        return aProblem->propagateConstraints(aEvidence, outRemoved, aVarId);
+}
+
+/**
+ * Checks that the propagation explains the removed values and the failures by the depths
+ * of the assignments which caused them, and that the conflicts are restored
+ */
+int main(int argc, char ** argv) {
+        bool ok = true;
+
+        CSPProblem * problem = backjump_test_problem();
+        problem->trackConflicts();
+
+        Assignment evidence;
+        std::vector<Domain> restricted(3);
+        std::vector<std::map<VarIdType, Domain> > removed(3);
+
+        // a = 0 at depth 0 removes b = 0, d = 0 and e = 0
+        if (!assign(problem, evidence, 0, 0, 0, restricted[0], removed[0])) {
+                std::cout << "a = 0 failed" << std::endl;
+                return EXIT_FAILURE;
+        }
+        ok = check_conflict("b after a", problem->getConflict(1), "{0}") && ok;
+        ok = check_conflict("c after a", problem->getConflict(2), "{}") && ok;
+        ok = check_conflict("d after a", problem->getConflict(3), "{0}") && ok;
+
+        // b = 1 at depth 1 removes nothing
+        size_t trailAfterA = problem->getConflictTrailSize();
+        if (!assign(problem, evidence, 1, 1, 1, restricted[1], removed[1])) {
+                std::cout << "b = 1 failed" << std::endl;
+                return EXIT_FAILURE;
+        }
+        ok = check_conflict("d after b", problem->getConflict(3), "{0}") && ok;
+
+        // Both values of c at depth 2 fail, the conflict of c collects their failures without c
+        size_t trailAfterB = problem->getConflictTrailSize();
+        ConflictSet conflict = problem->getConflict(2);
+        for (VarType value = 0; value < 2; ++value) {
+                if (assign(problem, evidence, 2, value, 2, restricted[2], removed[2])) {
+                        std::cout << "c = " << value << " did not fail" << std::endl;
+                        ok = false;
+                }
+                ConflictSet failure = problem->getFailureConflict();
+                ok = check_conflict("failure of c", failure, "{0 2}") && ok;
+
+                problem->restoreDomains(removed[2]);
+                removed[2].clear();
+                problem->getVariableById(2)->restoreRestrictedDomain(restricted[2]);
+                restricted[2].clear();
+                problem->setAssignmentDepth(2, -1);
+                problem->restoreConflicts(trailAfterB);
+                evidence.erase(2);
+                ok = check_conflict("d restored", problem->getConflict(3), "{0}") && ok;
+
+                failure.erase(2);
+                conflict.merge(failure);
+        }
+        ok = check_conflict("conflict of c", conflict, "{0}") && ok;
+
+        // The deepest assignment in the conflict is the target of the jump
+        int target = -1;
+        for (int depth = 0; depth < 2; ++depth) {
+                if (conflict.contains(depth))
+                        target = depth;
+        }
+        if (target != 0) {
+                std::cout << "Backjump to depth " << target << ", expected 0" << std::endl;
+                ok = false;
+        }
+
+        // Back at the root, nothing explains the removed values any more
+        problem->restoreDomains(removed[1]);
+        problem->getVariableById(1)->restoreRestrictedDomain(restricted[1]);
+        problem->setAssignmentDepth(1, -1);
+        problem->restoreConflicts(trailAfterA);
+        problem->restoreDomains(removed[0]);
+        problem->getVariableById(0)->restoreRestrictedDomain(restricted[0]);
+        problem->setAssignmentDepth(0, -1);
+        problem->restoreConflicts(0);
+
+        for (VarIdType varId = 1; varId < 5; ++varId) {
+                ok = check_conflict("restored", problem->getConflict(varId), "{}") && ok;
+        }
+
+        delete problem;
+
+        // The sampler with backjumping finds only the solutions, all of them have a = 1
+        IJGPSampler sampler(backjump_test_problem(), 2, 0.0, 1);
+        sampler.setBackjumping(true);
+        for (unsigned int i = 0; i < 20; ++i) {
+                Assignment sample;
+                if (!sampler.getSample(sample) || sample[0] != 1 || sample[1] != 0 || sample[3] == sample[4]) {
+                        std::cout << "Backjumping sampler gave " << assignment_pprint(sample) << std::endl;
+                        ok = false;
+                        break;
+                }
+        }
+
+        if (!ok)
+                return EXIT_FAILURE;
+
+        std::cout << "Conflict test passed" << std::endl;
+        return EXIT_SUCCESS;
+}
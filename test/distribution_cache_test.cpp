@@ -0,0 +1,120 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "../src/csp.h"
+#include "../src/distribution_cache.h"
+#include "../src/ijgp.h"
+#include "test_problem.h"
+
+static DistributionCache::Key key(long aValue) {
+        return DistributionCache::Key(3, aValue);
+}
+
+static ProbabilityDistribution distribution(double aProbability) {
+        ProbabilityDistribution dist;
+        dist[0] = aProbability;
+        dist[1] = 1 - aProbability;
+        return dist;
+}
+
+static bool check(const char * aName, bool aResult) {
+        if (!aResult)
+                std::cout << aName << " failed" << std::endl;
+
+        return aResult;
+}
+
+/**
+ * Checks the eviction of the least recently used distribution, and that the distributions
+ * of a join graph are looked up again after a propagation or a change of the domains
+ */
+int main(int argc, char ** argv) {
+        bool ok = true;
+        ProbabilityDistribution dist;
+
+        // The second key is the least recently used when the third one comes
+        {
+                DistributionCache cache(2);
+                cache.insert(key(1), distribution(0.1));
+                cache.insert(key(2), distribution(0.2));
+                ok = check("find 1", cache.find(key(1), dist) && dist == distribution(0.1)) && ok;
+
+                cache.insert(key(3), distribution(0.3));
+                ok = check("2 evicted", !cache.find(key(2), dist)) && ok;
+                ok = check("1 kept", cache.find(key(1), dist)) && ok;
+                ok = check("3 kept", cache.find(key(3), dist) && dist == distribution(0.3)) && ok;
+
+                // A key is inserted once, its distribution stays
+                cache.insert(key(3), distribution(0.5));
+                ok = check("3 not replaced", cache.find(key(3), dist) && dist == distribution(0.3)) && ok;
+                ok = check("lookups", cache.getNumLookups() == 5 && cache.getNumHits() == 4) && ok;
+        }
+
+        // The epoch of the messages and the domains are a part of the key
+        {
+                CSPProblem * problem = test_loopy_problem(6, 3);
+                JoinGraph * graph = JoinGraph::createJoinGraph(problem, 2);
+                graph->setQuiet(true);
+                DistributionCache cache(100);
+
+                Assignment evidence;
+                graph->iterativePropagation(problem, evidence);
+
+                Variable * var = problem->getVariableById(3);
+                ProbabilityDistribution first = graph->conditionalDistribution(problem, var, evidence, &cache);
+                ProbabilityDistribution second = graph->conditionalDistribution(problem, var, evidence, &cache);
+                ok = check("hit", cache.getNumHits() == 1 && first == second) && ok;
+
+                Assignment propagated;
+                propagated[0] = 0;
+                graph->iterativePropagation(problem, propagated);
+                ProbabilityDistribution afterPropagation = graph->conditionalDistribution(problem, var, evidence, &cache);
+                ok = check("miss after the propagation", cache.getNumHits() == 1) && ok;
+                ok = check("computed after the propagation",
+                                afterPropagation == graph->conditionalDistribution(problem, var, evidence)) && ok;
+
+                // Another variable of the node in which the distribution is computed
+                const Scope * scope = graph->getDistributionScope(var->getId());
+                Variable * other = problem->getVariableById(*scope->begin() != var->getId() ?
+                                *scope->begin() : *scope->rbegin());
+
+                Domain removed;
+                other->restrictDomainToValue(1, removed);
+                graph->conditionalDistribution(problem, var, evidence, &cache);
+                ok = check("miss after a change of the domains", cache.getNumHits() == 1) && ok;
+                other->restoreRestrictedDomain(removed);
+
+                graph->conditionalDistribution(problem, var, evidence, &cache);
+                ok = check("hit after the domain is restored", cache.getNumHits() == 2) && ok;
+
+                delete graph;
+                delete problem;
+        }
+
+        if (!ok)
+                return EXIT_FAILURE;
+
+        std::cout << "Distribution cache test passed" << std::endl;
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+
+#include "../src/ijgp_controller.h"
+
+static ProbabilityDistribution distribution(double aProbability0, double aProbability1) {
+        ProbabilityDistribution dist;
+        if (aProbability0 > 0)
+                dist[0] = aProbability0;
+        if (aProbability1 > 0)
+                dist[1] = aProbability1;
+        return dist;
+}
+
+static bool check(const char * aName, bool aResult) {
+        if (!aResult)
+                std::cout << aName << " failed" << std::endl;
+
+        return aResult;
+}
+
+/**
+ * Checks that the controller runs IJGP while its gain per second is above the gain rate,
+ * and skips the runs once the moving average of the gain drops
+ */
+int main(int argc, char ** argv) {
+        bool ok = true;
+        const ProbabilityDistribution uniform = distribution(0.5, 0.5);
+
+        IJGPController controller(1.0);
+
+        // A run which finds a value inconsistent gains 0.5 + log 2 per changed variable in 0.1 s
+        for (unsigned int run = 0; run < 5; ++run) {
+                ok = check("warm-up run", controller.shouldRun(1, false)) && ok;
+                controller.recordRun(1, 0.1, uniform, distribution(1, 0));
+        }
+        ok = check("informative run", controller.shouldRun(1, false)) && ok;
+        ok = check("nothing changed", !controller.shouldRun(0, true)) && ok;
+
+        // The runs which change nothing lower the average gain until a run is not worth 0.1 s,
+        // 1.19 * 0.9^n < 0.1 after 24 of them
+        unsigned int numUseless = 0;
+        while (numUseless < 100 && controller.shouldRun(1, false)) {
+                controller.recordRun(1, 0.1, uniform, uniform);
+                ++numUseless;
+        }
+        if (numUseless != 24) {
+                std::cout << "Skipped after " << numUseless << " useless runs, expected 24" << std::endl;
+                ok = false;
+        }
+
+        // More changed evidence is expected to gain more, a failure is always worth a run
+        ok = check("more changes", controller.shouldRun(2, false)) && ok;
+        ok = check("failure", controller.shouldRun(1, true)) && ok;
+
+        // The same gain in a longer time is not worth it
+        IJGPController slow(1.0);
+        for (unsigned int run = 0; run < 5; ++run) {
+                slow.recordRun(1, 10.0, uniform, distribution(1, 0));
+        }
+        ok = check("slow run skipped", !slow.shouldRun(1, false)) && ok;
+
+        ok = check("runs", controller.getNumRuns() == 29 && controller.getNumSkipped() == 2) && ok;
+
+        if (!ok)
+                return EXIT_FAILURE;
+
+        std::cout << "IJGP controller test passed" << std::endl;
+        return EXIT_SUCCESS;
+}
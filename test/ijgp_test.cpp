@@ -36,13 +36,15 @@ const unsigned int IJGP_MAX_ITERATIONS = 10;
 
 int main(int argc, char ** argv) {
 
-        celar_load_costs("data/ludek/03/costs.txt");
-        ConstraintList * c = celar_load_constraints("data/ludek/03/ctr.txt");
+        CelarCosts * costs = celar_load_costs("data/ludek/03/costs.txt");
+        ConstraintList * c = celar_load_constraints("data/ludek/03/ctr.txt", costs);
         std::vector<Domain> * d = celar_load_domains("data/ludek/03/dom.txt");
-        VariableMap * v = new VariableMap();
-        celar_load_variables("data/ludek/03/var.txt", d, v, c);
+        VariableArray * v = new VariableArray();
+        ProblemMapping * m = new ProblemMapping();
+        celar_load_variables("data/ludek/03/var.txt", d, v, c, m, costs);
+        delete costs;
 
-        CSPProblem * p = new CSPProblem(v, c);
+        CSPProblem * p = new CSPProblem(v, c, m);
 
         JoinGraph * jg = JoinGraph::createJoinGraph(p, 3);
         jg->pprint();
@@ -23,8 +23,9 @@ DomainIntervalMap create_interval2() {
         return result;
 }
 
-Domain create_domain() {
-        Domain d;
+DomainView create_domain(DomainArena * aArena) {
+        DomainView d(aArena, aArena->addDomain(201));
+        d.clear();
         d.insert(2);
         /*
         d.insert(4);
@@ -49,7 +50,8 @@ Domain create_domain() {
 int main(int argc, char ** argv) {
         DomainIntervalMap il1 = create_interval1();
         DomainIntervalMap il2 = create_interval2();
-        Domain d = create_domain();
+        DomainArena arena;
+        DomainView d = create_domain(&arena);
 
         std::cout << "IL 1:\t\t" << interval_list_pprint(il1) << std::endl;
         std::cout << "IL 2:\t\t" << interval_list_pprint(il2) << std::endl;
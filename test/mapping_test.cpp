@@ -0,0 +1,74 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "../src/csp.h"
+#include "../src/celar.h"
+
+/**
+ * Loads a CELAR scenario and checks that the variables and values are numbered
+ * densely and that the assignments survive the round trip through the mapping
+ */
+int main(int argc, char ** argv) {
+        std::string dataDir = (argc > 1) ? argv[1] : "data/celar/scen01";
+
+        CelarCosts * costs = celar_load_costs((dataDir + "/costs.txt").c_str());
+        ConstraintList * c = celar_load_constraints((dataDir + "/ctr.txt").c_str(), costs);
+        std::vector<Domain> * d = celar_load_domains((dataDir + "/dom.txt").c_str());
+        VariableArray * v = new VariableArray();
+        ProblemMapping * m = new ProblemMapping();
+        celar_load_variables((dataDir + "/var.txt").c_str(), d, v, c, m, costs);
+        delete costs;
+
+        CSPProblem * p = new CSPProblem(v, c, m);
+
+        if (v->size() != m->getNumVariables() || v->empty() || (*v)[v->size() - 1]->getId() != v->size() - 1) {
+                std::cout << "Variables are not numbered densely" << std::endl;
+                return EXIT_FAILURE;
+        }
+
+        Assignment a;
+        for (VarIdType varId = 0; varId < v->size(); ++varId) {
+                const DomainView * domain = (*v)[varId]->getDomain();
+
+                if (domain->empty() || *domain->begin() != 0 || *domain->rbegin() != (VarType)domain->size() - 1) {
+                        std::cout << "Values of x_" << varId << " are not numbered densely" << std::endl;
+                        return EXIT_FAILURE;
+                }
+
+                a[varId] = varId % domain->size();
+        }
+
+        Assignment original = p->decodeAssignment(a);
+        if (m->encodeAssignment(original) != a) {
+                std::cout << "Assignment does not survive the round trip" << std::endl;
+                return EXIT_FAILURE;
+        }
+
+        std::cout << "Variables: " << m->getNumVariables() << ", first: " << m->getOriginalId(0)
+                << ", last: " << m->getOriginalId(m->getNumVariables() - 1) << std::endl;
+        std::cout << "Evaluation: " << p->evalAssignment(a) << std::endl;
+
+        delete p;
+        return EXIT_SUCCESS;
+}
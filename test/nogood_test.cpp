@@ -0,0 +1,167 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include "../src/csp.h"
+#include "../src/nogood_store.h"
+#include "test_problem.h"
+
+const char * NOGOOD_TEST_CACHE = "nogood_test.cache";
+
+/**
+ * Four variables with the values 0, 1, 2 and a constraint between aVar1 and aVar2
+ */
+static CSPProblem * nogood_test_problem(VarIdType aVar1 = 0, VarIdType aVar2 = 1) {
+        ConstraintList * c = new ConstraintList();
+        c->push_back(test_not_equal(aVar1, aVar2, 3));
+
+        return test_problem(std::vector<unsigned int>(4, 3), c);
+}
+
+static Nogood nogood(VarIdType aVar1, VarType aValue1, VarIdType aVar2, VarType aValue2) {
+        Nogood result;
+        result.push_back(Literal(aVar1, aValue1));
+        result.push_back(Literal(aVar2, aValue2));
+        return result;
+}
+
+/**
+ * Propagates aVarId = aValue (added to aEvidence), returns "violated", "units: n" or "none"
+ */
+static std::string propagate(NogoodStore & aStore, Assignment & aEvidence, VarIdType aVarId, VarType aValue) {
+        aEvidence[aVarId] = aValue;
+
+        std::vector<const Nogood *> units;
+        const Nogood * violated = 0;
+        if (!aStore.propagate(aVarId, aValue, aEvidence, units, violated))
+                return "violated";
+
+        if (units.empty())
+                return "none";
+
+        return units.size() == 1 ? "units: 1" : "units: more";
+}
+
+static bool check(const char * aName, const std::string & aResult, const std::string & aExpected) {
+        if (aResult != aExpected) {
+                std::cout << aName << ": " << aResult << ", expected " << aExpected << std::endl;
+                return false;
+        }
+
+        return true;
+}
+
+/**
+ * Checks the propagation of the nogoods, the watches of a learned nogood, the replacement
+ * of the oldest nogood and the cache of the nogoods
+ */
+int main(int argc, char ** argv) {
+        CSPProblem * problem = nogood_test_problem();
+        bool ok = true;
+
+        // x0 = 0 makes {x0 = 0, x1 = 0} unit, x1 = 0 then violates it
+        {
+                NogoodStore store(problem, 10, 5);
+                ok = check("added", store.add(nogood(0, 0, 1, 0)) ? "yes" : "no", "yes") && ok;
+                ok = check("added again", store.add(nogood(0, 0, 1, 0)) ? "yes" : "no", "no") && ok;
+
+                Assignment evidence;
+                ok = check("x0 = 0", propagate(store, evidence, 0, 0), "units: 1") && ok;
+                ok = check("x1 = 0", propagate(store, evidence, 1, 0), "violated") && ok;
+                evidence.erase(1);
+                ok = check("x1 = 1", propagate(store, evidence, 1, 1), "none") && ok;
+        }
+
+        // {x0 = 0, x2 = 0, x3 = 0} learned at the depths 0, 2, 3 (x1 at the depth 1); after the
+        // backtrack to x2, x2 = 0 again prunes x3 = 0
+        {
+                NogoodStore store(problem, 10, 5);
+                Nogood learned;
+                learned.push_back(Literal(0, 0));
+                learned.push_back(Literal(2, 0));
+                learned.push_back(Literal(3, 0));
+                std::vector<int> depths;
+                depths.push_back(0);
+                depths.push_back(2);
+                depths.push_back(3);
+                store.add(learned, depths);
+
+                Assignment evidence;
+                evidence[0] = 0;
+                evidence[1] = 1;
+                ok = check("x2 = 0 after the backtrack", propagate(store, evidence, 2, 0), "units: 1") && ok;
+        }
+
+        // The third nogood replaces the first one, whose watches are stale then
+        {
+                NogoodStore store(problem, 2, 5);
+                store.add(nogood(0, 1, 1, 1));
+                store.add(nogood(2, 1, 3, 1));
+                store.add(nogood(0, 2, 2, 2));
+                ok = check("size", store.size() == 2 ? "2" : "other", "2") && ok;
+
+                Assignment evidence;
+                ok = check("x0 = 1 replaced", propagate(store, evidence, 0, 1), "none") && ok;
+                ok = check("x2 = 1 kept", propagate(store, evidence, 2, 1), "units: 1") && ok;
+                ok = check("second kept", store.add(nogood(2, 1, 3, 1)) ? "yes" : "no", "no") && ok;
+                ok = check("first replaced", store.add(nogood(0, 1, 1, 1)) ? "yes" : "no", "yes") && ok;
+        }
+
+        // The saved nogoods are loaded for the same problem only
+        {
+                NogoodStore store(problem, 10, 5);
+                store.add(nogood(0, 0, 1, 0));
+                store.add(Nogood(1, Literal(3, 2)));
+                if (!store.save(NOGOOD_TEST_CACHE)) {
+                        std::cout << "Saving the nogoods failed" << std::endl;
+                        ok = false;
+                }
+
+                NogoodStore loaded(problem, 10, 5);
+                ok = check("load", loaded.load(NOGOOD_TEST_CACHE) ? "yes" : "no", "yes") && ok;
+                ok = check("loaded size", loaded.size() == 2 ? "2" : "other", "2") && ok;
+
+                std::vector<Literal> unary;
+                loaded.getUnaryNogoods(unary);
+                ok = check("loaded unary", (unary.size() == 1 && unary[0] == Literal(3, 2)) ? "x3 = 2" : "other", "x3 = 2") && ok;
+
+                Assignment evidence;
+                ok = check("loaded x0 = 0", propagate(loaded, evidence, 0, 0), "units: 1") && ok;
+
+                CSPProblem * otherProblem = nogood_test_problem(0, 2);
+                NogoodStore other(otherProblem, 10, 5);
+                ok = check("load for another problem", other.load(NOGOOD_TEST_CACHE) ? "yes" : "no", "no") && ok;
+                ok = check("nothing loaded", other.size() == 0 ? "0" : "other", "0") && ok;
+                delete otherProblem;
+        }
+
+        std::remove(NOGOOD_TEST_CACHE);
+        delete problem;
+
+        if (!ok)
+                return EXIT_FAILURE;
+
+        std::cout << "Nogood store test passed" << std::endl;
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "../src/csp.h"
+#include "../src/ijgp.h"
+#include "test_problem.h"
+
+// Enough iterations for the messages of the small graph to converge to the tolerance
+const unsigned int PROPAGATION_TEST_ITERATIONS = 500;
+const double PROPAGATION_TEST_TOLERANCE = 1e-14;
+
+static ProbabilityDistribution normalized(const ProbabilityDistribution & aDistribution) {
+        double total = 0;
+        for (ProbabilityDistribution::const_iterator pIt = aDistribution.begin(); pIt != aDistribution.end(); ++pIt) {
+                total += pIt->second;
+        }
+
+        ProbabilityDistribution result;
+        for (ProbabilityDistribution::const_iterator pIt = aDistribution.begin(); pIt != aDistribution.end(); ++pIt) {
+                result[pIt->first] = pIt->second / total;
+        }
+
+        return result;
+}
+
+static bool same_distribution(const ProbabilityDistribution & aDist1, const ProbabilityDistribution & aDist2) {
+        ProbabilityDistribution dist1 = normalized(aDist1), dist2 = normalized(aDist2);
+        if (dist1.size() != dist2.size())
+                return false;
+
+        for (ProbabilityDistribution::const_iterator pIt = dist1.begin(); pIt != dist1.end(); ++pIt) {
+                ProbabilityDistribution::const_iterator otherIt = dist2.find(pIt->first);
+                if (otherIt == dist2.end() || fabs(pIt->second - otherIt->second) > 1e-6)
+                        return false;
+        }
+
+        return true;
+}
+
+/**
+ * Compares the distributions of the unassigned variables after the full and the lazy
+ * propagation of aEvidence (the lazy one up to every node) in the join graphs of aProblem
+ */
+static bool compare_propagations(CSPProblem * aProblem, Assignment & aEvidence) {
+        std::map<VarIdType, Domain> removedValues;
+        if (!aEvidence.empty() && !aProblem->propagateConstraints(aEvidence, removedValues)) {
+                std::cout << "The evidence " << assignment_pprint(aEvidence) << " is inconsistent" << std::endl;
+                return false;
+        }
+
+        // The copies of a graph do not have its constraints, both graphs are created
+        JoinGraph * iterative = JoinGraph::createJoinGraph(aProblem, 2);
+        JoinGraph * lazy = JoinGraph::createJoinGraph(aProblem, 2);
+        iterative->setQuiet(true);
+        lazy->setQuiet(true);
+        iterative->setConvergenceTolerance(PROPAGATION_TEST_TOLERANCE);
+        lazy->setConvergenceTolerance(PROPAGATION_TEST_TOLERANCE);
+
+        iterative->iterativePropagation(aProblem, aEvidence, PROPAGATION_TEST_ITERATIONS);
+
+        bool ok = true;
+        for (VarIdType varId = 0; varId < aProblem->getVariables()->size(); ++varId) {
+                if (aEvidence.count(varId))
+                        continue;
+
+                Variable * var = aProblem->getVariableById(varId);
+                lazy->lazyPropagation(aProblem, aEvidence, var, aProblem->getVariables()->size(), PROPAGATION_TEST_ITERATIONS);
+
+                ProbabilityDistribution iterativeDist = iterative->conditionalDistribution(aProblem, var, aEvidence);
+                ProbabilityDistribution lazyDist = lazy->conditionalDistribution(aProblem, var, aEvidence);
+                if (!same_distribution(iterativeDist, lazyDist)) {
+                        std::cout << "x" << varId << " with the evidence " << assignment_pprint(aEvidence) << ": iterative "
+                                << probability_distribution_pprint(iterativeDist) << ", lazy "
+                                << probability_distribution_pprint(lazyDist) << std::endl;
+                        ok = false;
+                }
+        }
+
+        delete iterative;
+        delete lazy;
+
+        aProblem->restoreDomains(removedValues);
+        return ok;
+}
+
+/**
+ * Checks that the lazy propagation gives the same distributions as the full one when it
+ * reaches the whole join graph
+ */
+int main(int argc, char ** argv) {
+        CSPProblem * problem = test_loopy_problem(7, 3);
+
+        bool ok = true;
+        Assignment evidence;
+        ok = compare_propagations(problem, evidence) && ok;
+
+        evidence[0] = 0;
+        ok = compare_propagations(problem, evidence) && ok;
+
+        evidence[3] = 2;
+        ok = compare_propagations(problem, evidence) && ok;
+
+        delete problem;
+
+        if (!ok)
+                return EXIT_FAILURE;
+
+        std::cout << "Propagation test passed" << std::endl;
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../src/restart_policy.h"
+
+/**
+ * The next aNumRuns limits of the schedule, separated by spaces
+ */
+static std::string limits(RestartSchedule & aSchedule, unsigned int aNumRuns) {
+        std::ostringstream out;
+        for (unsigned int run = 0; run < aNumRuns; ++run) {
+                out << (run > 0 ? " " : "") << aSchedule.nextLimit();
+        }
+
+        return out.str();
+}
+
+static bool check(const char * aName, const std::string & aResult, const std::string & aExpected) {
+        if (aResult != aExpected) {
+                std::cout << aName << ": " << aResult << ", expected " << aExpected << std::endl;
+                return false;
+        }
+
+        return true;
+}
+
+/**
+ * Checks the limits of the Luby and geometric schedules, their reset and the parsing of the policies
+ */
+int main(int argc, char ** argv) {
+        bool ok = true;
+
+        RestartSchedule luby(RESTART_LUBY, 1, 0);
+        ok = check("luby", limits(luby, 15), "1 1 2 1 1 2 4 1 1 2 1 1 2 4 8") && ok;
+        luby.reset();
+        ok = check("luby after reset", limits(luby, 3), "1 1 2") && ok;
+
+        RestartSchedule lubyBase(RESTART_LUBY, 100, 0);
+        ok = check("luby by 100", limits(lubyBase, 7), "100 100 200 100 100 200 400") && ok;
+
+        RestartSchedule geometric(RESTART_GEOMETRIC, 10, 1.5);
+        ok = check("geometric", limits(geometric, 6), "10 15 22 33 50 75") && ok;
+        geometric.reset();
+        ok = check("geometric after reset", limits(geometric, 2), "10 15") && ok;
+
+        // A factor below 1 does not shrink the limits, a zero base is 1
+        RestartSchedule flat(RESTART_GEOMETRIC, 0, 0.5);
+        ok = check("geometric flat", limits(flat, 3), "1 1 1") && ok;
+
+        RestartSchedule none(RESTART_NONE, 10, 2);
+        ok = check("none", limits(none, 3), "0 0 0") && ok;
+
+        RestartPolicy policy = RESTART_NONE;
+        ok = check("parse luby", parse_restart_policy("luby", policy) && policy == RESTART_LUBY ? "ok" : "no", "ok") && ok;
+        ok = check("parse geometric", parse_restart_policy("geometric", policy) && policy == RESTART_GEOMETRIC ? "ok" : "no", "ok") && ok;
+        ok = check("parse unknown", parse_restart_policy("linear", policy) ? "ok" : "no", "no") && ok;
+
+        if (!ok)
+                return EXIT_FAILURE;
+
+        std::cout << "Restart schedule test passed" << std::endl;
+        return EXIT_SUCCESS;
+}
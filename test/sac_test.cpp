@@ -0,0 +1,152 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/csp.h"
+#include "../src/sac.h"
+#include "test_problem.h"
+
+const char * SAC_TEST_CACHE = "sac_test.cache";
+
+/**
+ * v, x, y, z: x, y and z are all different, y != z leaves them only the values 1, 2, and
+ * v = 0 excludes x = 0 and x = 3. The arc consistency removes nothing else; SAC removes 1
+ * and 2 from x, and then v = 0.
+ *
+ * With aOtherTuple, v = 0 excludes x = 2 instead of x = 3 (a problem of the same size)
+ */
+static CSPProblem * sac_test_problem(bool aOtherTuple = false) {
+        ConstraintList * c = new ConstraintList();
+
+        WCSPConstraint * vx = test_constraint(0, 1, 0);
+        std::vector<VarType> tuple(2, 0);
+        vx->addDifferentWeightTuple(tuple, TEST_HARD_WEIGHT);
+        tuple[1] = aOtherTuple ? 2 : 3;
+        vx->addDifferentWeightTuple(tuple, TEST_HARD_WEIGHT);
+        c->push_back(vx);
+
+        c->push_back(test_not_equal(1, 2, 4));
+        c->push_back(test_not_equal(1, 3, 4));
+
+        WCSPConstraint * yz = test_constraint(2, 3, TEST_HARD_WEIGHT);
+        tuple[0] = 1;
+        tuple[1] = 2;
+        yz->addDifferentWeightTuple(tuple, 0);
+        tuple[0] = 2;
+        tuple[1] = 1;
+        yz->addDifferentWeightTuple(tuple, 0);
+        c->push_back(yz);
+
+        std::vector<unsigned int> domainSizes(4, 4);
+        domainSizes[0] = 2;
+
+        return test_problem(domainSizes, c);
+}
+
+/**
+ * Checks the domains of the problem against the expected ones, given as "v | x | y | z"
+ */
+static bool check_domains(const char * aName, const CSPProblem * aProblem, const std::string & aExpected) {
+        std::ostringstream domains;
+        for (VarIdType varId = 0; varId < aProblem->getVariables()->size(); ++varId) {
+                const DomainView * domain = aProblem->getVariableById(varId)->getDomain();
+
+                domains << (varId > 0 ? " |" : "");
+                for (DomainView::const_iterator domIt = domain->begin(); domIt != domain->end(); ++domIt) {
+                        domains << " " << *domIt;
+                }
+        }
+
+        if (domains.str() != aExpected) {
+                std::cout << aName << ": domains" << domains.str() << ", expected" << aExpected << std::endl;
+                return false;
+        }
+
+        return true;
+}
+
+/**
+ * Runs the full and the bounds SAC on a small problem and checks the cache files
+ */
+int main(int argc, char ** argv) {
+        bool ok = true;
+
+        // SAC_FULL needs two rounds to remove v = 0, SAC_BOUNDS only probes the bounds of x (which pass)
+        CSPProblem * full = sac_test_problem();
+        ok = singleton_arc_consistency(full, SAC_FULL, 1) && ok;
+        ok = check_domains("full", full, " 1 | 0 3 | 1 2 | 1 2") && ok;
+
+        CSPProblem * fullThreads = sac_test_problem();
+        ok = singleton_arc_consistency(fullThreads, SAC_FULL, 3) && ok;
+        ok = check_domains("full, 3 threads", fullThreads, " 1 | 0 3 | 1 2 | 1 2") && ok;
+
+        CSPProblem * bounds = sac_test_problem();
+        ok = singleton_arc_consistency(bounds, SAC_BOUNDS, 1) && ok;
+        ok = check_domains("bounds", bounds, " 0 1 | 0 1 2 3 | 1 2 | 1 2") && ok;
+
+        // The cache restores the domains of the same problem and mode only
+        ok = sac_save_domains(*full, SAC_FULL, SAC_TEST_CACHE) && ok;
+
+        CSPProblem * loaded = sac_test_problem();
+        if (sac_load_domains(loaded, SAC_BOUNDS, SAC_TEST_CACHE)) {
+                std::cout << "Domains loaded for another mode" << std::endl;
+                ok = false;
+        }
+        if (!sac_load_domains(loaded, SAC_FULL, SAC_TEST_CACHE)) {
+                std::cout << "Domains not loaded" << std::endl;
+                ok = false;
+        }
+        ok = check_domains("loaded", loaded, " 1 | 0 3 | 1 2 | 1 2") && ok;
+
+        CSPProblem * other = sac_test_problem(true);
+        if (sac_load_domains(other, SAC_FULL, SAC_TEST_CACHE)) {
+                std::cout << "Domains loaded for another problem of the same size" << std::endl;
+                ok = false;
+        }
+        ok = check_domains("other", other, " 0 1 | 0 1 2 3 | 0 1 2 3 | 0 1 2 3") && ok;
+
+        CSPProblem * pruned = sac_test_problem();
+        pruned->getVariableById(1)->eraseFromDomain(3);
+        if (sac_load_domains(pruned, SAC_FULL, SAC_TEST_CACHE)) {
+                std::cout << "Domains loaded with a value which is not in the current domain" << std::endl;
+                ok = false;
+        }
+
+        std::remove(SAC_TEST_CACHE);
+
+        delete full;
+        delete fullThreads;
+        delete bounds;
+        delete loaded;
+        delete other;
+        delete pruned;
+
+        if (!ok)
+                return EXIT_FAILURE;
+
+        std::cout << "SAC test passed" << std::endl;
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "../src/csp.h"
+#include "../src/ijgp_sampler.h"
+#include "../src/sample_farm.h"
+#include "../src/utils.h"
+#include "test_problem.h"
+
+/**
+ * Draws two numbers from the random stream of its thread (and waits aDelay seconds)
+ */
+class FarmTestSampler: public CSPSampler {
+public:
+        FarmTestSampler(CSPProblem * aProblem, double aDelay): CSPSampler(aProblem), mDelay(aDelay) {};
+
+        virtual bool getSample(Assignment & aAssignment) {
+                if (mDelay > 0)
+                        usleep((useconds_t)(mDelay * 1e6));
+
+                aAssignment.clear();
+                aAssignment[0] = random_int() % 1000;
+                aAssignment[1] = random_int() % 1000;
+                return true;
+        };
+
+        virtual double getSampleLogWeight() const {
+                return -1.0;
+        };
+
+        virtual CSPSampler * createWorker() const {
+                return new FarmTestSampler(mProblem->createWorkingCopy(), mDelay);
+        };
+private:
+        double mDelay;
+};
+
+static CSPProblem * farm_test_problem() {
+        ConstraintList * c = new ConstraintList();
+        c->push_back(test_not_equal(0, 1, 3));
+        c->push_back(test_not_equal(1, 2, 3));
+
+        WCSPConstraint * soft = test_constraint(2, 3, 0);
+        for (VarType value = 0; value < 3; ++value) {
+                soft->addDifferentWeightTuple(std::vector<VarType>(2, value), 2);
+        }
+        c->push_back(soft);
+
+        return test_problem(std::vector<unsigned int>(4, 3), c);
+}
+
+/**
+ * Reads all the samples of a farm
+ */
+static std::vector<Assignment> farm_samples(CSPSampler * aSampler, unsigned int aNumThreads, unsigned int aNumSamples,
+                bool aOrdered, double aDeadline = 0) {
+        SampleFarm farm(aSampler, aNumThreads, aNumSamples, aOrdered, aDeadline);
+
+        std::vector<Assignment> samples;
+        Assignment a;
+        bool found;
+        double logWeight;
+        while (farm.getSample(a, found, logWeight) && found) {
+                samples.push_back(a);
+        }
+
+        return samples;
+}
+
+/**
+ * Checks that the farm gives the samples of the jobs (seeded by their index) in the order
+ * of the jobs or as they are finished, and that it starts no job after the deadline
+ */
+int main(int argc, char ** argv) {
+        const unsigned int NUM_SAMPLES = 40;
+        bool ok = true;
+
+        // Job i draws from the stream seeded by i, whichever thread runs it
+        std::vector<Assignment> expected;
+        FarmTestSampler * sampler = new FarmTestSampler(farm_test_problem(), 0);
+        for (unsigned int job = 0; job < NUM_SAMPLES; ++job) {
+                random_seed_thread(job);
+                Assignment a;
+                sampler->getSample(a);
+                expected.push_back(a);
+        }
+
+        std::vector<Assignment> ordered = farm_samples(sampler, 4, NUM_SAMPLES, true);
+        if (ordered != expected) {
+                std::cout << "The ordered samples are not those of the jobs in order" << std::endl;
+                ok = false;
+        }
+
+        std::vector<Assignment> unordered = farm_samples(sampler, 4, NUM_SAMPLES, false);
+        std::sort(unordered.begin(), unordered.end());
+        std::vector<Assignment> sortedExpected = expected;
+        std::sort(sortedExpected.begin(), sortedExpected.end());
+        if (unordered != sortedExpected) {
+                std::cout << "The unordered samples are not those of the jobs" << std::endl;
+                ok = false;
+        }
+
+        // The jobs take 20 ms in two threads, so about 20 of them fit before the deadline
+        FarmTestSampler * slowSampler = new FarmTestSampler(farm_test_problem(), 0.02);
+        double start = current_time();
+        std::vector<Assignment> beforeDeadline = farm_samples(slowSampler, 2, 100000, true, start + 0.2);
+        double elapsed = current_time() - start;
+        if (beforeDeadline.empty() || beforeDeadline.size() > 40 || elapsed > 1.0) {
+                std::cout << "With the deadline: " << beforeDeadline.size() << " samples in " << elapsed << " s" << std::endl;
+                ok = false;
+        }
+
+        // The IJGP sampler gives the same samples in any number of threads
+        IJGPSampler * ijgpSampler = new IJGPSampler(farm_test_problem(), 3, 0.5, 10);
+        std::vector<Assignment> ijgpTwo = farm_samples(ijgpSampler, 2, NUM_SAMPLES, true);
+        std::vector<Assignment> ijgpFour = farm_samples(ijgpSampler, 4, NUM_SAMPLES, true);
+        if (ijgpTwo.size() != NUM_SAMPLES || ijgpTwo != ijgpFour) {
+                std::cout << "The IJGP samples depend on the number of threads" << std::endl;
+                ok = false;
+        }
+
+        delete sampler;
+        delete slowSampler;
+        delete ijgpSampler;
+
+        if (!ok)
+                return EXIT_FAILURE;
+
+        std::cout << "Sample farm test passed" << std::endl;
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TEST_PROBLEM_H_
+#define TEST_PROBLEM_H_
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "../src/csp.h"
+#include "../src/wcsp.h"
+
+/**
+ * Weight of the hard tuples of the test problems
+ */
+const unsigned long TEST_HARD_WEIGHT = 1000;
+
+/**
+ * Binary WCSP constraint with the default weight aDefaultWeight (add the other tuples
+ * with addDifferentWeightTuple, in the order of the variable ids)
+ */
+inline WCSPConstraint * test_constraint(VarIdType aVar1, VarIdType aVar2, unsigned long aDefaultWeight) {
+        Scope scope;
+        scope.insert(aVar1);
+        scope.insert(aVar2);
+        return new WCSPConstraint(scope, aDefaultWeight, TEST_HARD_WEIGHT, 1.0);
+}
+
+/**
+ * Hard constraint aVar1 != aVar2 over the values 0 .. aNumValues - 1
+ */
+inline WCSPConstraint * test_not_equal(VarIdType aVar1, VarIdType aVar2, unsigned int aNumValues) {
+        WCSPConstraint * ctr = test_constraint(aVar1, aVar2, 0);
+        for (VarType value = 0; value < (VarType)aNumValues; ++value) {
+                ctr->addDifferentWeightTuple(std::vector<VarType>(2, value), TEST_HARD_WEIGHT);
+        }
+        return ctr;
+}
+
+/**
+ * Builds a problem over variables with the domains 0 .. aDomainSizes[i] - 1, as the loaders do
+ */
+inline CSPProblem * test_problem(const std::vector<unsigned int> & aDomainSizes, ConstraintList * aConstraints) {
+        VariableArray * variables = new VariableArray();
+        ProblemMapping * mapping = new ProblemMapping();
+
+        for (VarIdType varId = 0; varId < aDomainSizes.size(); ++varId) {
+                Domain domain;
+                for (VarType value = 0; value < (VarType)aDomainSizes[varId]; ++value) {
+                        domain.insert(value);
+                }
+
+                variables->addVariable(aDomainSizes[varId]);
+                mapping->addVariable(varId, domain);
+        }
+
+        remap_constraints(aConstraints, *mapping);
+
+        return new CSPProblem(variables, aConstraints, mapping);
+}
+
+/**
+ * The constraints of a cycle of aNumVariables variables with aNumValues values and the chords
+ * between every second variable, so that the join graph has loops. The constraints are soft,
+ * with the weights (i + aValue1 + 2 * aValue2) % 4 for the i-th one, except for the hard
+ * constraint x0 != x1.
+ */
+inline ConstraintList * test_loopy_constraints(unsigned int aNumVariables, unsigned int aNumValues) {
+        ConstraintList * c = new ConstraintList();
+        c->push_back(test_not_equal(0, 1, aNumValues));
+
+        std::vector<std::pair<VarIdType, VarIdType> > edges;
+        for (VarIdType varId = 1; varId < aNumVariables; ++varId) {
+                edges.push_back(std::make_pair(varId, (varId + 1) % aNumVariables));
+        }
+        for (VarIdType varId = 0; varId + 2 < aNumVariables; varId += 2) {
+                edges.push_back(std::make_pair(varId, varId + 2));
+        }
+
+        for (size_t i = 0; i < edges.size(); ++i) {
+                WCSPConstraint * ctr = test_constraint(std::min(edges[i].first, edges[i].second),
+                                std::max(edges[i].first, edges[i].second), 0);
+
+                std::vector<VarType> tuple(2);
+                for (tuple[0] = 0; tuple[0] < (VarType)aNumValues; ++tuple[0]) {
+                        for (tuple[1] = 0; tuple[1] < (VarType)aNumValues; ++tuple[1]) {
+                                ctr->addDifferentWeightTuple(tuple, (i + tuple[0] + 2 * tuple[1]) % 4);
+                        }
+                }
+                c->push_back(ctr);
+        }
+
+        return c;
+}
+
+/**
+ * The problem of test_loopy_constraints()
+ */
+inline CSPProblem * test_loopy_problem(unsigned int aNumVariables, unsigned int aNumValues) {
+        return test_problem(std::vector<unsigned int>(aNumVariables, aNumValues),
+                        test_loopy_constraints(aNumVariables, aNumValues));
+}
+
+#endif // TEST_PROBLEM_H_
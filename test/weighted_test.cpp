@@ -0,0 +1,105 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "../src/csp.h"
+#include "../src/weighted_marginals.h"
+#include "test_problem.h"
+
+static bool check_close(const char * aName, double aResult, double aExpected) {
+        if (fabs(aResult - aExpected) > 1e-9 * (1 + fabs(aExpected))) {
+                std::cout << aName << ": " << aResult << ", expected " << aExpected << std::endl;
+                return false;
+        }
+
+        return true;
+}
+
+static Assignment sample(VarType aValue0, VarType aValue1) {
+        Assignment a;
+        a[0] = aValue0;
+        a[1] = aValue1;
+        return a;
+}
+
+/**
+ * Checks the weighted marginals and the effective sample size for weights 1, 2, 1 (scaled by
+ * aLogScale), and that a sample of weight 0 changes nothing
+ */
+static bool check_marginals(double aLogScale) {
+        WeightedMarginals marginals;
+        marginals.addSample(sample(0, 1), aLogScale);
+        marginals.addSample(sample(0, 0), aLogScale);
+        marginals.addSample(sample(1, 1), aLogScale + log(2.0));
+        marginals.addSample(sample(1, 0), -HUGE_VAL);
+
+        std::map<VarIdType, ProbabilityDistribution> estimates;
+        marginals.getMarginals(estimates);
+
+        bool ok = true;
+        ok = check_close("P(x0 = 0)", estimates[0][0], 0.5) && ok;
+        ok = check_close("P(x0 = 1)", estimates[0][1], 0.5) && ok;
+        ok = check_close("P(x1 = 0)", estimates[1][0], 0.25) && ok;
+        ok = check_close("P(x1 = 1)", estimates[1][1], 0.75) && ok;
+        ok = check_close("ESS", marginals.getEffectiveSampleSize(), 16.0 / 6.0) && ok;
+        ok = check_close("samples", marginals.getNumSamples(), 4) && ok;
+
+        if (!ok)
+                std::cout << "(log weights scaled by " << aLogScale << ")" << std::endl;
+
+        return ok;
+}
+
+/**
+ * Checks the weighted marginals on hand-computed weights, also far below the range of double,
+ * and the log-domain evaluation of a problem whose value underflows
+ */
+int main(int argc, char ** argv) {
+        bool ok = true;
+
+        ok = check_marginals(0) && ok;
+        ok = check_marginals(-5000) && ok;
+        ok = check_marginals(700) && ok;
+
+        // 1100 constraints of the value 1/2, 2^-1100 is below the smallest double
+        ConstraintList * c = new ConstraintList();
+        for (unsigned int i = 0; i < 1100; ++i) {
+                c->push_back(test_constraint(0, 1, 1));
+        }
+        CSPProblem * problem = test_problem(std::vector<unsigned int>(2, 2), c);
+
+        Assignment a = sample(0, 1);
+        ok = check_close("evalAssignment", problem->evalAssignment(a), 0) && ok;
+        ok = check_close("evalLogAssignment", problem->evalLogAssignment(a), -1100 * log(2.0)) && ok;
+
+        delete problem;
+
+        if (!ok)
+                return EXIT_FAILURE;
+
+        std::cout << "Weighted marginals test passed" << std::endl;
+        return EXIT_SUCCESS;
+}
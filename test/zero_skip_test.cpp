@@ -0,0 +1,164 @@
+/*
+ * Copyright 2008 Luděk Cigler <luc@matfyz.cz>
+ * $Id$
+ *
+ * This file is part of SCSPSampler.
+ *
+ * SCSPSampler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hollo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "../src/csp.h"
+#include "../src/ijgp.h"
+#include "test_problem.h"
+
+const unsigned int ZERO_SKIP_TEST_ITERATIONS = 500;
+const double ZERO_SKIP_TEST_TOLERANCE = 1e-14;
+
+/**
+ * A WCSP constraint which hides its hard tuples from the join graph, so that the nodes
+ * enumerate all the tuples of their scopes
+ */
+class DenseConstraint: public WCSPConstraint {
+public:
+        DenseConstraint(const WCSPConstraint & aConstraint): WCSPConstraint(aConstraint) {};
+
+        virtual bool canBeZero() const {
+                return false;
+        };
+};
+
+/**
+ * The loopy test problem with the hard constraints x2 != x4 and x3 != x5 added, its
+ * constraints hidden from the zero checks if aDense is true
+ */
+static CSPProblem * zero_skip_problem(bool aDense) {
+        const unsigned int numVariables = 6, numValues = 3;
+
+        ConstraintList * loopy = test_loopy_constraints(numVariables, numValues);
+        loopy->push_back(test_not_equal(2, 4, numValues));
+        loopy->push_back(test_not_equal(3, 5, numValues));
+
+        ConstraintList * constraints = new ConstraintList();
+        for (ConstraintList::iterator ctrIt = loopy->begin(); ctrIt != loopy->end(); ++ctrIt) {
+                WCSPConstraint * ctr = dynamic_cast<WCSPConstraint *>(*ctrIt);
+                assert(ctr);
+                if (aDense) {
+                        constraints->push_back(new DenseConstraint(*ctr));
+                        delete ctr;
+                } else {
+                        constraints->push_back(ctr);
+                }
+        }
+        delete loopy;
+
+        return test_problem(std::vector<unsigned int>(numVariables, numValues), constraints);
+}
+
+/**
+ * Propagates aEvidence in the join graphs of both problems and compares the distributions
+ * of the unassigned variables, which must not differ beyond the rounding. Counts the values
+ * ruled out (with the probability 0) in ioNumZeros.
+ */
+static bool compare_enumerations(CSPProblem * aZeroAware, CSPProblem * aDense, Assignment & aEvidence,
+                unsigned int & ioNumZeros) {
+        JoinGraph * zeroAware = JoinGraph::createJoinGraph(aZeroAware, 2);
+        JoinGraph * dense = JoinGraph::createJoinGraph(aDense, 2);
+        zeroAware->setQuiet(true);
+        dense->setQuiet(true);
+        zeroAware->setConvergenceTolerance(ZERO_SKIP_TEST_TOLERANCE);
+        dense->setConvergenceTolerance(ZERO_SKIP_TEST_TOLERANCE);
+
+        unsigned int zeroAwareIterations = zeroAware->iterativePropagation(aZeroAware, aEvidence, ZERO_SKIP_TEST_ITERATIONS);
+        unsigned int denseIterations = dense->iterativePropagation(aDense, aEvidence, ZERO_SKIP_TEST_ITERATIONS);
+
+        bool ok = true;
+        if (zeroAwareIterations != denseIterations) {
+                std::cout << "The evidence " << assignment_pprint(aEvidence) << ": " << zeroAwareIterations
+                        << " iterations with the zero checks, " << denseIterations << " without them" << std::endl;
+                ok = false;
+        }
+
+        for (VarIdType varId = 0; varId < aZeroAware->getVariables()->size(); ++varId) {
+                if (aEvidence.count(varId))
+                        continue;
+
+                ProbabilityDistribution zeroAwareDist = zeroAware->conditionalDistribution(aZeroAware,
+                                aZeroAware->getVariableById(varId), aEvidence);
+                ProbabilityDistribution denseDist = dense->conditionalDistribution(aDense,
+                                aDense->getVariableById(varId), aEvidence);
+
+                bool same = zeroAwareDist.size() == denseDist.size();
+                for (ProbabilityDistribution::const_iterator pIt = zeroAwareDist.begin(); same && pIt != zeroAwareDist.end(); ++pIt) {
+                        ProbabilityDistribution::const_iterator otherIt = denseDist.find(pIt->first);
+                        same = otherIt != denseDist.end() && fabs(pIt->second - otherIt->second) <= 1e-12 * fabs(otherIt->second)
+                                && (pIt->second == 0.0) == (otherIt->second == 0.0);
+                        if (pIt->second == 0.0)
+                                ++ioNumZeros;
+                }
+
+                if (!same) {
+                        std::cout << "x" << varId << " with the evidence " << assignment_pprint(aEvidence) << ": zero checks "
+                                << probability_distribution_pprint(zeroAwareDist) << ", dense "
+                                << probability_distribution_pprint(denseDist) << std::endl;
+                        ok = false;
+                }
+        }
+
+        delete zeroAware;
+        delete dense;
+
+        return ok;
+}
+
+/**
+ * Checks that skipping the tuples ruled out by the hard factors and the zero messages gives
+ * the same messages as enumerating all the tuples
+ */
+int main(int argc, char ** argv) {
+        CSPProblem * zeroAware = zero_skip_problem(false);
+        CSPProblem * dense = zero_skip_problem(true);
+
+        bool ok = true;
+        unsigned int numZeros = 0;
+        Assignment evidence;
+        ok = compare_enumerations(zeroAware, dense, evidence, numZeros) && ok;
+
+        evidence[0] = 0;
+        ok = compare_enumerations(zeroAware, dense, evidence, numZeros) && ok;
+
+        evidence[3] = 2;
+        ok = compare_enumerations(zeroAware, dense, evidence, numZeros) && ok;
+
+        // With x0 = 0 and x3 = 2, the hard constraints rule out x1 = 0 and x5 = 2
+        if (numZeros < 2) {
+                std::cout << "Only " << numZeros << " values ruled out by the hard constraints" << std::endl;
+                ok = false;
+        }
+
+        delete zeroAware;
+        delete dense;
+
+        if (!ok)
+                return EXIT_FAILURE;
+
+        std::cout << "Zero skip test passed" << std::endl;
+        return EXIT_SUCCESS;
+}